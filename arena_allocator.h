@@ -0,0 +1,191 @@
+#ifndef CREEK_ARENA_ALLOCATOR_H
+#define CREEK_ARENA_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <algorithm>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <type_traits>
+
+#include "fwd.h"
+
+namespace creek
+{
+    namespace detail
+    {
+        //-----------------------------------------------------------
+        //    arena
+        //    hands out memory from large chunks. single blocks are
+        //    never given back, the chunks are released all at once.
+        //-----------------------------------------------------------
+        class arena
+        {
+        private:
+            struct chunk
+            {
+                chunk* m_next;
+            };
+            
+            chunk* m_chunks;
+            char* m_current;
+            char* m_end;
+            std::size_t m_chunk_size;
+            std::size_t m_chunk_count;
+            
+        public:
+            explicit arena(std::size_t _chunk_size)
+                : m_chunks(), m_current(), m_end(),
+                m_chunk_size(_chunk_size), m_chunk_count()
+            {}
+            
+            arena(arena const&) = delete;
+            arena& operator=(arena const&) = delete;
+            
+            ~arena()
+            { release(); }
+            
+            void* allocate(std::size_t _bytes, std::size_t _align)
+            {
+                char* p = align_up(m_current, _align);
+                if(m_current == 0 || p + _bytes > m_end){
+                    std::size_t const header = sizeof(chunk) + _align;
+                    std::size_t const size = std::max(m_chunk_size, _bytes + header);
+                    chunk* c = static_cast<chunk*>(::operator new(size));
+                    c->m_next = m_chunks;
+                    m_chunks = c;
+                    ++m_chunk_count;
+                    m_current = reinterpret_cast<char*>(c + 1);
+                    m_end = reinterpret_cast<char*>(c) + size;
+                    p = align_up(m_current, _align);
+                }
+                m_current = p + _bytes;
+                return p;
+            }
+            
+            void release()
+            {
+                while(m_chunks != 0){
+                    chunk* next = m_chunks->m_next;
+                    ::operator delete(m_chunks);
+                    m_chunks = next;
+                }
+                m_current = 0;
+                m_end = 0;
+                m_chunk_count = 0;
+            }
+            
+            std::size_t chunk_count() const
+            { return m_chunk_count; }
+            
+        private:
+            static char* align_up(char* _p, std::size_t _align)
+            {
+                std::size_t const mis = reinterpret_cast<std::size_t>(_p) % _align;
+                return (mis == 0) ? _p : _p + (_align - mis);
+            }
+        };
+    }
+    
+    //-----------------------------------------------------------
+    //    class arena_allocator
+    //    copies and rebound copies share one arena.
+    //    deallocate() is a no-op; memory comes back through
+    //    release() or when the last copy is destroyed.
+    //    release() frees the memory of every copy, a container may
+    //    only call it while sole_owner() holds.
+    //-----------------------------------------------------------
+    template<typename T, std::size_t ChunkSize = 65536>
+    class arena_allocator
+    {
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef T const* const_pointer;
+        typedef T& reference;
+        typedef T const& const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        static std::size_t const chunk_size = ChunkSize;
+        
+        template<typename U>
+        struct rebind
+        {
+            typedef arena_allocator<U, ChunkSize> other;
+        };
+        
+    private:
+        template<typename U, std::size_t N>
+        friend class arena_allocator;
+        
+        std::shared_ptr<detail::arena> m_arena;
+        
+    public:
+        arena_allocator()
+            : m_arena(std::make_shared<detail::arena>(ChunkSize))
+        {}
+        
+        arena_allocator(arena_allocator const& _other) noexcept
+            : m_arena(_other.m_arena)
+        {}
+        
+        template<typename U>
+        arena_allocator(arena_allocator<U, ChunkSize> const& _other) noexcept
+            : m_arena(_other.m_arena)
+        {}
+        
+        pointer address(reference _a) const
+        { return &_a; }
+        
+        const_pointer address(const_reference _a) const
+        { return &_a; }
+        
+        pointer allocate(size_type _n, void const* = 0)
+        {
+            if(_n > max_size()) throw std::bad_alloc();
+            return static_cast<pointer>(m_arena->allocate(_n * sizeof(T), alignof(T)));
+        }
+        
+        void deallocate(pointer, size_type)
+        {}
+        
+        size_type max_size() const
+        { return std::numeric_limits<size_type>::max() / sizeof(T); }
+        
+        template<typename U, typename... Args>
+        void construct(U* _p, Args&&... _args)
+        { ::new(static_cast<void*>(_p)) U(std::forward<Args>(_args)...); }
+        
+        template<typename U>
+        void destroy(U* _p)
+        { _p->~U(); }
+        
+        //---- release
+        //     frees every chunk at once. objects still living in the
+        //     arena are not destroyed.
+        void release()
+        { m_arena->release(); }
+        
+        //---- sole owner
+        //     true if no other copy shares the arena.
+        bool sole_owner() const
+        { return m_arena.use_count() == 1; }
+        
+        std::size_t chunk_count() const
+        { return m_arena->chunk_count(); }
+        
+        template<typename U>
+        bool operator==(arena_allocator<U, ChunkSize> const& _other) const
+        { return (m_arena == _other.m_arena); }
+        
+        template<typename U>
+        bool operator!=(arena_allocator<U, ChunkSize> const& _other) const
+        { return !(*this == _other); }
+    };
+    
+    template<typename T, std::size_t N>
+    struct is_bulk_releasable<arena_allocator<T, N>>
+        : public std::true_type {};
+}
+#endif
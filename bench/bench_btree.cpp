@@ -0,0 +1,116 @@
+//-----------------------------------------------------------
+//    bench_btree.cpp
+//    random keys inserted, looked up, walked in order and
+//    erased: std::multiset and rbtree against btree.
+//-----------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <set>
+#include <vector>
+#include <string>
+#include <utility>
+
+#include "rbtree.h"
+#include "btree.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_type;
+    typedef creek::btree<int, creek::rbtree_default, 512> wide_btree;
+    
+    std::size_t volatile sink;
+    
+    //---- milliseconds
+    template<typename Function>
+    double measure(Function _f)
+    {
+        clock_type::time_point start = clock_type::now();
+        _f();
+        std::chrono::duration<double, std::milli> d = clock_type::now() - start;
+        return d.count();
+    }
+    
+    struct result
+    {
+        double insert;
+        double find;
+        double walk;
+        double erase;
+    };
+    
+    //---- _find and _ends hide the names each container gives
+    //     to its lookups and bounds
+    template<typename Tree, typename Find, typename Ends>
+    result run(std::vector<int> const& _keys, std::vector<int> const& _queries, Find _find, Ends _ends)
+    {
+        result r;
+        Tree t;
+        r.insert = measure([&](){
+            for(int k : _keys) t.insert(k);
+        });
+        r.find = measure([&](){
+            std::size_t hits = 0;
+            auto end = _ends(t).second;
+            for(int k : _queries) if(_find(t, k) != end) ++hits;
+            sink = hits;
+        });
+        r.walk = measure([&](){
+            long sum = 0;
+            for(auto it = _ends(t).first; it != _ends(t).second; ++it) sum += *it;
+            sink = static_cast<std::size_t>(sum);
+        });
+        r.erase = measure([&](){
+            for(int k : _keys) t.erase(_find(t, k));
+        });
+        return r;
+    }
+    
+    void report(std::string const& _name, result _r, result _base)
+    {
+        std::cout << std::left << std::setw(16) << _name << std::right << std::fixed
+            << std::setprecision(1)
+            << std::setw(10) << _r.insert << std::setw(7) << (_r.insert / _base.insert)
+            << std::setw(10) << _r.find << std::setw(7) << (_r.find / _base.find)
+            << std::setw(10) << _r.walk << std::setw(7) << (_r.walk / _base.walk)
+            << std::setw(10) << _r.erase << std::setw(7) << (_r.erase / _base.erase) << "\n";
+    }
+}
+
+int main()
+{
+    std::cout << "milliseconds for every key, and the ratio to std::multiset\n";
+    std::cout << std::left << std::setw(16) << "" << std::right
+        << std::setw(17) << "insert"
+        << std::setw(17) << "find"
+        << std::setw(17) << "walk"
+        << std::setw(17) << "erase" << "\n";
+    
+    for(int n : { 1 << 16, 1 << 20, 1 << 22 }){
+        std::mt19937 gen(n);
+        std::uniform_int_distribution<int> dist(0, 2 * n);
+        std::vector<int> keys(n), queries(n);
+        for(int& k : keys) k = dist(gen);
+        for(int& k : queries) k = dist(gen);
+        
+        std::cout << n << " keys\n";
+        result base = run<std::multiset<int>>(keys, queries,
+            [](std::multiset<int>& _t, int _k){ return _t.find(_k); },
+            [](std::multiset<int>& _t){ return std::make_pair(_t.begin(), _t.end()); });
+        report("std::multiset", base, base);
+        report("rbtree", run<creek::rbtree<int>>(keys, queries,
+            [](creek::rbtree<int>& _t, int _k){ return _t.find(_k); },
+            [](creek::rbtree<int>& _t){ return std::make_pair(_t.in_order_begin(), _t.in_order_end()); }),
+            base);
+        report("btree", run<creek::btree<int>>(keys, queries,
+            [](creek::btree<int>& _t, int _k){ return _t.find(_k); },
+            [](creek::btree<int>& _t){ return std::make_pair(_t.in_order_begin(), _t.in_order_end()); }),
+            base);
+        report("btree 512", run<wide_btree>(keys, queries,
+            [](wide_btree& _t, int _k){ return _t.find(_k); },
+            [](wide_btree& _t){ return std::make_pair(_t.in_order_begin(), _t.in_order_end()); }),
+            base);
+    }
+    return 0;
+}
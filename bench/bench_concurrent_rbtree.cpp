@@ -0,0 +1,137 @@
+//-----------------------------------------------------------
+//    bench_concurrent_rbtree.cpp
+//    one writer replacing keys against a growing number of
+//    readers searching, concurrent_rbtree snapshots against an
+//    rbtree behind a mutex.
+//-----------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <random>
+#include <string>
+
+#include "rbtree.h"
+#include "concurrent_rbtree.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_type;
+    
+    int const keys = 1 << 18;
+    std::chrono::milliseconds const duration(300);
+    
+    std::atomic<std::size_t> found(0);
+    
+    struct result
+    {
+        double finds;
+        double writes;
+    };
+    
+    //---- runs _write on one thread and _find on _readers, in
+    //     operations per second
+    template<typename Write, typename Find>
+    result run(std::size_t _readers, Write _write, Find _find)
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<std::size_t> finds(0);
+        std::size_t writes = 0;
+        std::vector<std::thread> threads;
+        for(std::size_t i = 0; i < _readers; ++i){
+            threads.push_back(std::thread([&, i](){
+                std::mt19937 gen(static_cast<unsigned>(i));
+                std::size_t n = 0;
+                _find(gen, n, stop);
+                finds += n;
+            }));
+        }
+        
+        std::mt19937 gen(1234);
+        clock_type::time_point start = clock_type::now();
+        while(clock_type::now() - start < duration){
+            for(int i = 0; i < 64; ++i) _write(gen);
+            writes += 64;
+        }
+        stop.store(true);
+        for(std::thread& th : threads) th.join();
+        std::chrono::duration<double> d = clock_type::now() - start;
+        return result{finds.load() / d.count(), writes / d.count()};
+    }
+    
+    void report(std::string const& _name, std::size_t _readers, result _r)
+    {
+        std::cout << std::left << std::setw(24) << _name << std::right
+            << std::setw(8) << _readers << std::fixed << std::setprecision(2)
+            << std::setw(14) << (_r.finds / 1e6)
+            << std::setw(14) << (_r.writes / 1e6) << "\n";
+    }
+}
+
+int main()
+{
+    std::size_t hardware = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    std::vector<std::size_t> readers;
+    for(std::size_t r = 1; r <= std::max<std::size_t>(hardware, 4); r *= 2) readers.push_back(r);
+    
+    std::cout << keys << " keys, " << hardware << " hardware threads, "
+        << "million operations per second\n";
+    std::cout << std::left << std::setw(24) << "" << std::right
+        << std::setw(8) << "readers"
+        << std::setw(14) << "finds"
+        << std::setw(14) << "writes" << "\n";
+    
+    for(std::size_t r : readers){
+        creek::concurrent_rbtree<int> t;
+        for(int i = 0; i < keys; ++i) t.insert(2 * i);
+        
+        report("concurrent_rbtree", r, run(r,
+            [&](std::mt19937& _gen){
+                int k = 2 * static_cast<int>(_gen() % keys);
+                t.erase(k);
+                t.insert(k);
+            },
+            [&](std::mt19937& _gen, std::size_t& _n, std::atomic<bool>& _stop){
+                creek::concurrent_rbtree<int>::reader rd(t);
+                std::size_t hits = 0;
+                while(!_stop.load(std::memory_order_relaxed)){
+                    creek::concurrent_rbtree<int>::snapshot v = rd.pin();
+                    for(int i = 0; i < 64; ++i){
+                        if(v.contains(static_cast<int>(_gen() % (2 * keys)))) ++hits;
+                    }
+                    _n += 64;
+                }
+                found += hits;
+            }));
+    }
+    
+    for(std::size_t r : readers){
+        creek::rbtree<int> t;
+        for(int i = 0; i < keys; ++i) t.push_back_max(2 * i);
+        std::mutex m;
+        
+        report("rbtree + mutex", r, run(r,
+            [&](std::mt19937& _gen){
+                int k = 2 * static_cast<int>(_gen() % keys);
+                std::lock_guard<std::mutex> lock(m);
+                t.erase(t.find(k));
+                t.insert(k);
+            },
+            [&](std::mt19937& _gen, std::size_t& _n, std::atomic<bool>& _stop){
+                std::size_t hits = 0;
+                while(!_stop.load(std::memory_order_relaxed)){
+                    for(int i = 0; i < 64; ++i){
+                        int k = static_cast<int>(_gen() % (2 * keys));
+                        std::lock_guard<std::mutex> lock(m);
+                        if(t.find(k) != t.in_order_end()) ++hits;
+                    }
+                    _n += 64;
+                }
+                found += hits;
+            }));
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+//-----------------------------------------------------------
+//    bench_interval_tree.cpp
+//    intervals overlapping a query: a scan of the in order walk
+//    against interval_tree, microseconds per query.
+//-----------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <utility>
+
+#include "interval_tree.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_type;
+    typedef std::pair<long, long> interval;
+    
+    std::size_t volatile sink;
+    
+    template<typename Function>
+    double per_query(int _queries, Function _f)
+    {
+        clock_type::time_point start = clock_type::now();
+        _f();
+        std::chrono::duration<double, std::micro> d = clock_type::now() - start;
+        return d.count() / _queries;
+    }
+    
+    void report(std::string const& _name, double _time, double _base)
+    {
+        std::cout << std::left << std::setw(28) << _name << std::right << std::fixed
+            << std::setprecision(3)
+            << std::setw(12) << _time
+            << std::setw(10) << (_time / _base) << "\n";
+    }
+}
+
+int main()
+{
+    int const n = 1 << 18;
+    int const queries = 500;
+    long const span = 100000000;
+    
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<long> start(0, span), length(1, 2000);
+    creek::interval_tree<interval> t;
+    for(int i = 0; i < n; ++i){
+        long s = start(gen);
+        t.insert(interval(s, s + length(gen)));
+    }
+    std::vector<interval> q(queries);
+    for(interval& a : q){
+        a.first = start(gen);
+        a.second = a.first + length(gen);
+    }
+    
+    std::cout << n << " intervals, " << queries << " queries, microseconds per query\n";
+    std::cout << std::left << std::setw(28) << "" << std::right
+        << std::setw(12) << "time"
+        << std::setw(10) << "ratio" << "\n";
+    
+    double base = per_query(queries, [&](){
+        std::size_t found = 0;
+        for(interval const& a : q){
+            for(interval const& b : t){
+                if(b.first < a.second && a.first < b.second) ++found;
+            }
+        }
+        sink = found;
+    });
+    report("in order scan", base, base);
+    report("for_each_overlapping", per_query(queries, [&](){
+        std::size_t found = 0;
+        for(interval const& a : q){
+            t.for_each_overlapping(a.first, a.second, [&](interval const&){ ++found; });
+        }
+        sink = found;
+    }), base);
+    report("overlapping range", per_query(queries, [&](){
+        std::size_t found = 0;
+        for(interval const& a : q){
+            auto r = t.overlapping(a.first, a.second);
+            for(auto it = r.first; it != r.second; ++it) ++found;
+        }
+        sink = found;
+    }), base);
+    report("any_overlap", per_query(queries, [&](){
+        std::size_t found = 0;
+        for(interval const& a : q) found += t.any_overlap(a.first, a.second) ? 1 : 0;
+        sink = found;
+    }), base);
+    return 0;
+}
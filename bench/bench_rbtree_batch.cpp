@@ -0,0 +1,76 @@
+//-----------------------------------------------------------
+//    bench_rbtree_batch.cpp
+//    unsorted batches inserted into a tree: insert per key
+//    against insert_batch, nanoseconds per key.
+//-----------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <string>
+
+#include "rbtree.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_type;
+    
+    std::size_t volatile sink;
+    
+    //---- inserts every batch into a tree holding _base, in
+    //     nanoseconds per key
+    template<typename Insert>
+    double per_key(std::vector<int> const& _base, std::vector<std::vector<int>> const& _batches, Insert _insert)
+    {
+        creek::rbtree<int> t(_base.begin(), _base.end());
+        std::size_t n = 0;
+        clock_type::time_point start = clock_type::now();
+        for(std::vector<int> const& b : _batches){
+            _insert(t, b);
+            n += b.size();
+        }
+        std::chrono::duration<double, std::nano> d = clock_type::now() - start;
+        sink = t.size();
+        return d.count() / n;
+    }
+    
+    void report(std::string const& _name, double _time, double _base)
+    {
+        std::cout << std::left << std::setw(28) << _name << std::right << std::fixed
+            << std::setprecision(1)
+            << std::setw(12) << _time
+            << std::setw(10) << std::setprecision(3) << (_time / _base) << "\n";
+    }
+}
+
+int main()
+{
+    int const n = 1 << 20;
+    std::mt19937 gen(9);
+    std::vector<int> base(n);
+    for(int& k : base) k = static_cast<int>(gen());
+    
+    std::cout << n << " keys in the tree, nanoseconds per key inserted\n";
+    std::cout << std::left << std::setw(28) << "" << std::right
+        << std::setw(12) << "time"
+        << std::setw(10) << "ratio" << "\n";
+    
+    for(int batch : { 1 << 10, 100000, 1 << 20 }){
+        int ticks = std::max(1, (1 << 21) / batch);
+        if(batch == (1 << 20)) ticks = 1;
+        std::vector<std::vector<int>> batches(ticks, std::vector<int>(batch));
+        for(std::vector<int>& b : batches) for(int& k : b) k = static_cast<int>(gen());
+        
+        std::cout << ticks << " batches of " << batch << "\n";
+        double insert = per_key(base, batches, [](creek::rbtree<int>& _t, std::vector<int> const& _b){
+            for(int k : _b) _t.insert(k);
+        });
+        report("insert", insert, insert);
+        report("insert_batch", per_key(base, batches, [](creek::rbtree<int>& _t, std::vector<int> const& _b){
+            _t.insert_batch(_b.begin(), _b.end());
+        }), insert);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+//-----------------------------------------------------------
+//    bench_rbtree_insert.cpp
+//    inserting a sorted stream: a descent from the root per
+//    element against a hint at the end and push_back_max.
+//-----------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <set>
+#include <string>
+
+#include "rbtree.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_type;
+    
+    int const repeat = 5;
+    
+    //---- best of repeat runs, in milliseconds
+    template<typename Function>
+    double measure(Function _f)
+    {
+        double best = 0;
+        for(int i = 0; i < repeat; ++i){
+            clock_type::time_point start = clock_type::now();
+            _f();
+            std::chrono::duration<double, std::milli> d = clock_type::now() - start;
+            if(i == 0 || d.count() < best) best = d.count();
+        }
+        return best;
+    }
+    
+    std::size_t volatile sink;
+    
+    void report(std::string const& _name, double _time, double _base)
+    {
+        std::cout << std::left << std::setw(28) << _name << std::right << std::fixed
+            << std::setprecision(3)
+            << std::setw(12) << _time
+            << std::setw(10) << (_time / _base) << "\n";
+    }
+}
+
+int main()
+{
+    int const n = 1 << 20;
+    
+    std::cout << n << " sorted keys, milliseconds per stream\n";
+    std::cout << std::left << std::setw(28) << "" << std::right
+        << std::setw(12) << "time"
+        << std::setw(10) << "ratio" << "\n";
+    
+    double base = measure([&](){
+        std::multiset<int> s;
+        for(int i = 0; i < n; ++i) s.insert(i);
+        sink = s.size();
+    });
+    report("std::multiset insert", base, base);
+    report("std::multiset insert(end)", measure([&](){
+        std::multiset<int> s;
+        for(int i = 0; i < n; ++i) s.insert(s.end(), i);
+        sink = s.size();
+    }), base);
+    report("rbtree insert", measure([&](){
+        creek::rbtree<int> t;
+        for(int i = 0; i < n; ++i) t.insert(i);
+        sink = t.size();
+    }), base);
+    report("rbtree insert(end)", measure([&](){
+        creek::rbtree<int> t;
+        for(int i = 0; i < n; ++i) t.insert(t.in_order_end(), i);
+        sink = t.size();
+    }), base);
+    report("rbtree insert(last)", measure([&](){
+        creek::rbtree<int> t;
+        auto it = t.in_order_end();
+        for(int i = 0; i < n; ++i) it = t.insert(it, i);
+        sink = t.size();
+    }), base);
+    report("rbtree push_back_max", measure([&](){
+        creek::rbtree<int> t;
+        for(int i = 0; i < n; ++i) t.push_back_max(i);
+        sink = t.size();
+    }), base);
+    return 0;
+}
@@ -0,0 +1,88 @@
+//-----------------------------------------------------------
+//    bench_rbtree_snapshot.cpp
+//    a snapshot after every batch of inserts: rbtree copies
+//    every node, persistent_rbtree shares them.
+//-----------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+
+#include "rbtree.h"
+#include "persistent_rbtree.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_type;
+    
+    int const repeat = 3;
+    
+    //---- best of repeat runs, in milliseconds
+    template<typename Function>
+    double measure(Function _f)
+    {
+        double best = 0;
+        for(int i = 0; i < repeat; ++i){
+            clock_type::time_point start = clock_type::now();
+            _f();
+            std::chrono::duration<double, std::milli> d = clock_type::now() - start;
+            if(i == 0 || d.count() < best) best = d.count();
+        }
+        return best;
+    }
+    
+    std::size_t volatile sink;
+    
+    void report(std::string const& _name, double _time, double _base)
+    {
+        std::cout << std::left << std::setw(28) << _name << std::right << std::fixed
+            << std::setprecision(3)
+            << std::setw(12) << _time
+            << std::setw(10) << (_time / _base) << "\n";
+    }
+}
+
+int main()
+{
+    int const initial = 1 << 16;
+    int const batches = 256;
+    int const batch = 64;
+    
+    std::mt19937 gen(42);
+    std::vector<int> keys(initial + batches * batch);
+    for(int& k : keys) k = static_cast<int>(gen());
+    
+    std::cout << initial << " keys, " << batches << " batches of " << batch
+        << " inserts with a snapshot each, milliseconds\n";
+    std::cout << std::left << std::setw(28) << "" << std::right
+        << std::setw(12) << "time"
+        << std::setw(10) << "ratio" << "\n";
+    
+    double base = measure([&](){
+        creek::rbtree<int> t;
+        for(int i = 0; i < initial; ++i) t.insert(keys[i]);
+        std::size_t n = 0;
+        for(int b = 0; b < batches; ++b){
+            for(int i = 0; i < batch; ++i) t.insert(keys[initial + b * batch + i]);
+            creek::rbtree<int> snapshot;
+            snapshot = t;
+            n += snapshot.size();
+        }
+        sink = n;
+    });
+    report("rbtree operator=", base, base);
+    report("persistent_rbtree", measure([&](){
+        creek::persistent_rbtree<int> t;
+        for(int i = 0; i < initial; ++i) t = t.insert(keys[i]);
+        std::size_t n = 0;
+        for(int b = 0; b < batches; ++b){
+            for(int i = 0; i < batch; ++i) t = t.insert(keys[initial + b * batch + i]);
+            creek::persistent_rbtree<int> snapshot = t;
+            n += snapshot.size();
+        }
+        sink = n;
+    }), base);
+    return 0;
+}
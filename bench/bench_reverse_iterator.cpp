@@ -0,0 +1,113 @@
+//-----------------------------------------------------------
+//    bench_reverse_iterator.cpp
+//    a reverse walk should cost what a backward walk with
+//    operator-- costs: one predecessor per step.
+//-----------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+
+#include "tree.h"
+#include "rbtree.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_type;
+    
+    int const repeat = 50;
+    
+    //---- best of repeat runs, in milliseconds
+    template<typename Function>
+    double measure(Function _f)
+    {
+        double best = 0;
+        for(int i = 0; i < repeat; ++i){
+            clock_type::time_point start = clock_type::now();
+            _f();
+            std::chrono::duration<double, std::milli> d = clock_type::now() - start;
+            if(i == 0 || d.count() < best) best = d.count();
+        }
+        return best;
+    }
+    
+    long volatile sink;
+    
+    //---- called through a pointer the compiler cannot see through,
+    //     as a visitor would be, so that a dereference and the step
+    //     after it are not merged into one predecessor computation.
+    long add(long _a, int _b) { return _a + _b; }
+    long (* volatile accumulate)(long, int) = &add;
+    
+    template<typename Iterator>
+    void forward(Iterator _first, Iterator _last)
+    {
+        long sum = 0;
+        for(; _first != _last; ++_first) sum = accumulate(sum, *_first);
+        sink = sum;
+    }
+    
+    template<typename Iterator>
+    void backward(Iterator _first, Iterator _last)
+    {
+        long sum = 0;
+        while(_last != _first) sum = accumulate(sum, *(--_last));
+        sink = sum;
+    }
+    
+    void report(std::string const& _name, double _forward, double _backward, double _reverse)
+    {
+        std::cout << std::left << std::setw(16) << _name << std::right << std::fixed
+            << std::setprecision(3)
+            << std::setw(12) << _forward
+            << std::setw(12) << _backward
+            << std::setw(12) << _reverse
+            << std::setw(10) << (_reverse / _backward) << "\n";
+    }
+    
+    template<typename Iterator, typename ReverseIterator>
+    void run(std::string const& _name, Iterator _first, Iterator _last,
+        ReverseIterator _rfirst, ReverseIterator _rlast)
+    {
+        double f = measure([&](){ forward(_first, _last); });
+        double b = measure([&](){ backward(_first, _last); });
+        double r = measure([&](){ forward(_rfirst, _rlast); });
+        report(_name, f, b, r);
+    }
+}
+
+int main()
+{
+    std::size_t const n = 1 << 16;
+    std::mt19937 gen(1);
+    
+    creek::tree<int> t1;
+    std::vector<creek::tree<int>::pre_order_iterator> nodes;
+    nodes.push_back(t1.insert(t1.pre_order_begin(), 0));
+    for(std::size_t i = 1; i < n; ++i){
+        std::uniform_int_distribution<std::size_t> pick(0, nodes.size() - 1);
+        nodes.push_back(t1.append_child(nodes[pick(gen)], static_cast<int>(i)));
+    }
+    
+    creek::rbtree<int> t2;
+    for(std::size_t i = 0; i < n; ++i) t2.insert(static_cast<int>(gen()));
+    
+    std::cout << n << " nodes, milliseconds per walk\n";
+    std::cout << std::left << std::setw(16) << "" << std::right
+        << std::setw(12) << "forward"
+        << std::setw(12) << "operator--"
+        << std::setw(12) << "reverse"
+        << std::setw(10) << "ratio" << "\n";
+    
+    creek::tree<int> const& c1 = t1;
+    run("tree pre", c1.pre_order_begin(), c1.pre_order_end(), c1.pre_order_rbegin(), c1.pre_order_rend());
+    run("tree post", c1.post_order_begin(), c1.post_order_end(), c1.post_order_rbegin(), c1.post_order_rend());
+    
+    creek::rbtree<int> const& c2 = t2;
+    run("rbtree pre", c2.pre_order_begin(), c2.pre_order_end(), c2.pre_order_rbegin(), c2.pre_order_rend());
+    run("rbtree in", c2.in_order_begin(), c2.in_order_end(), c2.in_order_rbegin(), c2.in_order_rend());
+    run("rbtree post", c2.post_order_begin(), c2.post_order_end(), c2.post_order_rbegin(), c2.post_order_rend());
+    return 0;
+}
@@ -0,0 +1,862 @@
+//-----------------------------------------------------------
+//    btree.h
+//-----------------------------------------------------------
+#ifndef CREEK_BTREE_H
+#define CREEK_BTREE_H
+
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <limits>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <assert.h>
+
+#include "fwd.h"
+#include "rbtree.h"
+
+namespace creek
+{
+    //-----------------------------------------------------------
+    //    class btree
+    //    ordered container with the interface of rbtree, holding
+    //    a sorted array of values in every node. a leaf takes
+    //    NodeBytes, so a lookup reads one or two cache lines per
+    //    level over a handful of levels instead of one node per
+    //    comparison. inside a node the binary search halves the
+    //    range with a conditional move rather than a branch.
+    //
+    //    equal elements are kept, a new one after the others.
+    //    insert and erase invalidate every iterator.
+    //-----------------------------------------------------------
+    template<
+        typename T,
+        typename Compare = rbtree_default,
+        std::size_t NodeBytes = 256,
+        typename Allocator = std::allocator<T>>
+    class btree
+    {
+        typedef btree self_type;
+        
+        struct internal_node;
+        
+        struct node_header
+        {
+            internal_node* parent;
+            std::uint16_t position;
+            std::uint16_t count;
+            bool leaf;
+        };
+        
+    public:
+        // ---- values in a node, at least three
+        static std::size_t const node_slots =
+            (NodeBytes >= sizeof(node_header) + 3 * sizeof(T)) ?
+            (NodeBytes - sizeof(node_header)) / sizeof(T) : 3;
+        
+        static_assert(node_slots < 0xffff, "btree counts the values of a node in 16 bits");
+        
+    private:
+        // ---- an erase leaves no node below the root with fewer
+        //      values. a split at the end of a node may.
+        static std::size_t const min_count = (node_slots - 1) / 2;
+        
+        struct node
+            : public node_header
+        {
+            T values[node_slots];
+        };
+        
+        struct internal_node
+            : public node
+        {
+            node* children[node_slots + 1];
+        };
+        
+        typedef node* node_pointer;
+        
+        // ---- key type of a lookup
+        template<typename Key>
+        struct lookup_key
+        {
+            typedef typename std::conditional<
+                detail::is_transparent_compare<Compare>::value, Key, T>::type type;
+            static bool const value =
+                detail::is_transparent_compare<Compare>::value ||
+                std::is_convertible<Key const&, T>::value;
+        };
+        
+        // ---- position
+        //      slot m_index of m_node. the end is the slot after the
+        //      last value of the rightmost leaf.
+        template<bool IsConst>
+        class iterator_type
+        {
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<IsConst, T const*, T*>::type pointer;
+            typedef typename std::conditional<IsConst, T const&, T&>::type reference;
+            
+        private:
+            node_pointer m_node;
+            std::size_t m_index;
+            
+            friend class btree;
+            
+            iterator_type(node_pointer _node, std::size_t _index)
+                : m_node(_node), m_index(_index)
+            {}
+            
+        public:
+            iterator_type() : m_node(0), m_index(0) {}
+            
+            template<bool C>
+            iterator_type(iterator_type<C> const& _a,
+                typename std::enable_if<IsConst || !C>::type* = 0)
+                : m_node(_a.m_node), m_index(_a.m_index)
+            {}
+            
+            reference operator*() const { return m_node->values[m_index]; }
+            pointer operator->() const { return &m_node->values[m_index]; }
+            
+            // ---- down to the leftmost leaf of the right subtree, or
+            //      up past the parents this slot ends
+            iterator_type& operator++()
+            {
+                if(!m_node->leaf){
+                    m_node = child(m_node, m_index + 1);
+                    while(!m_node->leaf) m_node = child(m_node, 0);
+                    m_index = 0;
+                    return *this;
+                }
+                if(++m_index < m_node->count) return *this;
+                node_pointer a = m_node;
+                while(a->parent != 0 && a->position == a->parent->count) a = a->parent;
+                if(a->parent == 0) return *this;
+                m_index = a->position;
+                m_node = a->parent;
+                return *this;
+            }
+            
+            iterator_type& operator--()
+            {
+                if(!m_node->leaf){
+                    m_node = child(m_node, m_index);
+                    while(!m_node->leaf) m_node = child(m_node, m_node->count);
+                    m_index = m_node->count - 1;
+                    return *this;
+                }
+                if(m_index > 0){
+                    --m_index;
+                    return *this;
+                }
+                node_pointer a = m_node;
+                while(a->parent != 0 && a->position == 0) a = a->parent;
+                assert(a->parent != 0);
+                m_index = a->position - 1;
+                m_node = a->parent;
+                return *this;
+            }
+            
+            iterator_type operator++(int)
+            {
+                iterator_type tmp(*this);
+                ++*this;
+                return tmp;
+            }
+            
+            iterator_type operator--(int)
+            {
+                iterator_type tmp(*this);
+                --*this;
+                return tmp;
+            }
+            
+            bool operator==(iterator_type const& _a) const
+            { return (m_node == _a.m_node) && (m_index == _a.m_index); }
+            
+            bool operator!=(iterator_type const& _a) const
+            { return !(*this == _a); }
+        };
+        
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Allocator allocator_type;
+        
+        typedef iterator_type<false> in_order_iterator;
+        typedef iterator_type<true> const_in_order_iterator;
+        typedef std::reverse_iterator<in_order_iterator> reverse_in_order_iterator;
+        typedef std::reverse_iterator<const_in_order_iterator> const_reverse_in_order_iterator;
+        
+    private:
+        typedef typename allocator_type::template rebind<node>::other
+            leaf_allocator_type;
+        typedef typename allocator_type::template rebind<internal_node>::other
+            internal_allocator_type;
+        
+        node_pointer m_root;
+        node_pointer m_rightmost;
+        size_type m_size;
+        leaf_allocator_type m_leaf_allocator;
+        internal_allocator_type m_internal_allocator;
+        Compare m_compare;
+        
+    public:
+        explicit btree(Compare _cmp = Compare())
+            : m_root(), m_rightmost(), m_size(),
+              m_leaf_allocator(), m_internal_allocator(), m_compare(_cmp)
+        {}
+        
+        template<typename Iterator>
+        btree(Iterator _first, Iterator _last, Compare _cmp = Compare())
+            : m_root(), m_rightmost(), m_size(),
+              m_leaf_allocator(), m_internal_allocator(), m_compare(_cmp)
+        {
+            assign(_first, _last);
+        }
+        
+        btree(self_type const& _other)
+            : m_root(), m_rightmost(), m_size(),
+              m_leaf_allocator(_other.m_leaf_allocator),
+              m_internal_allocator(_other.m_internal_allocator),
+              m_compare(_other.m_compare)
+        {
+            if(_other.m_root == 0) return;
+            m_root = copy_node(_other.m_root);
+            m_rightmost = m_root;
+            while(!m_rightmost->leaf) m_rightmost = child(m_rightmost, m_rightmost->count);
+            m_size = _other.m_size;
+        }
+        
+        ~btree()
+        {
+            clear();
+        }
+        
+        self_type& operator=(self_type const& _other)
+        {
+            if(&_other == this) return *this;
+            self_type tmp(_other);
+            swap(tmp);
+            return *this;
+        }
+        
+        // ---- replaces the contents with [_first, _last), sorted
+        //      first unless it already is. every value is appended
+        //      to the rightmost leaf, which fills the nodes.
+        template<typename Iterator>
+        void assign(Iterator _first, Iterator _last)
+        {
+            clear();
+            std::vector<value_type> v(_first, _last);
+            key_compare_type less(this);
+            if(!std::is_sorted(v.begin(), v.end(), less)) std::stable_sort(v.begin(), v.end(), less);
+            for(value_type const& a : v) push_back_max(a);
+        }
+        
+        bool operator==(self_type const& _other) const
+        {
+            if(this == &_other) return true;
+            if(size() != _other.size()) return false;
+            return std::equal(in_order_begin(), in_order_end(), _other.in_order_begin());
+        }
+        
+        bool operator!=(self_type const& _other) const
+        {
+            return !(*this == _other);
+        }
+        
+        void swap(self_type& _other)
+        {
+            std::swap(m_root, _other.m_root);
+            std::swap(m_rightmost, _other.m_rightmost);
+            std::swap(m_size, _other.m_size);
+            std::swap(m_leaf_allocator, _other.m_leaf_allocator);
+            std::swap(m_internal_allocator, _other.m_internal_allocator);
+            std::swap(m_compare, _other.m_compare);
+        }
+        
+        in_order_iterator insert(value_type const& _a)
+        {
+            if(m_root == 0) m_root = m_rightmost = create_leaf();
+            node_pointer a = m_root;
+            while(1){
+                std::size_t i = upper_slot(a, _a);
+                if(a->leaf) return insert_leaf(a, i, _a);
+                a = child(a, i);
+            }
+        }
+        
+        // ---- inserts _a right before _hint if it belongs there or
+        //      right after it, without a descent from the root. other
+        //      hints fall back to insert(_a).
+        in_order_iterator insert(const_in_order_iterator _hint, value_type const& _a)
+        {
+            if(m_root == 0) return insert(_a);
+            if(fits_before(_hint, _a)) return insert_before(_hint, _a);
+            if(_hint != in_order_end()){
+                ++_hint;
+                if(fits_before(_hint, _a)) return insert_before(_hint, _a);
+            }
+            return insert(_a);
+        }
+        
+        // ---- appends _a, which must not be less than any element.
+        //      amortised O(1), the rightmost leaf is kept.
+        in_order_iterator push_back_max(value_type const& _a)
+        {
+            assert(empty() || !compare(_a, m_rightmost->values[m_rightmost->count - 1]));
+            if(m_root == 0) m_root = m_rightmost = create_leaf();
+            return insert_leaf(m_rightmost, m_rightmost->count, _a);
+        }
+        
+        // ---- a value of an internal node is replaced by the one
+        //      before it, which is always in a leaf, and the leaf
+        //      borrows from or merges with a sibling if it runs low.
+        void erase(const_in_order_iterator _it)
+        {
+            node_pointer a = _it.m_node;
+            std::size_t i = _it.m_index;
+            assert(a != 0 && i < a->count);
+            if(!a->leaf){
+                node_pointer b = child(a, i);
+                while(!b->leaf) b = child(b, b->count);
+                a->values[i] = std::move(b->values[b->count - 1]);
+                a = b;
+                i = b->count - 1;
+            }
+            for(std::size_t k = i + 1; k < a->count; ++k) a->values[k - 1] = std::move(a->values[k]);
+            --a->count;
+            --m_size;
+            rebalance(a);
+        }
+        
+        void clear()
+        {
+            if(m_root == 0) return;
+            destroy_subtree(m_root);
+            m_root = 0;
+            m_rightmost = 0;
+            m_size = 0;
+        }
+        
+        bool check_invariant() const
+        {
+            if(m_root == 0) return m_size == 0 && m_rightmost == 0;
+            if(m_root->parent != 0) return false;
+            size_type n = 0;
+            if(check_node(m_root, n) < 0 || n != m_size) return false;
+            node_pointer last = m_root;
+            while(!last->leaf) last = child(last, last->count);
+            if(last != m_rightmost) return false;
+            key_compare_type less(this);
+            return std::is_sorted(in_order_begin(), in_order_end(), less);
+        }
+        
+        size_type size() const
+        {
+            return m_size;
+        }
+        
+        size_type max_size() const
+        {
+            return std::numeric_limits<size_type>::max() / sizeof(value_type);
+        }
+        
+        bool empty() const
+        {
+            return (m_size == 0);
+        }
+        
+        Compare const& value_comp() const
+        {
+            return m_compare;
+        }
+        
+        // in order
+        const_in_order_iterator in_order_begin() const
+        {
+            node_pointer a = m_root;
+            if(a == 0) return const_in_order_iterator();
+            while(!a->leaf) a = child(a, 0);
+            return const_in_order_iterator(a, 0);
+        }
+        
+        const_in_order_iterator in_order_end() const
+        {
+            if(m_rightmost == 0) return const_in_order_iterator();
+            return const_in_order_iterator(m_rightmost, m_rightmost->count);
+        }
+        
+        in_order_iterator in_order_begin()
+        {
+            return mutable_iterator(((self_type const&)*this).in_order_begin());
+        }
+        
+        in_order_iterator in_order_end()
+        {
+            return mutable_iterator(((self_type const&)*this).in_order_end());
+        }
+        
+        const_reverse_in_order_iterator in_order_rbegin() const
+        {
+            return const_reverse_in_order_iterator(in_order_end());
+        }
+        
+        const_reverse_in_order_iterator in_order_rend() const
+        {
+            return const_reverse_in_order_iterator(in_order_begin());
+        }
+        
+        reverse_in_order_iterator in_order_rbegin()
+        {
+            return reverse_in_order_iterator(in_order_end());
+        }
+        
+        reverse_in_order_iterator in_order_rend()
+        {
+            return reverse_in_order_iterator(in_order_begin());
+        }
+        
+        // lookup
+        //     keys of another type than value_type are taken as they are
+        //     when the comparator is transparent (or rbtree_default).
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, const_in_order_iterator>::type
+        find(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return find_slot<key_type>(_key);
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, in_order_iterator>::type
+        find(Key const& _key)
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return mutable_iterator(find_slot<key_type>(_key));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, const_in_order_iterator>::type
+        lower_bound(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return lower_bound_slot<key_type>(_key);
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, in_order_iterator>::type
+        lower_bound(Key const& _key)
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return mutable_iterator(lower_bound_slot<key_type>(_key));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, const_in_order_iterator>::type
+        upper_bound(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return upper_bound_slot<key_type>(_key);
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, in_order_iterator>::type
+        upper_bound(Key const& _key)
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return mutable_iterator(upper_bound_slot<key_type>(_key));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value,
+            std::pair<const_in_order_iterator, const_in_order_iterator>>::type
+        equal_range(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return std::make_pair(lower_bound_slot<key_type>(_key), upper_bound_slot<key_type>(_key));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value,
+            std::pair<in_order_iterator, in_order_iterator>>::type
+        equal_range(Key const& _key)
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return std::make_pair(
+                mutable_iterator(lower_bound_slot<key_type>(_key)),
+                mutable_iterator(upper_bound_slot<key_type>(_key)));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, size_type>::type
+        count(Key const& _key) const
+        {
+            std::pair<const_in_order_iterator, const_in_order_iterator> r = equal_range(_key);
+            return static_cast<size_type>(std::distance(r.first, r.second));
+        }
+        
+    private:
+        template<typename Tp, typename Up>
+        bool compare(Tp const& _a, Up const& _b) const
+        {
+            return detail::key_less<Compare>::apply(m_compare, _a, _b);
+        }
+        
+        // ---- value_comp as a function object for the algorithms
+        struct key_compare_type
+        {
+            self_type const* m_tree;
+            
+            explicit key_compare_type(self_type const* _tree) : m_tree(_tree) {}
+            
+            bool operator()(value_type const& _a, value_type const& _b) const
+            { return m_tree->compare(_a, _b); }
+        };
+        
+        // ---- first slot of _a not less than _key. every step keeps
+        //      the half holding the answer by a conditional move, so
+        //      the search does not branch on the comparisons.
+        template<typename Key>
+        std::size_t lower_slot(node_pointer _a, Key const& _key) const
+        {
+            T const* base = _a->values;
+            std::size_t n = _a->count;
+            if(n == 0) return 0;
+            while(n > 1){
+                std::size_t half = n / 2;
+                base = compare(base[half], _key) ? base + half : base;
+                n -= half;
+            }
+            return static_cast<std::size_t>(base - _a->values) + (compare(*base, _key) ? 1 : 0);
+        }
+        
+        // ---- first slot of _a greater than _key
+        template<typename Key>
+        std::size_t upper_slot(node_pointer _a, Key const& _key) const
+        {
+            T const* base = _a->values;
+            std::size_t n = _a->count;
+            if(n == 0) return 0;
+            while(n > 1){
+                std::size_t half = n / 2;
+                base = !compare(_key, base[half]) ? base + half : base;
+                n -= half;
+            }
+            return static_cast<std::size_t>(base - _a->values) + (!compare(_key, *base) ? 1 : 0);
+        }
+        
+        // ---- the bound is the slot found in a node or lies in the
+        //      subtree to its left
+        template<typename Key>
+        const_in_order_iterator lower_bound_slot(Key const& _key) const
+        {
+            const_in_order_iterator r = in_order_end();
+            node_pointer a = m_root;
+            while(a != 0){
+                std::size_t i = lower_slot(a, _key);
+                if(i < a->count) r = const_in_order_iterator(a, i);
+                a = a->leaf ? 0 : child(a, i);
+            }
+            return r;
+        }
+        
+        template<typename Key>
+        const_in_order_iterator upper_bound_slot(Key const& _key) const
+        {
+            const_in_order_iterator r = in_order_end();
+            node_pointer a = m_root;
+            while(a != 0){
+                std::size_t i = upper_slot(a, _key);
+                if(i < a->count) r = const_in_order_iterator(a, i);
+                a = a->leaf ? 0 : child(a, i);
+            }
+            return r;
+        }
+        
+        template<typename Key>
+        const_in_order_iterator find_slot(Key const& _key) const
+        {
+            const_in_order_iterator r = lower_bound_slot(_key);
+            if(r == in_order_end() || compare(_key, *r)) return in_order_end();
+            return r;
+        }
+        
+        static node_pointer child(node_pointer _a, std::size_t _i)
+        {
+            return static_cast<internal_node*>(_a)->children[_i];
+        }
+        
+        static void set_child(node_pointer _a, std::size_t _i, node_pointer _b)
+        {
+            internal_node* p = static_cast<internal_node*>(_a);
+            p->children[_i] = _b;
+            _b->parent = p;
+            _b->position = static_cast<std::uint16_t>(_i);
+        }
+        
+        static in_order_iterator mutable_iterator(const_in_order_iterator _a)
+        {
+            return in_order_iterator(_a.m_node, _a.m_index);
+        }
+        
+        // ---- _a fits right before _hint
+        bool fits_before(const_in_order_iterator _hint, value_type const& _a) const
+        {
+            if(_hint != in_order_end() && compare(*_hint, _a)) return false;
+            if(_hint == in_order_begin()) return true;
+            --_hint;
+            return !compare(_a, *_hint);
+        }
+        
+        // ---- the slot before a value of an internal node is at the
+        //      end of the rightmost leaf of its left subtree
+        in_order_iterator insert_before(const_in_order_iterator _hint, value_type const& _a)
+        {
+            node_pointer a = _hint.m_node;
+            if(a->leaf) return insert_leaf(a, _hint.m_index, _a);
+            a = child(a, _hint.m_index);
+            while(!a->leaf) a = child(a, a->count);
+            return insert_leaf(a, a->count, _a);
+        }
+        
+        in_order_iterator insert_leaf(node_pointer _a, std::size_t _i, value_type const& _v)
+        {
+            in_order_iterator r = insert_value(_a, _i, _v, 0);
+            ++m_size;
+            return r;
+        }
+        
+        // ---- puts _v at slot _i of _a and _right, if any, at child
+        //      _i + 1. a full node is split first; one filled at its
+        //      end keeps all but its last value, so that a sorted
+        //      stream leaves full nodes behind.
+        template<typename Value>
+        in_order_iterator insert_value(node_pointer _a, std::size_t _i, Value&& _v, node_pointer _right)
+        {
+            if(_a->count == node_slots){
+                std::size_t keep = (_i == node_slots) ? node_slots - 1 : node_slots / 2;
+                node_pointer b = split(_a, keep);
+                if(_i > keep){
+                    _i -= keep + 1;
+                    _a = b;
+                }
+            }
+            for(std::size_t k = _a->count; k > _i; --k) _a->values[k] = std::move(_a->values[k - 1]);
+            _a->values[_i] = std::forward<Value>(_v);
+            if(_right != 0){
+                for(std::size_t k = _a->count + 1; k > _i + 1; --k) set_child(_a, k, child(_a, k - 1));
+                set_child(_a, _i + 1, _right);
+            }
+            ++_a->count;
+            return in_order_iterator(_a, _i);
+        }
+        
+        // ---- moves the values after slot _keep of _a to a new node
+        //      on its right and the value at _keep up to the parent
+        node_pointer split(node_pointer _a, std::size_t _keep)
+        {
+            node_pointer b = _a->leaf ? create_leaf() : create_internal();
+            if(_a->parent == 0){
+                node_pointer r = create_internal();
+                set_child(r, 0, _a);
+                m_root = r;
+            }
+            std::size_t n = _a->count - _keep - 1;
+            for(std::size_t k = 0; k < n; ++k) b->values[k] = std::move(_a->values[_keep + 1 + k]);
+            if(!_a->leaf){
+                for(std::size_t k = 0; k <= n; ++k) set_child(b, k, child(_a, _keep + 1 + k));
+            }
+            b->count = static_cast<std::uint16_t>(n);
+            _a->count = static_cast<std::uint16_t>(_keep);
+            if(_a == m_rightmost) m_rightmost = b;
+            insert_value(_a->parent, _a->position, std::move(_a->values[_keep]), b);
+            return b;
+        }
+        
+        // ---- restores the fill of _a and of the parents a merge
+        //      takes a value from, and drops an empty root
+        void rebalance(node_pointer _a)
+        {
+            while(_a != m_root && _a->count < min_count){
+                node_pointer p = _a->parent;
+                std::size_t i = _a->position;
+                node_pointer left = (i > 0) ? child(p, i - 1) : 0;
+                node_pointer right = (i < p->count) ? child(p, i + 1) : 0;
+                if(left != 0 && left->count > min_count){
+                    shift_right(left, _a);
+                    return;
+                }
+                if(right != 0 && right->count > min_count){
+                    shift_left(_a, right);
+                    return;
+                }
+                if(left != 0) merge(left, _a);
+                else          merge(_a, right);
+                _a = p;
+            }
+            if(m_root->count != 0) return;
+            node_pointer r = m_root;
+            if(r->leaf){
+                m_root = 0;
+                m_rightmost = 0;
+            }else{
+                m_root = child(r, 0);
+                m_root->parent = 0;
+                m_root->position = 0;
+            }
+            destroy_node(r);
+        }
+        
+        // ---- the last value of _left goes up to the parent and the
+        //      separator down to the front of _right
+        void shift_right(node_pointer _left, node_pointer _right)
+        {
+            node_pointer p = _right->parent;
+            std::size_t s = _left->position;
+            for(std::size_t k = _right->count; k > 0; --k) _right->values[k] = std::move(_right->values[k - 1]);
+            _right->values[0] = std::move(p->values[s]);
+            p->values[s] = std::move(_left->values[_left->count - 1]);
+            if(!_right->leaf){
+                for(std::size_t k = _right->count + 1; k > 0; --k) set_child(_right, k, child(_right, k - 1));
+                set_child(_right, 0, child(_left, _left->count));
+            }
+            --_left->count;
+            ++_right->count;
+        }
+        
+        // ---- the first value of _right goes up to the parent and
+        //      the separator down to the end of _left
+        void shift_left(node_pointer _left, node_pointer _right)
+        {
+            node_pointer p = _left->parent;
+            std::size_t s = _left->position;
+            _left->values[_left->count] = std::move(p->values[s]);
+            p->values[s] = std::move(_right->values[0]);
+            for(std::size_t k = 1; k < _right->count; ++k) _right->values[k - 1] = std::move(_right->values[k]);
+            if(!_left->leaf){
+                set_child(_left, _left->count + 1, child(_right, 0));
+                for(std::size_t k = 1; k <= _right->count; ++k) set_child(_right, k - 1, child(_right, k));
+            }
+            ++_left->count;
+            --_right->count;
+        }
+        
+        // ---- _left takes the separator and all of _right
+        void merge(node_pointer _left, node_pointer _right)
+        {
+            node_pointer p = _left->parent;
+            std::size_t s = _left->position;
+            std::size_t n = _left->count;
+            assert(n + _right->count + 1 <= node_slots);
+            _left->values[n] = std::move(p->values[s]);
+            for(std::size_t k = 0; k < _right->count; ++k) _left->values[n + 1 + k] = std::move(_right->values[k]);
+            if(!_left->leaf){
+                for(std::size_t k = 0; k <= _right->count; ++k) set_child(_left, n + 1 + k, child(_right, k));
+            }
+            _left->count = static_cast<std::uint16_t>(n + 1 + _right->count);
+            
+            for(std::size_t k = s + 1; k < p->count; ++k) p->values[k - 1] = std::move(p->values[k]);
+            for(std::size_t k = s + 2; k <= p->count; ++k) set_child(p, k - 1, child(p, k));
+            --p->count;
+            if(_right == m_rightmost) m_rightmost = _left;
+            destroy_node(_right);
+        }
+        
+        // ---- height of the subtree of _a, -1 if it is broken
+        int check_node(node_pointer _a, size_type& _n) const
+        {
+            if((_a != m_root && _a->count == 0) || _a->count > node_slots) return -1;
+            _n += _a->count;
+            if(_a->leaf) return 1;
+            int height = -1;
+            for(std::size_t k = 0; k <= _a->count; ++k){
+                node_pointer c = child(_a, k);
+                if(c == 0 || c->parent != _a || c->position != k) return -1;
+                int h = check_node(c, _n);
+                if(h < 0 || (height >= 0 && h != height)) return -1;
+                height = h;
+            }
+            return height + 1;
+        }
+        
+        // ---- allocation
+        node_pointer create_leaf()
+        {
+            node* tmp = m_leaf_allocator.allocate(1);
+            try{
+                m_leaf_allocator.construct(tmp);
+            }
+            catch(...){
+                m_leaf_allocator.deallocate(tmp, 1);
+                throw;
+            }
+            tmp->leaf = true;
+            return tmp;
+        }
+        
+        node_pointer create_internal()
+        {
+            internal_node* tmp = m_internal_allocator.allocate(1);
+            try{
+                m_internal_allocator.construct(tmp);
+            }
+            catch(...){
+                m_internal_allocator.deallocate(tmp, 1);
+                throw;
+            }
+            tmp->leaf = false;
+            return tmp;
+        }
+        
+        void destroy_node(node_pointer _a)
+        {
+            if(_a->leaf){
+                m_leaf_allocator.destroy(_a);
+                m_leaf_allocator.deallocate(_a, 1);
+            }else{
+                internal_node* p = static_cast<internal_node*>(_a);
+                m_internal_allocator.destroy(p);
+                m_internal_allocator.deallocate(p, 1);
+            }
+        }
+        
+        void destroy_subtree(node_pointer _a)
+        {
+            if(!_a->leaf){
+                for(std::size_t k = 0; k <= _a->count; ++k) destroy_subtree(child(_a, k));
+            }
+            destroy_node(_a);
+        }
+        
+        node_pointer copy_node(node_pointer _a)
+        {
+            node_pointer b = _a->leaf ? create_leaf() : create_internal();
+            try{
+                std::copy(_a->values, _a->values + _a->count, b->values);
+                b->count = _a->count;
+                if(!_a->leaf){
+                    for(std::size_t k = 0; k <= _a->count; ++k) set_child(b, k, copy_node(child(_a, k)));
+                }
+            }
+            catch(...){
+                if(!b->leaf){
+                    for(std::size_t k = 0; k <= b->count && child(b, k) != 0; ++k) destroy_subtree(child(b, k));
+                }
+                destroy_node(b);
+                throw;
+            }
+            return b;
+        }
+    };
+}
+
+#endif
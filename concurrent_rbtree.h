@@ -0,0 +1,440 @@
+//-----------------------------------------------------------
+//    concurrent_rbtree.h
+//-----------------------------------------------------------
+#ifndef CREEK_CONCURRENT_RBTREE_H
+#define CREEK_CONCURRENT_RBTREE_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <assert.h>
+
+#include "fwd.h"
+#include "rbtree_path_copy.h"
+
+namespace creek
+{
+    namespace detail
+    {
+        // ---- node
+        //      birth is the write that created the node, 0 once a
+        //      node of the running write has been dropped.
+        template<typename T>
+        struct concurrent_rbtree_node
+        {
+            typedef T value_type;
+            
+            T value;
+            concurrent_rbtree_node* left;
+            concurrent_rbtree_node* right;
+            std::uint64_t birth;
+            path_copy_color color;
+        };
+    }
+    
+    //-----------------------------------------------------------
+    //    class concurrent_rbtree
+    //    red black tree for one writer and any number of readers.
+    //    published nodes are never changed: a write copies the
+    //    nodes on its path and the siblings its rebalancing
+    //    touches, and publishes the new root with one atomic
+    //    store. readers pin the current root in a snapshot and
+    //    search or walk it without locks, they never wait for
+    //    the writer or for each other.
+    //    nodes replaced by a write are retired with the epoch of
+    //    its publication, and freed once every pinned reader has
+    //    seen a later epoch.
+    //
+    //    insert, erase, clear and size belong to the writer thread.
+    //    every reader thread owns a reader, which owns a slot for
+    //    the epoch it has pinned.
+    //-----------------------------------------------------------
+    template<
+        typename T,
+        typename Compare = rbtree_default,
+        typename Allocator = std::allocator<T>>
+    class concurrent_rbtree
+        : private detail::rbtree_path_copy<
+            concurrent_rbtree<T, Compare, Allocator>,
+            detail::concurrent_rbtree_node<T>, Compare>
+    {
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+        typedef Allocator allocator_type;
+        typedef concurrent_rbtree<T, Compare, Allocator> self_type;
+        
+    private:
+        typedef detail::concurrent_rbtree_node<T> node;
+        typedef detail::rbtree_path_copy<self_type, node, Compare> base_type;
+        typedef typename base_type::color_t color_t;
+        
+        typedef node* node_pointer;
+        typedef typename allocator_type::template rebind<node>::other
+            node_allocator_type;
+        
+        // ---- reader slot
+        //      padded so that two readers never share a cache line.
+        static std::uint64_t const idle = ~std::uint64_t(0);
+        
+        struct slot
+        {
+            std::atomic<std::uint64_t> m_epoch;
+            bool m_owned;
+            char m_pad[128 - sizeof(std::atomic<std::uint64_t>) - sizeof(bool)];
+            
+            slot() : m_epoch(idle), m_owned(false) {}
+        };
+        
+        struct retired_node
+        {
+            std::uint64_t epoch;
+            node_pointer a;
+        };
+        
+        using base_type::max_depth;
+        using base_type::m_compare;
+        using base_type::compare;
+        using base_type::is_red;
+        
+        friend base_type;
+        
+        std::atomic<node_pointer> m_root;
+        std::atomic<std::uint64_t> m_epoch;
+        mutable std::mutex m_slot_mutex;
+        mutable std::vector<std::unique_ptr<slot>> m_slots;
+        
+        // writer state
+        std::uint64_t m_write;
+        std::vector<node_pointer> m_fresh;
+        std::vector<node_pointer> m_pending;
+        std::deque<retired_node> m_retired;
+        size_type m_size;
+        node_allocator_type m_allocator;
+        
+    public:
+        class snapshot;
+        class reader;
+        
+        typedef typename base_type::iterator_type const_iterator;
+        
+        //---- snapshot
+        //     one version of the tree, kept alive until destruction.
+        class snapshot
+        {
+        private:
+            concurrent_rbtree const* m_tree;
+            slot* m_slot;
+            node_pointer m_root;
+            
+            friend class reader;
+            
+            snapshot(concurrent_rbtree const* _tree, slot* _slot, node_pointer _root)
+                : m_tree(_tree), m_slot(_slot), m_root(_root)
+            {}
+            
+            snapshot(snapshot const&) = delete;
+            snapshot& operator=(snapshot const&) = delete;
+            
+        public:
+            snapshot(snapshot&& _a)
+                : m_tree(_a.m_tree), m_slot(_a.m_slot), m_root(_a.m_root)
+            {
+                _a.m_slot = 0;
+            }
+            
+            ~snapshot()
+            {
+                if(m_slot != 0) m_slot->m_epoch.store(idle, std::memory_order_release);
+            }
+            
+            bool empty() const { return m_root == 0; }
+            
+            // ---- first element equivalent to _key, 0 if none
+            template<typename Key>
+            value_type const* find(Key const& _key) const
+            {
+                node_pointer a = m_tree->lower_bound_node(m_root, _key);
+                if(a == 0 || m_tree->compare(_key, a->value)) return 0;
+                return &a->value;
+            }
+            
+            template<typename Key>
+            bool contains(Key const& _key) const { return find(_key) != 0; }
+            
+            const_iterator begin() const { return base_type::begin_iterator(m_root); }
+            
+            const_iterator end() const { return const_iterator(); }
+            
+            template<typename Key>
+            const_iterator lower_bound(Key const& _key) const
+            {
+                return m_tree->lower_bound_iterator(m_root, _key);
+            }
+        };
+        
+        //---- reader
+        //     owns a slot of the tree, one per reader thread.
+        class reader
+        {
+        private:
+            concurrent_rbtree const* m_tree;
+            slot* m_slot;
+            
+            reader(reader const&) = delete;
+            reader& operator=(reader const&) = delete;
+            
+        public:
+            explicit reader(concurrent_rbtree const& _tree)
+                : m_tree(&_tree), m_slot(_tree.acquire_slot())
+            {}
+            
+            ~reader()
+            {
+                assert(m_slot->m_epoch.load() == idle);
+                m_tree->release_slot(m_slot);
+            }
+            
+            // ---- pin the current version, one snapshot at a time
+            snapshot pin() const
+            {
+                assert(m_slot->m_epoch.load() == idle);
+                m_slot->m_epoch.store(m_tree->m_epoch.load());
+                return snapshot(m_tree, m_slot, m_tree->m_root.load());
+            }
+        };
+        
+        explicit concurrent_rbtree(Compare const& _cmp = Compare())
+            : base_type(_cmp),
+              m_root(0), m_epoch(1), m_slot_mutex(), m_slots(),
+              m_write(0), m_fresh(), m_pending(), m_retired(),
+              m_size(0), m_allocator()
+        {}
+        
+        concurrent_rbtree(self_type const&) = delete;
+        self_type& operator=(self_type const&) = delete;
+        
+        ~concurrent_rbtree()
+        {
+            destroy_subtree(m_root.load());
+            for(retired_node const& r : m_retired) destroy_node(r.a);
+        }
+        
+        size_type size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        
+        Compare const& value_comp() const { return m_compare; }
+        
+        // ---- insert
+        //      after the elements equivalent to _a.
+        void insert(value_type const& _a)
+        {
+            begin_write();
+            try{
+                node_pointer k = create_node(_a);
+                k->color = color_t::red;
+                node_pointer r = this->insert_node(m_root.load(std::memory_order_relaxed), k);
+                r->color = color_t::black;
+                publish(r);
+            }
+            catch(...){
+                abort_write();
+                throw;
+            }
+            ++m_size;
+        }
+        
+        // ---- erase
+        //      the first element equivalent to _key, false if none.
+        template<typename Key>
+        bool erase(Key const& _key)
+        {
+            node_pointer path[max_depth + 2];
+            std::size_t depth = this->find_path(m_root.load(std::memory_order_relaxed), _key, path);
+            if(depth == 0) return false;
+            
+            begin_write();
+            try{
+                publish(this->erase_node(path, depth));
+            }
+            catch(...){
+                abort_write();
+                throw;
+            }
+            --m_size;
+            return true;
+        }
+        
+        void clear()
+        {
+            begin_write();
+            try{
+                std::vector<node_pointer> stack;
+                node_pointer r = m_root.load(std::memory_order_relaxed);
+                if(r != 0) stack.push_back(r);
+                while(!stack.empty()){
+                    node_pointer a = stack.back();
+                    stack.pop_back();
+                    if(a->left != 0) stack.push_back(a->left);
+                    if(a->right != 0) stack.push_back(a->right);
+                    m_pending.push_back(a);
+                }
+            }
+            catch(...){
+                abort_write();
+                throw;
+            }
+            publish(0);
+            m_size = 0;
+        }
+        
+        // ---- nodes waiting for readers, for tests
+        size_type retired() const { return m_retired.size(); }
+        
+        // ---- writer side check of the current version
+        bool check_invariant() const
+        {
+            node_pointer r = m_root.load(std::memory_order_relaxed);
+            if(r != 0 && r->color != color_t::black) return false;
+            std::size_t count = 0;
+            return this->check_node(r, count) >= 0 && count == m_size;
+        }
+        
+    private:
+        // ---- slots
+        slot* acquire_slot() const
+        {
+            std::lock_guard<std::mutex> lock(m_slot_mutex);
+            for(std::unique_ptr<slot> const& s : m_slots){
+                if(!s->m_owned){
+                    s->m_owned = true;
+                    return s.get();
+                }
+            }
+            m_slots.push_back(std::unique_ptr<slot>(new slot()));
+            m_slots.back()->m_owned = true;
+            return m_slots.back().get();
+        }
+        
+        void release_slot(slot* _s) const
+        {
+            std::lock_guard<std::mutex> lock(m_slot_mutex);
+            _s->m_owned = false;
+        }
+        
+        // ---- oldest pinned epoch, idle if none
+        std::uint64_t oldest_pin() const
+        {
+            std::uint64_t oldest = idle;
+            std::lock_guard<std::mutex> lock(m_slot_mutex);
+            for(std::unique_ptr<slot> const& s : m_slots){
+                std::uint64_t e = s->m_epoch.load();
+                if(e < oldest) oldest = e;
+            }
+            return oldest;
+        }
+        
+        // ---- writes
+        void begin_write()
+        {
+            ++m_write;
+            assert(m_fresh.empty() && m_pending.empty());
+        }
+        
+        // a reader that pins after the epoch is advanced loads the
+        // new root, so the replaced nodes are retired with the
+        // epoch before it.
+        void publish(node_pointer _root)
+        {
+            assert(_root == 0 || _root->color == color_t::black);
+            m_root.store(_root);
+            std::uint64_t epoch = m_epoch.fetch_add(1);
+            
+            for(node_pointer a : m_fresh){
+                if(a->birth == 0) destroy_node(a);
+            }
+            m_fresh.clear();
+            for(node_pointer a : m_pending) m_retired.push_back(retired_node{epoch, a});
+            m_pending.clear();
+            
+            std::uint64_t oldest = oldest_pin();
+            while(!m_retired.empty() && m_retired.front().epoch < oldest){
+                destroy_node(m_retired.front().a);
+                m_retired.pop_front();
+            }
+        }
+        
+        // nothing was published, the old version stays complete.
+        void abort_write()
+        {
+            for(node_pointer a : m_fresh) destroy_node(a);
+            m_fresh.clear();
+            m_pending.clear();
+        }
+        
+        bool is_fresh(node_pointer _a) const { return _a->birth == m_write; }
+        
+        // ---- a node of this write that may be changed, copies
+        //      a published node and retires it.
+        node_pointer own(node_pointer _a)
+        {
+            if(is_fresh(_a)) return _a;
+            node_pointer b = create_node(_a->value);
+            b->left = _a->left;
+            b->right = _a->right;
+            b->color = _a->color;
+            m_pending.push_back(_a);
+            return b;
+        }
+        
+        // ---- a node that leaves the tree
+        void drop(node_pointer _a)
+        {
+            if(is_fresh(_a)) _a->birth = 0;
+            else m_pending.push_back(_a);
+        }
+        
+        // ---- allocation
+        node_pointer create_node(value_type const& _v)
+        {
+            m_fresh.reserve(m_fresh.size() + 1);
+            node_pointer tmp = m_allocator.allocate(1);
+            try{
+                m_allocator.construct(tmp, node{_v, 0, 0, m_write, color_t::black});
+            }
+            catch(...){
+                m_allocator.deallocate(tmp, 1);
+                throw;
+            }
+            m_fresh.push_back(tmp);
+            return tmp;
+        }
+        
+        void destroy_node(node_pointer _a)
+        {
+            m_allocator.destroy(_a);
+            m_allocator.deallocate(_a, 1);
+        }
+        
+        void destroy_subtree(node_pointer _a)
+        {
+            std::vector<node_pointer> stack;
+            if(_a != 0) stack.push_back(_a);
+            while(!stack.empty()){
+                node_pointer a = stack.back();
+                stack.pop_back();
+                if(a->left != 0) stack.push_back(a->left);
+                if(a->right != 0) stack.push_back(a->right);
+                destroy_node(a);
+            }
+        }
+    };
+}
+
+#endif
@@ -7,7 +7,9 @@
 #include <functional>
 #include <numeric>
 #include <cstdlib>
+#include <utility>
 #include "tree.h"
+#include "fold.h"
 
 
 std::string GetToken(std::string::const_iterator& _it, std::string::const_iterator _end);
@@ -38,9 +40,9 @@ bool Parse(std::string const& _strexpr,
             }
             
             if(treetmp.empty())
-                curr = treetmp.insert(curr, token);
+                curr = treetmp.insert(curr, std::move(token));
             else
-                curr = treetmp.append_child(curr, token);
+                curr = treetmp.append_child(curr, std::move(token));
         }else if(token == ")"){
             if(treetmp.empty()){
                 return false;
@@ -51,7 +53,7 @@ bool Parse(std::string const& _strexpr,
             if(treetmp.empty()){
                 return false;
             }
-            treetmp.append_child(curr, token);
+            treetmp.append_child(curr, std::move(token));
         }
         
     }
@@ -63,7 +65,7 @@ bool Parse(std::string const& _strexpr,
     if(!CheckTree(treetmp)){
         return false;
     }
-    _tree = treetmp;
+    _tree = std::move(treetmp);
     return true;
 }
 
@@ -130,85 +132,32 @@ bool CheckTree(creek::tree<std::string> const& _tree)
     return true;
 }
 
-double Calculate(creek::tree<std::string> const& _tree)
+double CalculateLeaf(std::string const& _token)
 {
-    typedef creek::tree<std::string>::const_pre_order_iterator const_pre_order_iterator;
-    typedef creek::tree<std::string>::const_child_order_iterator const_child_order_iterator;
-    typedef creek::tree<double>::pre_order_iterator pre_order_iterator;
-    typedef creek::tree<std::string>::const_reverse_pre_order_iterator const_reverse_pre_order_iterator;
-    typedef creek::tree<double>::reverse_pre_order_iterator reverse_pre_order_iterator;
-        
-    creek::tree<double> numtree;
-    {
-        const_pre_order_iterator it = _tree.pre_order_begin();
-        const_pre_order_iterator end = _tree.pre_order_end();
-        pre_order_iterator jt = numtree.insert(numtree.pre_order_begin(), 0.0);
-        while(it != end){
-            const_child_order_iterator cit = creek::child_order_begin(it);
-            const_child_order_iterator cend = creek::child_order_end(it);
-            while(cit != cend){
-                numtree.append_child(jt, 0.0);
-                ++cit;
-            }
-            ++it;
-            ++jt;
-        }
-    }
-    
-    {
-        const_reverse_pre_order_iterator it = _tree.pre_order_rbegin();
-        const_reverse_pre_order_iterator end = _tree.pre_order_rend();
-        reverse_pre_order_iterator jt = numtree.pre_order_rbegin();
-        while(it != end){
-            if(creek::child_order_begin(it) == creek::child_order_end(it)){
-                char* err;
-                *jt = std::strtod((*it).c_str(), &err);
-            }else{
-                char op = (*it)[0];
-                switch(op){
-                    case '+':
-                    {
-                        double tmp = std::accumulate(creek::child_order_begin(jt), creek::child_order_end(jt), 0.0, std::plus<double>());
-                        *jt = tmp;
-                        break;
-                    }
-                    case '-':
-                    {
-                        std::size_t size = std::distance(creek::child_order_begin(jt), creek::child_order_end(jt));
-                        if(size == 1){
-                            *jt = - (*(creek::child_order_begin(jt)));
-                        }else{
-                            double tmp = std::accumulate(++(creek::child_order_begin(jt)), creek::child_order_end(jt), *(creek::child_order_begin(jt)), std::minus<double>());
-                            *jt = tmp;
-                        }
-                        break;
-                    }
-                    case '*':
-                    {
-                        double tmp = std::accumulate(creek::child_order_begin(jt), creek::child_order_end(jt), 1.0, std::multiplies<double>());;
-                        *jt = tmp;
-                        break;
-                    }
-                    case '/':
-                    {
-                        std::size_t size = std::distance(creek::child_order_begin(jt), creek::child_order_end(jt));
-                        if(size == 1){
-                            *jt = 1.0 / (*(creek::child_order_begin(jt)));
-                        }else{
-                            double tmp = std::accumulate(++(creek::child_order_begin(jt)), creek::child_order_end(jt), *(creek::child_order_begin(jt)), std::divides<double>());
-                            *jt = tmp;
-                        }
-                        break;
-                    }
-                }
-            }
-            
-            ++it;
-            ++jt;
-        }
-        
-        return *(numtree.pre_order_begin());
+    char* err;
+    return std::strtod(_token.c_str(), &err);
+}
+
+double CalculateNode(std::string const& _op, double const* _first, double const* _last)
+{
+    switch(_op[0]){
+        case '+':
+            return std::accumulate(_first, _last, 0.0, std::plus<double>());
+        case '-':
+            if(_last - _first == 1) return - (*_first);
+            return std::accumulate(_first + 1, _last, *_first, std::minus<double>());
+        case '*':
+            return std::accumulate(_first, _last, 1.0, std::multiplies<double>());
+        case '/':
+            if(_last - _first == 1) return 1.0 / (*_first);
+            return std::accumulate(_first + 1, _last, *_first, std::divides<double>());
     }
+    return 0.0;
+}
+
+double Calculate(creek::tree<std::string> const& _tree)
+{
+    return creek::fold_up(_tree, &CalculateLeaf, &CalculateNode);
 }
 
 int main()
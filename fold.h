@@ -0,0 +1,237 @@
+//-----------------------------------------------------------
+//    fold.h
+//-----------------------------------------------------------
+#ifndef CREEK_FOLD_H
+#define CREEK_FOLD_H
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+#include <assert.h>
+
+#include "fwd.h"
+#include "parallel.h"
+#include "visitor.h"
+
+namespace creek
+{
+    namespace detail
+    {
+        template<typename Tree, typename LeafFunction>
+        struct fold_traits
+        {
+            typedef typename std::remove_const<Tree>::type tree_type;
+            typedef multiway_tree_traits<tree_type> traits_type;
+            typedef typename traits_type::sub_iterator sub_iterator;
+            typedef typename std::conditional<std::is_const<Tree>::value,
+                typename tree_type::value_type const&,
+                decltype(traits_type::dereference(std::declval<sub_iterator>()))>::type reference;
+            typedef typename std::decay<
+                decltype(std::declval<LeafFunction&>()(std::declval<reference>()))>::type result_type;
+        };
+        
+        //-----------------------------------------------------------
+        //    class subtree_folder
+        //    the results of the children of a node are kept side by
+        //    side in a side array and handed to the combine function
+        //    as a range. large children are folded by other tasks.
+        //-----------------------------------------------------------
+        template<typename Tree, typename LeafFunction, typename CombineFunction>
+        class subtree_folder
+        {
+        public:
+            typedef fold_traits<Tree, LeafFunction> fold_traits_type;
+            typedef typename fold_traits_type::result_type result_type;
+            
+        private:
+            typedef parallel::detail::subtree_probe<Tree> probe_type;
+            typedef typename probe_type::traits_type traits_type;
+            typedef typename probe_type::sub_iterator sub_iterator;
+            typedef typename probe_type::probe probe;
+            typedef typename fold_traits_type::reference reference;
+            
+            //---- frame
+            //     a node on the path of the current task whose children
+            //     are being folded; m_slot is the child this task goes on with.
+            struct frame
+            {
+                sub_iterator m_node;
+                std::vector<result_type> m_results;
+                std::size_t m_slot;
+                std::unique_ptr<parallel::task_group> m_group;
+            };
+            
+            //---- entry
+            //     explicit stack of the sequential fold.
+            struct entry
+            {
+                sub_iterator m_node;
+                sub_iterator m_next;
+                std::size_t m_base;
+            };
+            
+            probe_type m_probe;
+            LeafFunction& m_leaf;
+            CombineFunction& m_combine;
+            parallel::thread_pool& m_pool;
+            
+        public:
+            subtree_folder(Tree& _tree, LeafFunction& _leaf, CombineFunction& _combine,
+                std::size_t _threshold, parallel::thread_pool& _pool)
+                : m_probe(_tree, _threshold), m_leaf(_leaf), m_combine(_combine), m_pool(_pool)
+            {}
+            
+            result_type fold(sub_iterator _a)
+            {
+                std::vector<frame> path;
+                std::vector<probe> children;
+                std::vector<std::pair<sub_iterator, result_type*>> batch;
+                result_type r;
+                while(1){
+                    probe_type::children(_a, children);
+                    if(children.empty()){
+                        r = leaf(_a);
+                        break;
+                    }
+                    if(children.size() > 1) m_probe.measure(children);
+                    
+                    bool is_large = false;
+                    for(std::size_t i = 0; i < children.size(); ++i)
+                        is_large = is_large || (children[i].m_cursor != sub_iterator());
+                    if(!is_large){
+                        r = fold_sequential(_a);
+                        break;
+                    }
+                    
+                    path.push_back(frame());
+                    frame& f = path.back();
+                    f.m_node = _a;
+                    f.m_results.resize(children.size());
+                    f.m_slot = children.size();
+                    
+                    //---- large children go to other tasks, one is kept
+                    std::size_t batch_count = 0;
+                    batch.clear();
+                    for(std::size_t i = 0; i < children.size(); ++i){
+                        probe const& p = children[i];
+                        if(p.m_cursor != sub_iterator()){
+                            if(f.m_slot != children.size())
+                                spawn_fold(f, children[f.m_slot].m_root, &f.m_results[f.m_slot]);
+                            f.m_slot = i;
+                        }else{
+                            batch.push_back(std::make_pair(p.m_root, &f.m_results[i]));
+                            batch_count += p.m_count;
+                            if(batch_count >= m_probe.grain()){
+                                spawn_batch(f, batch);
+                                batch.clear();
+                                batch_count = 0;
+                            }
+                        }
+                    }
+                    for(std::size_t i = 0; i < batch.size(); ++i)
+                        *(batch[i].second) = fold_sequential(batch[i].first);
+                    _a = children[f.m_slot].m_root;
+                }
+                
+                while(!path.empty()){
+                    frame& f = path.back();
+                    f.m_results[f.m_slot] = std::move(r);
+                    if(f.m_group) f.m_group->wait();
+                    r = combine(f.m_node, f.m_results.data(), f.m_results.data() + f.m_results.size());
+                    path.pop_back();
+                }
+                return r;
+            }
+            
+            result_type fold_sequential(sub_iterator _top)
+            {
+                if(traits_type::first_child(_top) == sub_iterator()) return leaf(_top);
+                
+                std::vector<entry> stack;
+                std::vector<result_type> values;
+                entry e = {_top, traits_type::first_child(_top), 0};
+                stack.push_back(e);
+                while(!stack.empty()){
+                    if(stack.back().m_next != sub_iterator()){
+                        sub_iterator c = stack.back().m_next;
+                        stack.back().m_next = traits_type::younger_sibling(c);
+                        entry child = {c, traits_type::first_child(c), values.size()};
+                        stack.push_back(child);
+                        continue;
+                    }
+                    
+                    entry const top = stack.back();
+                    stack.pop_back();
+                    result_type r = (values.size() == top.m_base)
+                        ? leaf(top.m_node)
+                        : combine(top.m_node, values.data() + top.m_base, values.data() + values.size());
+                    values.erase(values.begin() + top.m_base, values.end());
+                    values.push_back(std::move(r));
+                }
+                return std::move(values.back());
+            }
+            
+        private:
+            result_type leaf(sub_iterator _a)
+            {
+                return m_leaf(static_cast<reference>(traits_type::dereference(_a)));
+            }
+            
+            result_type combine(sub_iterator _a, result_type const* _first, result_type const* _last)
+            {
+                return m_combine(static_cast<reference>(traits_type::dereference(_a)), _first, _last);
+            }
+            
+            parallel::task_group& group(frame& _f)
+            {
+                if(!_f.m_group) _f.m_group.reset(new parallel::task_group(m_pool));
+                return *_f.m_group;
+            }
+            
+            void spawn_fold(frame& _f, sub_iterator _a, result_type* _result)
+            {
+                subtree_folder* self = this;
+                group(_f).run([self, _a, _result](){ *_result = self->fold(_a); });
+            }
+            
+            void spawn_batch(frame& _f, std::vector<std::pair<sub_iterator, result_type*>> const& _batch)
+            {
+                subtree_folder* self = this;
+                std::vector<std::pair<sub_iterator, result_type*>> copy(_batch);
+                group(_f).run([self, copy](){
+                    for(std::size_t i = 0; i < copy.size(); ++i)
+                        *(copy[i].second) = self->fold_sequential(copy[i].first);
+                });
+            }
+        };
+    }
+    
+    //-----------------------------------------------------------
+    //    fold_up
+    //    bottom up reduction. a leaf yields _leaf(value), any other
+    //    node _combine(value, first, last) where [first, last) are
+    //    the results of its children in child order. subtrees with
+    //    more than _threshold nodes are folded in parallel.
+    //    returns a value initialized result for an empty tree.
+    //-----------------------------------------------------------
+    template<typename Tree, typename LeafFunction, typename CombineFunction>
+    typename detail::fold_traits<Tree, LeafFunction>::result_type
+    fold_up(Tree& _tree, LeafFunction _leaf, CombineFunction _combine,
+        std::size_t _threshold = 1024, parallel::thread_pool& _pool = parallel::default_pool())
+    {
+        typedef typename detail::fold_traits<Tree, LeafFunction>::result_type result_type;
+        static_assert(is_multiway_tree<typename std::remove_const<Tree>::type>::value,
+            "fold_up needs multiway_tree_traits");
+        static_assert(!std::is_same<result_type, bool>::value,
+            "fold_up passes the child results as a pointer range, use char for flags");
+        
+        if(detail::tree_empty(_tree, 0)) return result_type();
+        detail::subtree_folder<Tree, LeafFunction, CombineFunction>
+            folder(_tree, _leaf, _combine, _threshold, _pool);
+        return folder.fold(detail::tree_root(_tree, 0));
+    }
+}//---- namespace creek
+
+#endif
@@ -0,0 +1,491 @@
+//-----------------------------------------------------------
+//    frozen_tree.h
+//-----------------------------------------------------------
+#ifndef CREEK_FROZEN_TREE_H
+#define CREEK_FROZEN_TREE_H
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <assert.h>
+
+#include "fwd.h"
+#include "iterator.h"
+
+namespace creek
+{
+    //-----------------------------------------------------------
+    //    class frozen_tree
+    //    immutable snapshot of a multiway tree. the values are
+    //    stored contiguously in pre order, the links beside them
+    //    as 32 bit indices. in pre order the first child of node i
+    //    is i + 1 and its next sibling is i + subtree size, so only
+    //    the parent, the subtree size, the last child and the older
+    //    sibling are stored. index size() is the foot.
+    //-----------------------------------------------------------
+    template<typename Tp>
+    class frozen_tree
+    {
+    public:
+        typedef frozen_tree self_type;
+        typedef Tp value_type;
+        typedef value_type const& reference;
+        typedef value_type const& const_reference;
+        typedef unsigned int size_type;
+        typedef value_type const* pointer;
+        typedef value_type const* const_pointer;
+        typedef std::uint32_t index_type;
+        
+    private:
+        static index_type const npos = static_cast<index_type>(-1);
+        
+        struct link
+        {
+            index_type m_parent;
+            index_type m_size;
+            index_type m_last_child;
+            index_type m_older_sibling;
+        };
+        
+        struct position
+        {
+            frozen_tree const* m_tree;
+            index_type m_index;
+            
+            position()
+                : m_tree(), m_index()
+            {}
+            
+            position(frozen_tree const* _tree, index_type _index)
+                : m_tree((_index != npos) ? _tree : 0), m_index((_index != npos) ? _index : 0)
+            {}
+            
+            bool operator==(position const& _other) const
+            { return (m_index == _other.m_index) && (m_tree == _other.m_tree); }
+            
+            bool operator!=(position const& _other) const
+            { return !(*this == _other); }
+        };
+        
+        //---- position in a child list
+        //     the end of the children of p is index p + size(p).
+        struct child_position
+        {
+            frozen_tree const* m_tree;
+            index_type m_parent;
+            index_type m_index;
+            
+            child_position()
+                : m_tree(), m_parent(), m_index()
+            {}
+            
+            child_position(position _pos)
+                : m_tree(_pos.m_tree),
+                m_parent((_pos.m_tree != 0) ? _pos.m_tree->m_links[_pos.m_index].m_parent : npos),
+                m_index(_pos.m_index)
+            {}
+            
+            child_position(frozen_tree const* _tree, index_type _parent, index_type _index)
+                : m_tree(_tree), m_parent(_parent), m_index(_index)
+            {}
+            
+            operator position() const
+            {
+                if(m_tree == 0 || (m_parent != npos &&
+                    m_index == m_parent + m_tree->m_links[m_parent].m_size))
+                    return position();
+                return position(m_tree, m_index);
+            }
+            
+            bool operator==(child_position const& _other) const
+            {
+                return (m_index == _other.m_index) && (m_parent == _other.m_parent)
+                    && (m_tree == _other.m_tree);
+            }
+            
+            bool operator!=(child_position const& _other) const
+            { return !(*this == _other); }
+        };
+        
+        typedef position sub_iterator;
+        
+        friend struct multiway_tree_traits<frozen_tree<value_type>>;
+        template<typename Iterator, typename Sfinae>
+        friend struct tree_iterator_traits;
+        template<bool IsConst, typename Traversal, typename T>
+        friend tree_iterator<IsConst, child_order_tag, frozen_tree<T>>
+        child_order_begin(tree_iterator<IsConst, Traversal, frozen_tree<T>> _it);
+        template<bool IsConst, typename Traversal, typename T>
+        friend tree_iterator<IsConst, child_order_tag, frozen_tree<T>>
+        child_order_end(tree_iterator<IsConst, Traversal, frozen_tree<T>> _it);
+        
+        std::vector<value_type> m_values;
+        std::vector<link> m_links;
+        
+    public:
+        frozen_tree()
+            : m_values(), m_links()
+        {
+            link_foot();
+        }
+        
+        //---- snapshot
+        //     one pre order pass over _tree. the open ancestors are
+        //     kept on a stack to find the parent index of each node.
+        template<typename Tree>
+        explicit frozen_tree(Tree const& _tree)
+            : m_values(), m_links()
+        {
+            typedef typename Tree::const_pre_order_iterator tree_iterator_type;
+            typedef typename tree_iterator_type::sub_iterator tree_sub_iterator;
+            
+            m_values.reserve(_tree.size());
+            m_links.reserve(_tree.size() + 1);
+            std::vector<std::pair<tree_sub_iterator, index_type>> open;
+            
+            tree_iterator_type it = _tree.pre_order_begin(), end = _tree.pre_order_end();
+            while(it != end){
+                index_type const i = static_cast<index_type>(m_values.size());
+                tree_sub_iterator const p = creek::parent(it).base();
+                while(!open.empty() && !(open.back().first == p)){
+                    m_links[open.back().second].m_size = i - open.back().second;
+                    open.pop_back();
+                }
+                
+                link tmp = {npos, 1, npos, npos};
+                if(!open.empty()){
+                    index_type const pi = open.back().second;
+                    tmp.m_parent = pi;
+                    tmp.m_older_sibling = m_links[pi].m_last_child;
+                    m_links[pi].m_last_child = i;
+                }
+                m_values.push_back(*it);
+                m_links.push_back(tmp);
+                open.push_back(std::make_pair(it.base(), i));
+                ++it;
+            }
+            
+            index_type const n = static_cast<index_type>(m_values.size());
+            while(!open.empty()){
+                m_links[open.back().second].m_size = n - open.back().second;
+                open.pop_back();
+            }
+            link_foot();
+        }
+        
+        //---- size
+        size_type size() const
+        { return static_cast<size_type>(m_values.size()); }
+        
+        //---- empty
+        bool empty() const
+        { return m_values.empty(); }
+        
+        //---- subtree size
+        //     number of nodes in the subtree at _pos, _pos included.
+        template<typename Iterator>
+        size_type subtree_size(Iterator _pos) const
+        {
+            position a = _pos.base();
+            assert(a.m_tree == this);
+            return m_links[a.m_index].m_size;
+        }
+        
+        //---- index
+        //     pre order index of _pos.
+        template<typename Iterator>
+        index_type index(Iterator _pos) const
+        {
+            position a = _pos.base();
+            assert(a.m_tree == this);
+            return a.m_index;
+        }
+        
+        //---- values
+        //     all values in pre order.
+        std::vector<value_type> const& values() const
+        { return m_values; }
+        
+        void swap(self_type& _other)
+        {
+            m_values.swap(_other.m_values);
+            m_links.swap(_other.m_links);
+        }
+        
+    private:
+        //---- link foot
+        //     the foot follows the root as its younger sibling,
+        //     like the foot node of creek::tree.
+        void link_foot()
+        {
+            link tmp = {npos, 0, npos, m_values.empty() ? npos : 0};
+            m_links.push_back(tmp);
+        }
+        
+        index_type foot_index() const
+        { return static_cast<index_type>(m_values.size()); }
+        
+    public:
+        //---- iterators
+        //     a frozen tree is never modified, so all iterators are const.
+        typedef tree_iterator<true, pre_order_tag,   self_type> const_pre_order_iterator;
+        typedef tree_iterator<true, post_order_tag,  self_type> const_post_order_iterator;
+        typedef tree_iterator<true, child_order_tag, self_type> const_child_order_iterator;
+        typedef const_pre_order_iterator pre_order_iterator;
+        typedef const_post_order_iterator post_order_iterator;
+        typedef const_child_order_iterator child_order_iterator;
+        
+        typedef tree_iterator<true, reverse_tag<pre_order_tag>,   self_type> const_reverse_pre_order_iterator;
+        typedef tree_iterator<true, reverse_tag<post_order_tag>,  self_type> const_reverse_post_order_iterator;
+        typedef tree_iterator<true, reverse_tag<child_order_tag>, self_type> const_reverse_child_order_iterator;
+        typedef const_reverse_pre_order_iterator reverse_pre_order_iterator;
+        typedef const_reverse_post_order_iterator reverse_post_order_iterator;
+        typedef const_reverse_child_order_iterator reverse_child_order_iterator;
+        
+        //---- pre order begin end
+        const_pre_order_iterator pre_order_begin() const
+        { return const_pre_order_iterator(position(this, 0)); }
+        
+        const_pre_order_iterator pre_order_end() const
+        { return const_pre_order_iterator(position(this, foot_index())); }
+        
+        //---- post order begin end
+        //     the first node in post order is the leftmost leaf,
+        //     which is the first leaf in pre order.
+        const_post_order_iterator post_order_begin() const
+        {
+            index_type i = 0;
+            while(i < foot_index() && m_links[i].m_size > 1)
+                ++i;
+            return const_post_order_iterator(position(this, i));
+        }
+        
+        const_post_order_iterator post_order_end() const
+        { return const_post_order_iterator(position(this, foot_index())); }
+        
+        //---- pre order rbegin rend
+        const_reverse_pre_order_iterator pre_order_rbegin() const
+        { return const_reverse_pre_order_iterator(pre_order_end().base()); }
+        const_reverse_pre_order_iterator pre_order_rend() const
+        { return const_reverse_pre_order_iterator(pre_order_begin().base()); }
+        
+        //---- post order rbegin rend
+        const_reverse_post_order_iterator post_order_rbegin() const
+        { return const_reverse_post_order_iterator(post_order_end().base()); }
+        const_reverse_post_order_iterator post_order_rend() const
+        { return const_reverse_post_order_iterator(post_order_begin().base()); }
+    };
+    
+    template<typename Tp>
+    typename frozen_tree<Tp>::index_type const frozen_tree<Tp>::npos;
+    
+    //-----------------------------------------------------------
+    //    multiway tree traits
+    //-----------------------------------------------------------
+    template<typename T>
+    struct multiway_tree_traits<frozen_tree<T>>
+    {
+        typedef typename frozen_tree<T>::sub_iterator sub_iterator;
+        typedef typename frozen_tree<T>::value_type value_type;
+        typedef typename frozen_tree<T>::index_type index_type;
+        
+        static value_type const& dereference(sub_iterator _a)
+        {
+            assert(_a.m_tree != 0);
+            return _a.m_tree->m_values[_a.m_index];
+        }
+        
+        static sub_iterator parent(sub_iterator _a)
+        {
+            assert(_a != sub_iterator());
+            return sub_iterator(_a.m_tree, _a.m_tree->m_links[_a.m_index].m_parent);
+        }
+        
+        static sub_iterator first_child(sub_iterator _a)
+        {
+            assert(_a != sub_iterator());
+            if(_a.m_tree->m_links[_a.m_index].m_size > 1)
+                return sub_iterator(_a.m_tree, _a.m_index + 1);
+            return sub_iterator();
+        }
+        
+        static sub_iterator last_child(sub_iterator _a)
+        {
+            assert(_a != sub_iterator());
+            return sub_iterator(_a.m_tree, _a.m_tree->m_links[_a.m_index].m_last_child);
+        }
+        
+        static sub_iterator older_sibling(sub_iterator _a)
+        {
+            assert(_a != sub_iterator());
+            return sub_iterator(_a.m_tree, _a.m_tree->m_links[_a.m_index].m_older_sibling);
+        }
+        
+        static sub_iterator younger_sibling(sub_iterator _a)
+        {
+            assert(_a != sub_iterator());
+            auto const& links = _a.m_tree->m_links;
+            index_type const p = links[_a.m_index].m_parent;
+            index_type const next = _a.m_index + links[_a.m_index].m_size;
+            if(p == frozen_tree<T>::npos){
+                //---- the root is followed by the foot, the foot by nothing
+                return (_a.m_index != next) ? sub_iterator(_a.m_tree, next) : sub_iterator();
+            }
+            if(next < p + links[p].m_size)
+                return sub_iterator(_a.m_tree, next);
+            return sub_iterator();
+        }
+    };
+    
+    //-----------------------------------------------------------
+    //    pre order traits
+    //    pre order is the storage order, so the iterator is
+    //    random access and a step is an index increment.
+    //-----------------------------------------------------------
+    template<bool IsConst, typename T>
+    struct tree_iterator_traits<
+        tree_iterator<IsConst, pre_order_tag, frozen_tree<T>>,
+        typename std::enable_if<is_multiway_tree<frozen_tree<T>>::value, void>::type>
+    {
+        typedef frozen_tree<T> tree_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename tree_type::value_type value_type;
+        typedef typename
+            std::conditional<IsConst, value_type const*, value_type*>::type pointer;
+        typedef typename
+            std::conditional<IsConst, value_type const&, value_type&>::type reference;
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef typename tree_type::sub_iterator sub_iterator;
+        
+        static sub_iterator base(sub_iterator _a)
+        {
+            return _a;
+        }
+        
+        static reference dereference(sub_iterator _a)
+        {
+            assert(_a.m_tree != 0);
+            return _a.m_tree->m_values[_a.m_index];
+        }
+        
+        static sub_iterator& increment(sub_iterator& _a)
+        {
+            ++_a.m_index;
+            return _a;
+        }
+        
+        static sub_iterator& decrement(sub_iterator& _a)
+        {
+            if(_a.m_index > 0) --_a.m_index;
+            return _a;
+        }
+        
+        static sub_iterator next(sub_iterator _a, difference_type _n)
+        {
+            _a.m_index = static_cast<typename tree_type::index_type>(_a.m_index + _n);
+            return _a;
+        }
+        
+        static sub_iterator prev(sub_iterator _a, difference_type _n)
+        {
+            _a.m_index = static_cast<typename tree_type::index_type>(_a.m_index - _n);
+            return _a;
+        }
+        
+        static difference_type difference(sub_iterator _a, sub_iterator _b)
+        {
+            return static_cast<difference_type>(_a.m_index) - static_cast<difference_type>(_b.m_index);
+        }
+        
+        static bool less(sub_iterator _a, sub_iterator _b)
+        {
+            return (_a.m_index < _b.m_index);
+        }
+    };
+    
+    //-----------------------------------------------------------
+    //    child order traits
+    //-----------------------------------------------------------
+    template<bool IsConst, typename T>
+    struct tree_iterator_traits<
+        tree_iterator<IsConst, child_order_tag, frozen_tree<T>>>
+    {
+        typedef frozen_tree<T> tree_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename tree_type::value_type value_type;
+        typedef typename
+            std::conditional<IsConst, value_type const*, value_type*>::type pointer;
+        typedef typename
+            std::conditional<IsConst, value_type const&, value_type&>::type reference;
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef typename tree_type::child_position sub_iterator;
+        
+        static sub_iterator base(sub_iterator _a)
+        {
+            return _a;
+        }
+        
+        static reference dereference(sub_iterator _a)
+        {
+            assert(_a.m_tree != 0);
+            return _a.m_tree->m_values[_a.m_index];
+        }
+        
+        static sub_iterator& increment(sub_iterator& _a)
+        {
+            assert(_a.m_tree != 0);
+            _a.m_index += _a.m_tree->m_links[_a.m_index].m_size;
+            return _a;
+        }
+        
+        static sub_iterator& decrement(sub_iterator& _a)
+        {
+            assert(_a.m_tree != 0);
+            auto const& links = _a.m_tree->m_links;
+            _a.m_index = (_a.m_index == _a.m_parent + links[_a.m_parent].m_size)
+                ? links[_a.m_parent].m_last_child
+                : links[_a.m_index].m_older_sibling;
+            return _a;
+        }
+    };
+    
+    template<bool IsConst, typename Traversal, typename T>
+    tree_iterator<IsConst, child_order_tag, frozen_tree<T>>
+    child_order_begin(tree_iterator<IsConst, Traversal, frozen_tree<T>> _it)
+    {
+        typedef tree_iterator<IsConst, child_order_tag, frozen_tree<T>> iterator_type;
+        typedef typename iterator_type::sub_iterator child_position;
+        typename multiway_tree_traits<frozen_tree<T>>::sub_iterator a = _it.base();
+        return iterator_type(child_position(a.m_tree, a.m_index, a.m_index + 1));
+    }
+    
+    template<bool IsConst, typename Traversal, typename T>
+    tree_iterator<IsConst, child_order_tag, frozen_tree<T>>
+    child_order_end(tree_iterator<IsConst, Traversal, frozen_tree<T>> _it)
+    {
+        typedef tree_iterator<IsConst, child_order_tag, frozen_tree<T>> iterator_type;
+        typedef typename iterator_type::sub_iterator child_position;
+        typename multiway_tree_traits<frozen_tree<T>>::sub_iterator a = _it.base();
+        return iterator_type(child_position(a.m_tree, a.m_index,
+            a.m_index + a.m_tree->m_links[a.m_index].m_size));
+    }
+    
+    template<bool IsConst, typename Traversal, typename T>
+    tree_iterator<IsConst, reverse_tag<child_order_tag>, frozen_tree<T>>
+    child_order_rbegin(tree_iterator<IsConst, Traversal, frozen_tree<T>> _it)
+    {
+        return tree_iterator<IsConst, reverse_tag<child_order_tag>, frozen_tree<T>>(child_order_end(_it).base());
+    }
+    
+    template<bool IsConst, typename Traversal, typename T>
+    tree_iterator<IsConst, reverse_tag<child_order_tag>, frozen_tree<T>>
+    child_order_rend(tree_iterator<IsConst, Traversal, frozen_tree<T>> _it)
+    {
+        return tree_iterator<IsConst, reverse_tag<child_order_tag>, frozen_tree<T>>(child_order_begin(_it).base());
+    }
+}//---- namespace creek
+
+#endif
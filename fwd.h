@@ -52,6 +52,10 @@ namespace creek
                 multiway_tree_traits<Tree>>::value;
     };
     
+    template<typename Allocator>
+    struct is_bulk_releasable
+        : public std::false_type {};
+    
     template<typename Iterator>
     struct is_reverse_iterator
         : public std::false_type {};
@@ -0,0 +1,316 @@
+//-----------------------------------------------------------
+//    interval_tree.h
+//-----------------------------------------------------------
+#ifndef CREEK_INTERVAL_TREE_H
+#define CREEK_INTERVAL_TREE_H
+
+#include <iterator>
+#include <utility>
+#include <memory>
+#include <cstddef>
+#include <assert.h>
+
+#include "fwd.h"
+#include "rbtree.h"
+
+namespace creek
+{
+    //-----------------------------------------------------------
+    //    interval traits
+    //    the half open interval [start, end) of an Interval,
+    //    points are compared with operator<.
+    //-----------------------------------------------------------
+    template<typename Interval>
+    struct interval_traits
+    {
+        typedef typename Interval::first_type point_type;
+        
+        static point_type const& start(Interval const& _a) { return _a.first; }
+        static point_type const& end(Interval const& _a) { return _a.second; }
+    };
+    
+    namespace detail
+    {
+        //---- orders intervals by their start
+        template<typename Interval, typename Traits>
+        struct interval_start_less
+        {
+            bool operator()(Interval const& _a, Interval const& _b) const
+            {
+                return Traits::start(_a) < Traits::start(_b);
+            }
+        };
+        
+        //---- greatest end in a subtree, none for an empty one
+        template<typename Point>
+        struct interval_bound
+        {
+            bool m_valid;
+            Point m_end;
+        };
+        
+        template<typename Interval, typename Traits>
+        struct interval_max_end
+        {
+            typedef interval_bound<typename Traits::point_type> result_type;
+            
+            result_type identity() const { return result_type{false, typename Traits::point_type()}; }
+            result_type lift(Interval const& _a) const { return result_type{true, Traits::end(_a)}; }
+            
+            result_type combine(result_type const& _a, result_type const& _b) const
+            {
+                if(!_a.m_valid) return _b;
+                if(!_b.m_valid) return _a;
+                return (_a.m_end < _b.m_end) ? _b : _a;
+            }
+        };
+    }
+    
+    //-----------------------------------------------------------
+    //    class interval_tree
+    //    intervals in an rbtree ordered by their start, every node
+    //    keeps the greatest end of its subtree. a query skips the
+    //    subtrees ending before it and stops at the first start
+    //    after it, so it costs O(log n) per interval found and
+    //    never more than a walk over all of them.
+    //
+    //    [start, end) overlaps [a, b) if start < b and a < end, and
+    //    holds the point x if start <= x and x < end.
+    //-----------------------------------------------------------
+    template<
+        typename Interval,
+        typename Traits = interval_traits<Interval>,
+        typename Allocator = std::allocator<Interval>>
+    class interval_tree
+    {
+    public:
+        typedef Interval value_type;
+        typedef typename Traits::point_type point_type;
+        typedef Allocator allocator_type;
+        
+    private:
+        typedef detail::interval_max_end<Interval, Traits> aggregate_type;
+        typedef rbtree_aggregate<aggregate_type> augment_type;
+        typedef rbtree<
+            Interval,
+            detail::interval_start_less<Interval, Traits>,
+            Allocator,
+            augment_type> tree_type;
+        
+        // declared before node_traits, which needs rbtree complete
+        tree_type m_tree;
+        
+        typedef binary_tree_traits<tree_type> node_traits;
+        typedef typename node_traits::sub_iterator node_pointer;
+        
+        // ---- query
+        //      intervals ending after m_low and starting before
+        //      m_high, or at it if m_closed.
+        struct query
+        {
+            point_type m_low;
+            point_type m_high;
+            bool m_closed;
+            
+            bool ends_after(node_pointer _a) const
+            {
+                typename augment_type::result_type r = augment_type::aggregate(_a);
+                return r.m_valid && m_low < r.m_end;
+            }
+            
+            bool starts_before(node_pointer _a) const
+            {
+                point_type const& s = Traits::start(_a->value);
+                return m_closed ? !(m_high < s) : (s < m_high);
+            }
+            
+            bool overlaps(node_pointer _a) const
+            {
+                return starts_before(_a) && m_low < Traits::end(_a->value);
+            }
+        };
+        
+    public:
+        typedef typename tree_type::size_type size_type;
+        typedef typename tree_type::const_in_order_iterator const_iterator;
+        
+        //---- overlap_iterator
+        //     the intervals of a query in order of their start. it
+        //     is invalidated by insert and erase.
+        class overlap_iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Interval value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Interval const* pointer;
+            typedef Interval const& reference;
+            
+        private:
+            interval_tree const* m_tree;
+            node_pointer m_node;
+            query m_query;
+            
+            friend class interval_tree;
+            
+            overlap_iterator(interval_tree const* _tree, node_pointer _node, query const& _query)
+                : m_tree(_tree), m_node(_node), m_query(_query)
+            {}
+            
+        public:
+            overlap_iterator() : m_tree(0), m_node(0), m_query() {}
+            
+            reference operator*() const { return m_node->value; }
+            pointer operator->() const { return &m_node->value; }
+            
+            overlap_iterator& operator++()
+            {
+                m_node = m_tree->next_overlap(m_node, m_query);
+                return *this;
+            }
+            
+            overlap_iterator operator++(int)
+            {
+                overlap_iterator tmp(*this);
+                ++*this;
+                return tmp;
+            }
+            
+            // ---- the interval in the tree, for erase
+            const_iterator base() const { return const_iterator(m_node); }
+            
+            bool operator==(overlap_iterator const& _a) const { return m_node == _a.m_node; }
+            bool operator!=(overlap_iterator const& _a) const { return m_node != _a.m_node; }
+        };
+        
+        typedef std::pair<overlap_iterator, overlap_iterator> overlap_range;
+        
+        interval_tree() : m_tree() {}
+        
+        template<typename Iterator>
+        interval_tree(Iterator _first, Iterator _last)
+            : m_tree(_first, _last)
+        {}
+        
+        const_iterator begin() const { return m_tree.in_order_begin(); }
+        const_iterator end() const { return m_tree.in_order_end(); }
+        
+        size_type size() const { return m_tree.size(); }
+        bool empty() const { return m_tree.empty(); }
+        void clear() { m_tree.clear(); }
+        
+        const_iterator insert(Interval const& _a) { return m_tree.insert(_a); }
+        void erase(const_iterator _it) { m_tree.erase(_it); }
+        void erase(overlap_iterator _it) { m_tree.erase(_it.base()); }
+        
+        // ---- queries
+        template<typename Function>
+        void for_each_overlapping(point_type const& _a, point_type const& _b, Function _f) const
+        {
+            for_each(root(), query{_a, _b, false}, _f);
+        }
+        
+        template<typename Function>
+        void for_each_overlapping(point_type const& _x, Function _f) const
+        {
+            for_each(root(), query{_x, _x, true}, _f);
+        }
+        
+        bool any_overlap(point_type const& _a, point_type const& _b) const
+        {
+            return first_overlap(root(), query{_a, _b, false}) != 0;
+        }
+        
+        bool any_overlap(point_type const& _x) const
+        {
+            return first_overlap(root(), query{_x, _x, true}) != 0;
+        }
+        
+        overlap_range overlapping(point_type const& _a, point_type const& _b) const
+        {
+            return range(query{_a, _b, false});
+        }
+        
+        overlap_range overlapping(point_type const& _x) const
+        {
+            return range(query{_x, _x, true});
+        }
+        
+        bool check_invariant() const
+        {
+            if(!m_tree.check_invariant()) return false;
+            return check_node(root());
+        }
+        
+    private:
+        node_pointer root() const { return m_tree.pre_order_begin().base(); }
+        
+        overlap_range range(query const& _q) const
+        {
+            return overlap_range(
+                overlap_iterator(this, first_overlap(root(), _q), _q),
+                overlap_iterator(this, 0, _q));
+        }
+        
+        template<typename Function>
+        static void for_each(node_pointer _a, query const& _q, Function& _f)
+        {
+            if(_a == 0 || !_q.ends_after(_a)) return;
+            for_each(_a->left, _q, _f);
+            if(!_q.starts_before(_a)) return;
+            if(_q.m_low < Traits::end(_a->value)) _f(_a->value);
+            for_each(_a->right, _q, _f);
+        }
+        
+        // ---- leftmost interval of the query below _a, 0 if none
+        //      when the left subtree ends after the query, either
+        //      it holds the answer or every later interval starts
+        //      too late.
+        static node_pointer first_overlap(node_pointer _a, query const& _q)
+        {
+            while(_a != 0 && _q.ends_after(_a)){
+                if(_a->left != 0 && _q.ends_after(_a->left)){
+                    _a = _a->left;
+                }else{
+                    if(!_q.starts_before(_a)) return 0;
+                    if(_q.m_low < Traits::end(_a->value)) return _a;
+                    _a = _a->right;
+                }
+            }
+            return 0;
+        }
+        
+        // ---- next interval of the query after _a in order
+        node_pointer next_overlap(node_pointer _a, query const& _q) const
+        {
+            node_pointer r = first_overlap(_a->right, _q);
+            if(r != 0) return r;
+            node_pointer top = root();
+            while(_a != top){
+                node_pointer p = node_traits::parent(_a);
+                if(p->left == _a){
+                    if(!_q.starts_before(p)) return 0;
+                    if(_q.overlaps(p)) return p;
+                    r = first_overlap(p->right, _q);
+                    if(r != 0) return r;
+                }
+                _a = p;
+            }
+            return 0;
+        }
+        
+        bool check_node(node_pointer _a) const
+        {
+            if(_a == 0) return true;
+            typename augment_type::result_type r = augment_type::aggregate(_a);
+            aggregate_type g;
+            typename augment_type::result_type e = g.combine(
+                g.combine(augment_type::aggregate(_a->left), g.lift(_a->value)),
+                augment_type::aggregate(_a->right));
+            if(!r.m_valid || r.m_end < e.m_end || e.m_end < r.m_end) return false;
+            return check_node(_a->left) && check_node(_a->right);
+        }
+    };
+}
+
+#endif
@@ -112,7 +112,7 @@ namespace creek{
             return traits_type::dereference(traits_type::next(m_current, _n));
         }
         
-        sub_iterator base() const
+        auto base() const -> decltype(traits_type::base(std::declval<sub_iterator>()))
         {
             return traits_type::base(m_current);
         }
@@ -3,9 +3,13 @@
 
 #include <iterator>
 #include <type_traits>
+#include <utility>
 #include <cstddef>
+#include <vector>
+#include <memory>
 
 #include <iostream>
+#include <assert.h>
 
 #include "fwd.h"
 
@@ -226,6 +230,7 @@ namespace creek{
             auto b = _a;
             while(b != sub_iterator()){
                 auto c = traits_type::parent(b);
+                if(c == sub_iterator()) break;
                 if(traits_type::left_child(c) == b){
                     _a = c;
                     return _a;
@@ -255,6 +260,7 @@ namespace creek{
             auto b = _a;
             while(b != sub_iterator()){
                 auto c = traits_type::parent(b);
+                if(c == sub_iterator()) break;
                 if(traits_type::right_child(c) == b){
                     _a = c;
                     return _a;
@@ -454,6 +460,91 @@ namespace creek{
         }
     };
     
+    namespace detail
+    {
+        // ---- reverse position
+        //      the forward position a reverse iterator was made from and
+        //      the one before it, which is the one it dereferences. the
+        //      predecessor is computed once per step and kept.
+        template<typename Traversal, typename Tree, bool IsRandomAccess =
+            std::is_same<
+                typename tree_iterator_traits<tree_iterator<true, Traversal, Tree>>::iterator_category,
+                std::random_access_iterator_tag>::value>
+        struct reverse_position
+        {
+            typedef tree_iterator_traits<tree_iterator<true, Traversal, Tree>> traits_type;
+            typedef typename traits_type::sub_iterator sub_iterator;
+            
+            sub_iterator m_base;
+            sub_iterator m_current;
+            
+            reverse_position()
+                : m_base(), m_current()
+            {}
+            
+            reverse_position(sub_iterator _a)
+                : m_base(_a), m_current(_a)
+            {
+                if(_a != sub_iterator()) traits_type::decrement(m_current);
+            }
+            
+            sub_iterator current() const
+            { return m_current; }
+            
+            void increment()
+            {
+                m_base = m_current;
+                traits_type::decrement(m_current);
+            }
+            
+            void decrement()
+            {
+                m_current = m_base;
+                traits_type::increment(m_base);
+            }
+            
+            bool operator==(reverse_position const& _other) const
+            { return (m_base == _other.m_base); }
+            
+            bool operator!=(reverse_position const& _other) const
+            { return !(*this == _other); }
+        };
+        
+        // ---- reverse position, random access
+        //      the predecessor is cheap, and the one of begin may not exist.
+        template<typename Traversal, typename Tree>
+        struct reverse_position<Traversal, Tree, true>
+        {
+            typedef tree_iterator_traits<tree_iterator<true, Traversal, Tree>> traits_type;
+            typedef typename traits_type::sub_iterator sub_iterator;
+            
+            sub_iterator m_base;
+            
+            reverse_position()
+                : m_base()
+            {}
+            
+            reverse_position(sub_iterator _a)
+                : m_base(_a)
+            {}
+            
+            sub_iterator current() const
+            { return traits_type::prev(m_base, 1); }
+            
+            void increment()
+            { traits_type::decrement(m_base); }
+            
+            void decrement()
+            { traits_type::increment(m_base); }
+            
+            bool operator==(reverse_position const& _other) const
+            { return (m_base == _other.m_base); }
+            
+            bool operator!=(reverse_position const& _other) const
+            { return !(*this == _other); }
+        };
+    }
+    
     // ---- reverse
     template<bool IsConst, typename Traversal, typename Tree, typename Void>
     struct tree_iterator_traits<
@@ -467,32 +558,187 @@ namespace creek{
             std::conditional<IsConst, value_type const&, value_type&>::type reference;
         typedef std::bidirectional_iterator_tag iterator_category;
         typedef Tree tree_type;
-        typedef typename tree_iterator<IsConst, Traversal, Tree>::sub_iterator sub_iterator;
+        typedef detail::reverse_position<Traversal, Tree> sub_iterator;
         typedef tree_iterator_traits<tree_iterator<IsConst, Traversal, Tree>> traits_type;
         
-        static sub_iterator base(sub_iterator _a)
+        static typename traits_type::sub_iterator base(sub_iterator const& _a)
         {
-            auto b = tree_iterator<IsConst, Traversal, Tree>(_a);
-            return (--b).base();
+            return traits_type::base(_a.current());
         }
         
-        static reference dereference(sub_iterator _a)
+        static reference dereference(sub_iterator const& _a)
         {
-            auto b = tree_iterator<IsConst, Traversal, Tree>(_a);
-            return *(--b);
+            return traits_type::dereference(_a.current());
         }
         
         static sub_iterator& increment(sub_iterator& _a)
         {
-            auto b = tree_iterator<IsConst, Traversal, Tree>(_a);
-            _a = (--b).base();
+            _a.increment();
             return _a;
         }
         
         static sub_iterator& decrement(sub_iterator& _a)
         {
-            auto b = tree_iterator<IsConst, Traversal, Tree>(_a);
-            _a = (++b).base();
+            _a.decrement();
+            return _a;
+        }
+    };
+    
+    namespace detail
+    {
+        // ---- level children
+        //      appends the children of a node to the next level.
+        template<typename Tree, typename Void = void>
+        struct level_children;
+        
+        template<typename Tree>
+        struct level_children<Tree,
+            typename std::enable_if<is_binary_tree<Tree>::value, void>::type>
+        {
+            typedef binary_tree_traits<Tree> traits_type;
+            typedef typename traits_type::sub_iterator sub_iterator;
+            
+            static void append(sub_iterator _a, std::vector<sub_iterator>& _out)
+            {
+                auto left = traits_type::left_child(_a);
+                auto right = traits_type::right_child(_a);
+                if(left != sub_iterator()) _out.push_back(left);
+                if(right != sub_iterator()) _out.push_back(right);
+            }
+        };
+        
+        template<typename Tree>
+        struct level_children<Tree,
+            typename std::enable_if<is_multiway_tree<Tree>::value, void>::type>
+        {
+            typedef multiway_tree_traits<Tree> traits_type;
+            typedef typename traits_type::sub_iterator sub_iterator;
+            
+            static void append(sub_iterator _a, std::vector<sub_iterator>& _out)
+            {
+                auto c = traits_type::first_child(_a);
+                while(c != sub_iterator()){
+                    _out.push_back(c);
+                    c = traits_type::younger_sibling(c);
+                }
+            }
+        };
+        
+        // ---- level position
+        //      the nodes of the current level are kept in a frontier buffer,
+        //      the next level is built into the second buffer and swapped in.
+        //      copies share the frontier until one of them leaves the level.
+        template<typename Tree>
+        struct level_position
+        {
+            typedef level_children<Tree> children_type;
+            typedef typename children_type::sub_iterator sub_iterator;
+            
+            struct frontier
+            {
+                std::vector<sub_iterator> m_level;
+                std::vector<sub_iterator> m_next;
+                std::size_t m_depth;
+                bool m_single_level;
+            };
+            
+            std::shared_ptr<frontier> m_frontier;
+            std::size_t m_index;
+            
+            level_position()
+                : m_frontier(), m_index()
+            {}
+            
+            // ---- first node at depth _depth below _root, or the end.
+            //      with _single_level the position ends with that level.
+            static level_position at_depth(sub_iterator _root, std::size_t _depth, bool _single_level)
+            {
+                level_position a;
+                if(_root == sub_iterator()) return a;
+                a.m_frontier = std::make_shared<frontier>();
+                a.m_frontier->m_level.push_back(_root);
+                a.m_frontier->m_depth = 0;
+                a.m_frontier->m_single_level = false;
+                while(a.m_frontier && a.m_frontier->m_depth < _depth) a.next_level();
+                if(a.m_frontier) a.m_frontier->m_single_level = _single_level;
+                return a;
+            }
+            
+            sub_iterator node() const
+            {
+                return m_frontier ? m_frontier->m_level[m_index] : sub_iterator();
+            }
+            
+            std::size_t depth() const
+            {
+                return m_frontier ? m_frontier->m_depth : 0;
+            }
+            
+            void increment()
+            {
+                assert(m_frontier);
+                if(++m_index < m_frontier->m_level.size()) return;
+                if(m_frontier->m_single_level) *this = level_position();
+                else next_level();
+            }
+            
+            void next_level()
+            {
+                if(m_frontier.use_count() > 1){
+                    std::shared_ptr<frontier> tmp = std::make_shared<frontier>();
+                    tmp->m_level = m_frontier->m_level;
+                    tmp->m_depth = m_frontier->m_depth;
+                    tmp->m_single_level = m_frontier->m_single_level;
+                    m_frontier = tmp;
+                }
+                frontier& f = *m_frontier;
+                f.m_next.clear();
+                for(std::size_t i = 0; i < f.m_level.size(); ++i)
+                    children_type::append(f.m_level[i], f.m_next);
+                f.m_level.swap(f.m_next);
+                ++f.m_depth;
+                m_index = 0;
+                if(f.m_level.empty()) *this = level_position();
+            }
+            
+            bool operator==(level_position const& _other) const
+            { return (node() == _other.node()); }
+            
+            bool operator!=(level_position const& _other) const
+            { return !(*this == _other); }
+        };
+    }
+    
+    // ---- level order, binary and multiway
+    template<bool IsConst, typename Tree>
+    struct tree_iterator_traits<
+        tree_iterator<IsConst, level_order_tag, Tree>,
+        typename std::enable_if<is_binary_tree<Tree>::value || is_multiway_tree<Tree>::value, void>::type>
+    {
+        typedef std::ptrdiff_t difference_type;
+        typedef typename Tree::value_type value_type;
+        typedef typename
+            std::conditional<IsConst, value_type const*, value_type*>::type pointer;
+        typedef typename
+            std::conditional<IsConst, value_type const&, value_type&>::type reference;
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Tree tree_type;
+        typedef detail::level_position<Tree> sub_iterator;
+        typedef typename sub_iterator::children_type::traits_type traits_type;
+        
+        static typename sub_iterator::sub_iterator base(sub_iterator const& _a)
+        {
+            return _a.node();
+        }
+        
+        static reference dereference(sub_iterator const& _a)
+        {
+            return traits_type::dereference(_a.node());
+        }
+        
+        static sub_iterator& increment(sub_iterator& _a)
+        {
+            _a.increment();
             return _a;
         }
     };
@@ -4,6 +4,7 @@
 #include <iterator>
 #include <algorithm>
 #include <functional>
+#include <utility>
 #include <stdexcept>
 #include <assert.h>
 
@@ -320,6 +321,9 @@ namespace creek{
         typedef tree_iterator<true,  post_order_tag, self_type> const_post_order_iterator;
         typedef tree_iterator<false, reverse_tag<post_order_tag>, self_type> reverse_post_order_iterator;
         typedef tree_iterator<true,  reverse_tag<post_order_tag>, self_type> const_reverse_post_order_iterator;
+        // level order
+        typedef tree_iterator<false, level_order_tag, self_type> level_order_iterator;
+        typedef tree_iterator<true,  level_order_tag, self_type> const_level_order_iterator;
         
         // pre order
         const_pre_order_iterator pre_order_begin() const
@@ -466,7 +470,45 @@ namespace creek{
             return reverse_post_order_iterator(post_order_begin().base());
         }
         
+        // level order
+        const_level_order_iterator level_order_begin() const
+        {
+            return const_level_order_iterator(level_position::at_depth(m_root, 0, false));
+        }
+        
+        const_level_order_iterator level_order_end() const
+        {
+            return const_level_order_iterator();
+        }
+        
+        level_order_iterator level_order_begin()
+        {
+            return level_order_iterator(level_position::at_depth(m_root, 0, false));
+        }
+        
+        level_order_iterator level_order_end()
+        {
+            return level_order_iterator();
+        }
+        
+        // nodes at depth _depth from left to right, the root at 0
+        std::pair<const_level_order_iterator, const_level_order_iterator> level_range(size_type _depth) const
+        {
+            return std::make_pair(
+                const_level_order_iterator(level_position::at_depth(m_root, _depth, true)),
+                const_level_order_iterator());
+        }
+        
+        std::pair<level_order_iterator, level_order_iterator> level_range(size_type _depth)
+        {
+            return std::make_pair(
+                level_order_iterator(level_position::at_depth(m_root, _depth, true)),
+                level_order_iterator());
+        }
+        
     private:
+        typedef typename level_order_iterator::sub_iterator level_position;
+        
         template<typename RAIterator>
         node_pointer
         construct(RAIterator _first, RAIterator _last, size_type _level, node_pointer _parent)
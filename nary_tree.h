@@ -313,19 +313,27 @@ namespace creek{
         {
             assert(_a != sub_iterator());
             if((*_a).m_child_begin == (*_a).m_child_end) return sub_iterator();
-            else return --((*_a).m_child_end);
+            sub_iterator last = (*_a).m_child_end;
+            return (--last);
         }
         
+        //---- older / younger sibling
+        //     siblings are neighbours in the storage, but the first and
+        //     the last child of a node have none on the outer side.
         static sub_iterator older_sibling(sub_iterator _a)
         {
             assert(_a != sub_iterator());
+            sub_iterator p = (*_a).m_parent;
+            if(p == sub_iterator() || _a == (*p).m_child_begin) return sub_iterator();
             return (--_a);
         }
         
         static sub_iterator younger_sibling(sub_iterator _a)
         {
             assert(_a != sub_iterator());
-            return (++_a);
+            sub_iterator p = (*_a).m_parent;
+            if(p == sub_iterator() || ++_a == (*p).m_child_end) return sub_iterator();
+            return _a;
         }
     };
     
@@ -334,7 +342,10 @@ namespace creek{
     //-----------------------------------------------------------
     template<bool IsConst, std::size_t N, typename T, typename A>
     struct tree_iterator_traits<
-        tree_iterator<IsConst, level_order_tag, nary_tree<N, T, A>>>
+        tree_iterator<IsConst, level_order_tag, nary_tree<N, T, A>>,
+        typename std::enable_if<
+            is_binary_tree<nary_tree<N, T, A>>::value ||
+            is_multiway_tree<nary_tree<N, T, A>>::value, void>::type>
     {
         typedef nary_tree<N, T, A> tree_type;
         typedef std::ptrdiff_t difference_type;
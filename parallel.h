@@ -0,0 +1,279 @@
+//-----------------------------------------------------------
+//    parallel.h
+//-----------------------------------------------------------
+#ifndef CREEK_PARALLEL_H
+#define CREEK_PARALLEL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <assert.h>
+
+#include "fwd.h"
+#include "iterator.h"
+#include "frozen_tree.h"
+#include "thread_pool.h"
+
+namespace creek
+{
+    namespace parallel
+    {
+        namespace detail
+        {
+            //---- subtree size
+            //     trees that know the size of every subtree, the others
+            //     are measured while splitting.
+            template<typename Tree>
+            struct subtree_size
+            {
+                static bool const is_known = false;
+            };
+            
+            template<typename T>
+            struct subtree_size<frozen_tree<T>>
+            {
+                static bool const is_known = true;
+                
+                template<typename SubIterator>
+                static std::size_t get(frozen_tree<T> const& _tree, SubIterator _a)
+                {
+                    return _tree.subtree_size(typename frozen_tree<T>::const_pre_order_iterator(_a));
+                }
+            };
+            
+            //-----------------------------------------------------------
+            //    class subtree_probe
+            //    sorts the children of a node into large ones, worth a
+            //    task of their own, and small ones. a probe is a child
+            //    together with the nodes of its subtree seen so far.
+            //-----------------------------------------------------------
+            template<typename Tree>
+            class subtree_probe
+            {
+            public:
+                typedef typename std::remove_const<Tree>::type tree_type;
+                typedef multiway_tree_traits<tree_type> traits_type;
+                typedef typename traits_type::sub_iterator sub_iterator;
+                
+                struct probe
+                {
+                    sub_iterator m_root;
+                    sub_iterator m_cursor;
+                    std::size_t m_count;
+                };
+                
+            private:
+                typedef detail::subtree_size<tree_type> size_type_traits;
+                
+                Tree& m_tree;
+                std::size_t m_grain;
+                
+            public:
+                subtree_probe(Tree& _tree, std::size_t _grain)
+                    : m_tree(_tree), m_grain(std::max<std::size_t>(_grain, 1))
+                {}
+                
+                std::size_t grain() const
+                { return m_grain; }
+                
+                static void children(sub_iterator _a, std::vector<probe>& _out)
+                {
+                    _out.clear();
+                    for(sub_iterator c = traits_type::first_child(_a); c != sub_iterator();
+                        c = traits_type::younger_sibling(c)){
+                        probe p = {c, c, 0};
+                        _out.push_back(p);
+                    }
+                }
+                
+                //---- measure
+                //     afterwards m_cursor is null for the small children
+                //     and m_count is their size.
+                void measure(std::vector<probe>& _children) const
+                {
+                    measure(_children, std::integral_constant<bool, size_type_traits::is_known>());
+                }
+                
+                //---- next in subtree
+                //     pre order successor of _a inside the subtree of _top,
+                //     null past its end.
+                static sub_iterator next_in_subtree(sub_iterator _a, sub_iterator _top)
+                {
+                    sub_iterator c = traits_type::first_child(_a);
+                    if(c != sub_iterator()) return c;
+                    while(_a != _top){
+                        sub_iterator s = traits_type::younger_sibling(_a);
+                        if(s != sub_iterator()) return s;
+                        _a = traits_type::parent(_a);
+                    }
+                    return sub_iterator();
+                }
+                
+            private:
+                void measure(std::vector<probe>& _children, std::true_type) const
+                {
+                    for(std::size_t i = 0; i < _children.size(); ++i){
+                        probe& p = _children[i];
+                        p.m_count = size_type_traits::get(m_tree, p.m_root);
+                        if(p.m_count <= m_grain) p.m_cursor = sub_iterator();
+                    }
+                }
+                
+                //---- measure
+                //     counts all children in lockstep, one node each per
+                //     round, until every child is complete or has reached
+                //     the grain. once a single child is left it is not
+                //     counted further, so a long spine costs nothing extra.
+                void measure(std::vector<probe>& _children, std::false_type) const
+                {
+                    std::size_t open = _children.size();
+                    bool progressed = true;
+                    while(open > 1 && progressed){
+                        progressed = false;
+                        for(std::size_t i = 0; i < _children.size(); ++i){
+                            probe& p = _children[i];
+                            if(p.m_cursor == sub_iterator() || p.m_count >= m_grain) continue;
+                            p.m_cursor = next_in_subtree(p.m_cursor, p.m_root);
+                            ++p.m_count;
+                            progressed = true;
+                            if(p.m_cursor == sub_iterator()) --open;
+                        }
+                    }
+                }
+            };
+            
+            //-----------------------------------------------------------
+            //    class subtree_splitter
+            //    walks a subtree and hands children that are larger than
+            //    the grain to other tasks. small siblings are gathered
+            //    into batches of about grain nodes. a node with a single
+            //    child is never split, the walk just goes on.
+            //-----------------------------------------------------------
+            template<typename Tree, typename Function>
+            class subtree_splitter
+            {
+            private:
+                typedef subtree_probe<Tree> probe_type;
+                typedef typename probe_type::tree_type tree_type;
+                typedef typename probe_type::traits_type traits_type;
+                typedef typename probe_type::sub_iterator sub_iterator;
+                typedef typename probe_type::probe probe;
+                typedef typename std::conditional<std::is_const<Tree>::value,
+                    typename tree_type::value_type const&,
+                    decltype(traits_type::dereference(std::declval<sub_iterator>()))>::type reference;
+                
+                probe_type m_probe;
+                Function& m_f;
+                task_group& m_group;
+                
+            public:
+                subtree_splitter(Tree& _tree, Function& _f, task_group& _group, std::size_t _grain)
+                    : m_probe(_tree, _grain), m_f(_f), m_group(_group)
+                {}
+                
+                void visit(sub_iterator _a)
+                {
+                    std::vector<probe> children;
+                    std::vector<sub_iterator> batch;
+                    while(1){
+                        m_f(static_cast<reference>(traits_type::dereference(_a)));
+                        
+                        probe_type::children(_a, children);
+                        if(children.empty()) return;
+                        if(children.size() == 1){
+                            _a = children.front().m_root;
+                            continue;
+                        }
+                        
+                        m_probe.measure(children);
+                        
+                        //---- large children go to other tasks, one is kept
+                        sub_iterator next = sub_iterator();
+                        std::size_t batch_count = 0;
+                        batch.clear();
+                        for(std::size_t i = 0; i < children.size(); ++i){
+                            probe const& p = children[i];
+                            if(p.m_cursor != sub_iterator()){
+                                if(next != sub_iterator()) spawn_visit(next);
+                                next = p.m_root;
+                            }else{
+                                batch.push_back(p.m_root);
+                                batch_count += p.m_count;
+                                if(batch_count >= m_probe.grain()){
+                                    spawn_batch(batch);
+                                    batch.clear();
+                                    batch_count = 0;
+                                }
+                            }
+                        }
+                        for(std::size_t i = 0; i < batch.size(); ++i)
+                            visit_sequential(batch[i]);
+                        if(next == sub_iterator()) return;
+                        _a = next;
+                    }
+                }
+                
+                void visit_sequential(sub_iterator _top)
+                {
+                    for(sub_iterator a = _top; a != sub_iterator(); a = probe_type::next_in_subtree(a, _top))
+                        m_f(static_cast<reference>(traits_type::dereference(a)));
+                }
+                
+            private:
+                void spawn_visit(sub_iterator _a)
+                {
+                    subtree_splitter* self = this;
+                    m_group.run([self, _a](){ self->visit(_a); });
+                }
+                
+                void spawn_batch(std::vector<sub_iterator> const& _batch)
+                {
+                    subtree_splitter* self = this;
+                    std::vector<sub_iterator> copy(_batch);
+                    m_group.run([self, copy](){
+                        for(std::size_t i = 0; i < copy.size(); ++i)
+                            self->visit_sequential(copy[i]);
+                    });
+                }
+            };
+        }
+        
+        //-----------------------------------------------------------
+        //    for_each_node
+        //    calls _f once for the value of every node of _tree, from
+        //    several threads and in no particular order. subtrees of
+        //    about _grain nodes are the unit of work.
+        //-----------------------------------------------------------
+        template<typename Tree, typename Function>
+        void for_each_node(Tree& _tree, Function _f, std::size_t _grain = 1024,
+            thread_pool& _pool = default_pool())
+        {
+            static_assert(is_multiway_tree<typename std::remove_const<Tree>::type>::value,
+                "for_each_node needs multiway_tree_traits");
+            if(_tree.empty()) return;
+            
+            task_group group(_pool);
+            detail::subtree_splitter<Tree, Function> splitter(_tree, _f, group, _grain);
+            try{
+                splitter.visit(_tree.pre_order_begin().base());
+            }
+            catch(...){
+                group.wait();
+                throw;
+            }
+            group.wait();
+        }
+    }//---- namespace parallel
+}//---- namespace creek
+
+#endif
@@ -0,0 +1,316 @@
+//-----------------------------------------------------------
+//    persistent_rbtree.h
+//-----------------------------------------------------------
+#ifndef CREEK_PERSISTENT_RBTREE_H
+#define CREEK_PERSISTENT_RBTREE_H
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <assert.h>
+
+#include "fwd.h"
+#include "rbtree_path_copy.h"
+
+namespace creek
+{
+    namespace detail
+    {
+        // ---- node
+        //      refs counts the versions and the nodes pointing to it,
+        //      0 while it belongs to the write that created it.
+        template<typename T>
+        struct persistent_rbtree_node
+        {
+            typedef T value_type;
+            
+            T value;
+            persistent_rbtree_node* left;
+            persistent_rbtree_node* right;
+            std::atomic<std::size_t> refs;
+            path_copy_color color;
+            
+            explicit persistent_rbtree_node(T const& _v)
+                : value(_v), left(0), right(0), refs(0), color(path_copy_color::black)
+            {}
+        };
+    }
+    
+    //-----------------------------------------------------------
+    //    class persistent_rbtree
+    //    red black tree whose versions are never changed. insert
+    //    and erase return a new version, which copies the nodes
+    //    on the path and the siblings the rebalancing touches,
+    //    O(log n), and shares every other node with the old one.
+    //    copying a version copies its root. nodes are reference
+    //    counted and freed with the last version reaching them,
+    //    versions may be used and dropped from any thread.
+    //-----------------------------------------------------------
+    template<
+        typename T,
+        typename Compare = rbtree_default,
+        typename Allocator = std::allocator<T>>
+    class persistent_rbtree
+        : private detail::rbtree_path_copy<
+            persistent_rbtree<T, Compare, Allocator>,
+            detail::persistent_rbtree_node<T>, Compare>
+    {
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+        typedef Allocator allocator_type;
+        typedef persistent_rbtree<T, Compare, Allocator> self_type;
+        
+    private:
+        typedef detail::persistent_rbtree_node<T> node;
+        typedef detail::rbtree_path_copy<self_type, node, Compare> base_type;
+        typedef typename base_type::color_t color_t;
+        
+        typedef node* node_pointer;
+        typedef typename allocator_type::template rebind<node>::other
+            node_allocator_type;
+        
+        using base_type::max_depth;
+        using base_type::m_compare;
+        using base_type::compare;
+        
+        friend base_type;
+        
+        // ---- nodes created by the running write, freed if it throws.
+        //      a write copies at most two nodes per level and a few
+        //      more at the bottom.
+        struct write_state
+        {
+            node_pointer nodes[2 * max_depth + 8];
+            std::size_t size;
+            
+            write_state() : size(0) {}
+        };
+        
+        node_pointer m_root;
+        size_type m_size;
+        node_allocator_type m_allocator;
+        write_state* m_write;
+        
+    public:
+        typedef typename base_type::iterator_type const_iterator;
+        
+        explicit persistent_rbtree(
+            Compare const& _cmp = Compare(),
+            allocator_type const& _alloc = allocator_type())
+            : base_type(_cmp), m_root(0), m_size(0), m_allocator(_alloc), m_write(0)
+        {}
+        
+        persistent_rbtree(self_type const& _a)
+            : base_type(_a.m_compare), m_root(_a.m_root), m_size(_a.m_size),
+              m_allocator(_a.m_allocator), m_write(0)
+        {
+            if(m_root != 0) m_root->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        persistent_rbtree(self_type&& _a)
+            : base_type(_a.m_compare), m_root(_a.m_root), m_size(_a.m_size),
+              m_allocator(_a.m_allocator), m_write(0)
+        {
+            _a.m_root = 0;
+            _a.m_size = 0;
+        }
+        
+        ~persistent_rbtree()
+        {
+            release(m_root);
+        }
+        
+        self_type& operator=(self_type const& _a)
+        {
+            self_type tmp(_a);
+            swap(tmp);
+            return *this;
+        }
+        
+        self_type& operator=(self_type&& _a)
+        {
+            swap(_a);
+            return *this;
+        }
+        
+        void swap(self_type& _a)
+        {
+            std::swap(m_root, _a.m_root);
+            std::swap(m_size, _a.m_size);
+            std::swap(m_allocator, _a.m_allocator);
+            std::swap(m_compare, _a.m_compare);
+        }
+        
+        size_type size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        
+        Compare const& value_comp() const { return m_compare; }
+        
+        // ---- versions
+        //      with _a after the elements equivalent to it.
+        self_type insert(value_type const& _a) const
+        {
+            self_type r(m_compare, m_allocator);
+            write_state w;
+            r.m_write = &w;
+            try{
+                node_pointer k = r.create_node(_a);
+                k->color = color_t::red;
+                r.m_root = r.insert_node(m_root, k);
+                r.m_root->color = color_t::black;
+            }
+            catch(...){
+                r.abort_write();
+                throw;
+            }
+            r.commit();
+            r.m_size = m_size + 1;
+            return r;
+        }
+        
+        // without the first element equivalent to _key, the same
+        // version if there is none.
+        template<typename Key>
+        self_type erase(Key const& _key) const
+        {
+            node_pointer path[max_depth + 2];
+            std::size_t depth = this->find_path(m_root, _key, path);
+            if(depth == 0) return *this;
+            
+            self_type r(m_compare, m_allocator);
+            write_state w;
+            r.m_write = &w;
+            try{
+                r.m_root = r.erase_node(path, depth);
+            }
+            catch(...){
+                r.abort_write();
+                throw;
+            }
+            r.commit();
+            r.m_size = m_size - 1;
+            return r;
+        }
+        
+        // ---- lookup
+        const_iterator begin() const { return base_type::begin_iterator(m_root); }
+        const_iterator end() const { return const_iterator(); }
+        
+        template<typename Key>
+        const_iterator lower_bound(Key const& _key) const
+        {
+            return this->lower_bound_iterator(m_root, _key);
+        }
+        
+        // ---- first element equivalent to _key, 0 if none
+        template<typename Key>
+        value_type const* find(Key const& _key) const
+        {
+            node_pointer a = this->lower_bound_node(m_root, _key);
+            if(a == 0 || compare(_key, a->value)) return 0;
+            return &a->value;
+        }
+        
+        template<typename Key>
+        bool contains(Key const& _key) const { return find(_key) != 0; }
+        
+        bool check_invariant() const
+        {
+            if(m_root != 0 && m_root->color != color_t::black) return false;
+            std::size_t count = 0;
+            return this->check_node(m_root, count) >= 0 && count == m_size;
+        }
+        
+    private:
+        // ---- writes
+        bool is_fresh(node_pointer _a) const
+        {
+            return _a->refs.load(std::memory_order_relaxed) == 0;
+        }
+        
+        node_pointer own(node_pointer _a)
+        {
+            if(is_fresh(_a)) return _a;
+            node_pointer b = create_node(_a->value);
+            b->left = _a->left;
+            b->right = _a->right;
+            b->color = _a->color;
+            return b;
+        }
+        
+        // a shared node stays with the versions holding it.
+        void drop(node_pointer _a)
+        {
+            if(!is_fresh(_a)) return;
+            node_pointer* end = m_write->nodes + m_write->size;
+            node_pointer* it = std::find(m_write->nodes, end, _a);
+            assert(it != end);
+            *it = *(end - 1);
+            --m_write->size;
+            destroy_node(_a);
+        }
+        
+        // every node reached from a node of the write gains a
+        // reference, the root one for this version.
+        void commit()
+        {
+            node_pointer stack[2 * max_depth + 8];
+            std::size_t n = 0;
+            if(m_root != 0 && is_fresh(m_root)) stack[n++] = m_root;
+            while(n > 0){
+                node_pointer a = stack[--n];
+                node_pointer c[2] = { a->left, a->right };
+                for(node_pointer b : c){
+                    if(b == 0) continue;
+                    if(is_fresh(b)) stack[n++] = b;
+                    b->refs.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            if(m_root != 0) m_root->refs.fetch_add(1, std::memory_order_relaxed);
+            m_write = 0;
+        }
+        
+        // nothing shared was changed, the nodes of the write go.
+        void abort_write()
+        {
+            for(std::size_t i = 0; i < m_write->size; ++i) destroy_node(m_write->nodes[i]);
+            m_write = 0;
+            m_root = 0;
+        }
+        
+        void release(node_pointer _a)
+        {
+            if(_a == 0 || _a->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+            release(_a->left);
+            release(_a->right);
+            destroy_node(_a);
+        }
+        
+        // ---- allocation
+        node_pointer create_node(value_type const& _v)
+        {
+            assert(m_write != 0 && m_write->size < 2 * max_depth + 8);
+            node_pointer tmp = m_allocator.allocate(1);
+            try{
+                m_allocator.construct(tmp, _v);
+            }
+            catch(...){
+                m_allocator.deallocate(tmp, 1);
+                throw;
+            }
+            m_write->nodes[m_write->size++] = tmp;
+            return tmp;
+        }
+        
+        void destroy_node(node_pointer _a)
+        {
+            m_allocator.destroy(_a);
+            m_allocator.deallocate(_a, 1);
+        }
+    };
+}
+
+#endif
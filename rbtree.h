@@ -2,10 +2,13 @@
 #define CREEK_RBTREE_H
 
 #include <iterator>
+#include <vector>
 #include <algorithm>
 #include <functional>
+#include <utility>
 #include <stdexcept>
 #include <type_traits>
+#include <cstdint>
 #include <assert.h>
 
 #include "fwd.h"
@@ -14,10 +17,184 @@
 namespace creek{
     struct rbtree_default {};
     
+    //-----------------------------------------------------------
+    //    node augmentation
+    //    node_data is kept in every node, and update recomputes
+    //    it from the node and its children whenever they change.
+    //-----------------------------------------------------------
+    struct rbtree_no_augment
+    {
+        static bool const is_enabled = false;
+        struct node_data {};
+        
+        template<typename Node>
+        static void update(Node&) {}
+    };
+    
+    // ---- subtree sizes, for nth, rank and index
+    struct rbtree_order_statistics
+    {
+        static bool const is_enabled = true;
+        struct node_data
+        {
+            std::size_t m_count;
+            node_data() : m_count(1) {}
+        };
+        
+        template<typename Node>
+        static void update(Node& _a)
+        {
+            _a.m_count = 1 + count(_a.left) + count(_a.right);
+        }
+        
+        template<typename Node>
+        static std::size_t count(Node const* _a)
+        {
+            return (_a != 0) ? _a->m_count : 0;
+        }
+    };
+    
+    // ---- Aggregate of every subtree, for aggregate
+    //      Aggregate is a monoid on the elements, default
+    //      constructible, with
+    //        result_type
+    //        result_type identity() const
+    //        result_type lift(T const&) const
+    //        result_type combine(result_type const&, result_type const&) const
+    //      combine is associative with identity, it need not commute.
+    template<typename Aggregate>
+    struct rbtree_aggregate
+    {
+        static bool const is_enabled = true;
+        typedef Aggregate aggregate_type;
+        typedef typename Aggregate::result_type result_type;
+        
+        struct node_data
+        {
+            result_type m_aggregate;
+            node_data() : m_aggregate(Aggregate().identity()) {}
+        };
+        
+        template<typename Node>
+        static void update(Node& _a)
+        {
+            Aggregate g;
+            _a.m_aggregate = g.combine(
+                g.combine(aggregate(_a.left), g.lift(_a.value)), aggregate(_a.right));
+        }
+        
+        template<typename Node>
+        static result_type aggregate(Node const* _a)
+        {
+            return (_a != 0) ? _a->m_aggregate : Aggregate().identity();
+        }
+    };
+    
+    //-----------------------------------------------------------
+    //    rebalancing statistics
+    //    what insert and erase did to keep the tree balanced.
+    //    recolours are the colour changes of the fixups outside
+    //    rotations, a rotation swaps the colours of its two nodes.
+    //    every element added by insert, insert_batch or assign is
+    //    an insert; the batch rebuilds and assign link a balanced
+    //    tree without rotations or recolours.
+    //    split, join and the set operations are not counted.
+    //-----------------------------------------------------------
+    struct rbtree_statistics
+    {
+        std::size_t m_inserts;
+        std::size_t m_erases;
+        std::size_t m_rotations;
+        std::size_t m_recolours;
+        std::size_t m_insert_fixup_steps;
+        std::size_t m_erase_fixup_steps;
+    };
+    
+    // ---- counts nothing, every count compiles away
+    struct rbtree_no_stats
+    {
+        static bool const is_enabled = false;
+        struct counters {};
+        
+        static void count(counters&, std::size_t rbtree_statistics::*, std::size_t) {}
+    };
+    
+    // ---- keeps an rbtree_statistics in the tree, for stats()
+    struct rbtree_stats
+    {
+        static bool const is_enabled = true;
+        typedef rbtree_statistics counters;
+        
+        static void count(counters& _c, std::size_t rbtree_statistics::* _field, std::size_t _n)
+        {
+            _c.*_field += _n;
+        }
+    };
+    
+    // ---- runs the two halves of a set operation one after the
+    //      other. a pool for the set operations only needs fork,
+    //      parallel::thread_pool (thread_pool.h) runs them as tasks.
+    struct rbtree_sequential
+    {
+        template<typename F1, typename F2>
+        void fork(F1 _f1, F2 _f2)
+        {
+            _f1();
+            _f2();
+        }
+    };
+    
+    namespace detail
+    {
+        template<typename Tp>
+        struct rbtree_void { typedef void type; };
+        
+        // ---- transparent compare
+        //      lookups take any key the comparator accepts, otherwise
+        //      the key is converted to value_type first.
+        template<typename Compare, typename Void = void>
+        struct is_transparent_compare : public std::false_type {};
+        
+        template<typename Compare>
+        struct is_transparent_compare<Compare,
+            typename rbtree_void<typename Compare::is_transparent>::type>
+            : public std::true_type {};
+        
+        template<>
+        struct is_transparent_compare<rbtree_default, void>
+            : public std::true_type {};
+        
+        // ---- key less
+        //      Compare on two keys, operator< for rbtree_default.
+        template<typename Compare>
+        struct key_less
+        {
+            template<typename Tp, typename Up>
+            static bool apply(Compare const& _compare, Tp const& _a, Up const& _b)
+            { return _compare(_a, _b); }
+        };
+        
+        template<>
+        struct key_less<rbtree_default>
+        {
+            template<typename Tp, typename Up>
+            static bool apply(rbtree_default const&, Tp const& _a, Up const& _b)
+            { return (_a < _b); }
+        };
+        
+        template<typename Augment>
+        struct is_rbtree_aggregate : public std::false_type {};
+        
+        template<typename Aggregate>
+        struct is_rbtree_aggregate<rbtree_aggregate<Aggregate>> : public std::true_type {};
+    }
+    
     template<
         typename T,
         typename Compare = rbtree_default,
-        typename Allocator = std::allocator<T>>
+        typename Allocator = std::allocator<T>,
+        typename Augment = rbtree_no_augment,
+        typename Stats = rbtree_no_stats>
     class rbtree
     {
         typedef rbtree self_type;
@@ -32,56 +209,147 @@ namespace creek{
         };
         
         struct node
+            : public Augment::node_data
         {
             T value;
-            color_t color;
-            node* parent;
             node* left;
             node* right;
+            
+            node(T const& _value, color_t _color, node* _parent, node* _left, node* _right)
+                : value(_value), left(_left), right(_right), m_parent_color()
+            {
+                parent(_parent);
+                color(_color);
+            }
+            
+            node(T&& _value, color_t _color, node* _parent, node* _left, node* _right)
+                : value(std::move(_value)), left(_left), right(_right), m_parent_color()
+            {
+                parent(_parent);
+                color(_color);
+            }
+            
+            //---- a black node without links, the value built from _args
+            template<typename... Args>
+            explicit node(std::piecewise_construct_t, Args&&... _args)
+                : value(std::forward<Args>(_args)...), left(), right(), m_parent_color()
+            {
+                color(color_t::black);
+            }
+            
+            node* parent() const
+            {
+                return reinterpret_cast<node*>(m_parent_color & ~std::uintptr_t(1));
+            }
+            
+            void parent(node* _a)
+            {
+                m_parent_color = reinterpret_cast<std::uintptr_t>(_a) | (m_parent_color & 1);
+            }
+            
+            color_t color() const
+            {
+                return (m_parent_color & 1) ? color_t::red : color_t::black;
+            }
+            
+            void color(color_t _c)
+            {
+                m_parent_color = (m_parent_color & ~std::uintptr_t(1)) | ((_c == color_t::red) ? 1 : 0);
+            }
+            
+        private:
+            // ---- the parent pointer with the colour in its lowest
+            //      bit, which the alignment of node keeps clear
+            std::uintptr_t m_parent_color;
         };
            
+        static_assert(std::alignment_of<node>::value >= 2, "rbtree::node keeps its colour in the lowest bit of a pointer");
+        
         friend class binary_tree_traits<self_type>;
         
     public:
         typedef T value_type;
         typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
         typedef Allocator allocator_type;
         
+        // pre order
+        typedef tree_iterator<false, pre_order_tag, self_type> pre_order_iterator;
+        typedef tree_iterator<true,  pre_order_tag, self_type> const_pre_order_iterator;
+        typedef tree_iterator<false, reverse_tag<pre_order_tag>, self_type> reverse_pre_order_iterator;
+        typedef tree_iterator<true,  reverse_tag<pre_order_tag>, self_type> const_reverse_pre_order_iterator;
+        // in order
+        typedef tree_iterator<false, in_order_tag, self_type> in_order_iterator;
+        typedef tree_iterator<true,  in_order_tag, self_type> const_in_order_iterator;
+        typedef tree_iterator<false, reverse_tag<in_order_tag>, self_type> reverse_in_order_iterator;
+        typedef tree_iterator<true,  reverse_tag<in_order_tag>, self_type> const_reverse_in_order_iterator;
+        // post order
+        typedef tree_iterator<false, post_order_tag, self_type> post_order_iterator;
+        typedef tree_iterator<true,  post_order_tag, self_type> const_post_order_iterator;
+        typedef tree_iterator<false, reverse_tag<post_order_tag>, self_type> reverse_post_order_iterator;
+        typedef tree_iterator<true,  reverse_tag<post_order_tag>, self_type> const_reverse_post_order_iterator;
+        // level order
+        typedef tree_iterator<false, level_order_tag, self_type> level_order_iterator;
+        typedef tree_iterator<true,  level_order_tag, self_type> const_level_order_iterator;
+        
     private:
         typedef node* node_pointer;
         typedef typename allocator_type::template rebind<node>::other
             node_allocator_type;
+        typedef std::pair<node_pointer, branch_t> leaf_position;
         size_type m_size;
         node* m_root;
+        node* m_rightmost;
         node m_dummy_obj;
         node m_foot_obj;
         node* m_dummy;
         node* m_foot;
         node_allocator_type m_allocator;
         Compare m_compare;
+        typename Stats::counters m_stats;
         
     public:
         explicit rbtree(Compare _cmp = Compare())
             : m_size(),
               m_root(),
+              m_rightmost(),
+              m_dummy_obj(node{value_type(), color_t::black, 0, 0, &m_foot_obj}),
+              m_foot_obj(node{value_type(), color_t::black, &m_dummy_obj, 0, 0}),
+              m_dummy(&m_dummy_obj),
+              m_foot(&m_foot_obj),
+              m_allocator(),
+              m_compare(_cmp),
+              m_stats()
+        {
+        }
+        
+        template<typename Iterator>
+        rbtree(Iterator _first, Iterator _last, Compare _cmp = Compare())
+            : m_size(),
+              m_root(),
+              m_rightmost(),
               m_dummy_obj(node{value_type(), color_t::black, 0, 0, &m_foot_obj}),
               m_foot_obj(node{value_type(), color_t::black, &m_dummy_obj, 0, 0}),
               m_dummy(&m_dummy_obj),
               m_foot(&m_foot_obj),
               m_allocator(),
-              m_compare(_cmp)
+              m_compare(_cmp),
+              m_stats()
         {
+            assign(_first, _last);
         }
         
         rbtree(self_type const& _other)
             : m_size(),
               m_root(),
+              m_rightmost(),
               m_dummy_obj(node{value_type(), color_t::black, 0, 0, &m_foot_obj}),
               m_foot_obj(node{value_type(), color_t::black, &m_dummy_obj, 0, 0}),
               m_dummy(&m_dummy_obj),
               m_foot(&m_foot_obj),
               m_allocator(),
-              m_compare()
+              m_compare(),
+              m_stats()
         {
             *this = _other;
         }
@@ -100,23 +368,40 @@ namespace creek{
             auto end = _other.pre_order_end();
             
             m_root = create_node(*it, color_t::black, m_dummy, 0, 0);
+            copy_node_data(m_root, it.base());
             m_dummy->left = m_root;
             auto jt = pre_order_iterator(m_root);
             while(it != end){
                 auto n = it.base();
                 auto cur = jt.base();
-                if(n->left != 0)
-                    cur->left = create_node(n->left->value, n->left->color, cur, 0, 0);
-                if(n->right != 0)
-                    cur->right = create_node(n->right->value, n->right->color, cur, 0, 0);
+                if(n->left != 0){
+                    cur->left = create_node(n->left->value, n->left->color(), cur, 0, 0);
+                    copy_node_data(cur->left, n->left);
+                }
+                if(n->right != 0){
+                    cur->right = create_node(n->right->value, n->right->color(), cur, 0, 0);
+                    copy_node_data(cur->right, n->right);
+                }
                 ++it;
                 ++jt;
             }
+            reset_rightmost();
             m_compare = _other.m_compare;
             m_allocator = _other.m_allocator;
             return *this;
         }
         
+        // ---- replaces the contents with [_first, _last).
+        //      sorted input is built in O(n) without a single
+        //      comparison after the check, other input is sorted
+        //      first. equal elements keep their order.
+        template<typename Iterator>
+        void assign(Iterator _first, Iterator _last)
+        {
+            clear();
+            assign_range(_first, _last, typename std::iterator_traits<Iterator>::iterator_category());
+        }
+        
         bool operator==(self_type const& _other) const
         {
             if(this == &_other) return true;
@@ -128,7 +413,7 @@ namespace creek{
             auto const empty = const_pre_order_iterator();
             while(it != end){
                 if(*it != *jt) return false;
-                if(it.base()->color != jt.base()->color)
+                if(it.base()->color() != jt.base()->color())
                     return false; 
                 auto lefta = left_child(it);
                 auto righta = right_child(it);
@@ -161,45 +446,103 @@ namespace creek{
         {
             std::swap(m_size, _other.m_size);
             std::swap(m_root, _other.m_root);
+            std::swap(m_rightmost, _other.m_rightmost);
             std::swap(m_allocator, _other.m_allocator);
             std::swap(m_compare, _other.m_compare);
-            m_root->parent = m_dummy;
+            m_root->parent(m_dummy);
             m_dummy->left = m_root;
-            _other.m_root->parent = _other.m_dummy;
+            _other.m_root->parent(_other.m_dummy);
             _other.m_dummy->left = _other.m_root;
         }
         
-        void insert(value_type const& _a)
+        in_order_iterator insert(value_type const& _a)
         {
-            if(empty()){
-                m_root = create_node(_a, color_t::black, m_dummy, 0, 0);
-                m_root->parent = m_dummy;
-                m_dummy->left = m_root;
-                return;
+            leaf_position pos = descent_position(_a);
+            return in_order_iterator(insert_leaf(pos.first, pos.second, _a));
+        }
+        
+        // ---- inserts _a right before _hint if it belongs there or
+        //      right after it, without a descent from the root. other
+        //      hints fall back to insert(_a).
+        in_order_iterator insert(const_in_order_iterator _hint, value_type const& _a)
+        {
+            leaf_position pos = hint_position(_hint.base(), _a);
+            return in_order_iterator(insert_leaf(pos.first, pos.second, _a));
+        }
+        
+        // ---- as insert(_hint, _a), the element built in place from
+        //      _args; it is neither copied nor moved.
+        template<typename... Args>
+        in_order_iterator emplace_hint(const_in_order_iterator _hint, Args&&... _args)
+        {
+            node_pointer a = emplace_node(std::forward<Args>(_args)...);
+            leaf_position pos;
+            try{
+                pos = hint_position(_hint.base(), a->value);
             }
-            node_pointer cur = m_root;
-            while(1){
-                branch_t branch = (compare(_a, cur->value)) ? branch_t::left : branch_t::right;
-                node_pointer& next = (branch == branch_t::left) ? cur->left : cur->right;
-                if(next == 0){
-                    next = create_node(_a, color_t::red, cur, 0, 0);
-                    if(cur->color == color_t::black)
-                        return;
-                    else if(cur->parent->left == cur)
-                        insert_left(cur, branch, _a);
-                    else
-                        insert_right(cur, branch, _a);
-                    return;
-                }else{
-                    cur = next;
-                }
+            catch(...){
+                m_allocator.destroy(a);
+                m_allocator.deallocate(a, 1);
+                throw;
             }
+            ++m_size;
+            return in_order_iterator(link_leaf(pos.first, pos.second, a));
+        }
+        
+        // ---- appends _a, which must not be less than any element.
+        //      amortised O(1) without augmentation.
+        in_order_iterator push_back_max(value_type const& _a)
+        {
+            assert(empty() || !compare(_a, m_rightmost->value));
+            if(empty()) return in_order_iterator(insert_leaf(0, branch_t::left, _a));
+            return in_order_iterator(insert_leaf(m_rightmost, branch_t::right, _a));
+        }
+        
+        // ---- inserts [_first, _last) as insert would one by one,
+        //      equal elements after those in the tree and in their
+        //      order in the batch. the batch is sorted first. one at
+        //      least as large as the tree is merged with the nodes in
+        //      order, which are relinked into a balanced tree in
+        //      O(n + m). a smaller one goes in ascending, each element
+        //      climbing from the one before only as far as its place
+        //      needs, O(log(n / m)) amortised.
+        template<typename Iterator>
+        void insert_batch(Iterator _first, Iterator _last)
+        {
+            std::vector<value_type> v(_first, _last);
+            if(v.empty()) return;
+            auto pred = [this](value_type const& _a, value_type const& _b){ return compare(_a, _b); };
+            if(!std::is_sorted(v.begin(), v.end(), pred)) std::stable_sort(v.begin(), v.end(), pred);
+            if(v.size() >= m_size){
+                merge_rebuild(v);
+                return;
+            }
+            node_pointer finger = insert(v.front()).base();
+            for(std::size_t i = 1; i < v.size(); ++i) finger = insert_after(finger, v[i]);
         }
         
         bool check_invariant() const
         {
             try{
+                if(m_root == 0){
+                    if(m_size != 0 || m_rightmost != 0) throw std::runtime_error("empty");
+                    return true;
+                }
+                if(m_root->color() != color_t::black || m_root->parent() != m_dummy || m_dummy->left != m_root)
+                    throw std::runtime_error("root");
                 check(m_root);
+                size_type n = 0;
+                node_pointer last = 0;
+                for(node_pointer a = m_root; a != 0; a = next_in_subtree(a, m_root)){
+                    if((a->left != 0 && a->left->parent() != a) || (a->right != 0 && a->right->parent() != a))
+                        throw std::runtime_error("parent");
+                    ++n;
+                }
+                for(auto it = in_order_begin(); it != in_order_end(); ++it){
+                    if(last != 0 && compare(it.base()->value, last->value)) throw std::runtime_error("order");
+                    last = it.base();
+                }
+                if(n != m_size || last != m_rightmost) throw std::runtime_error("size");
             }
             catch(std::exception const& e){
                 return false;
@@ -229,6 +572,7 @@ namespace creek{
             }
             destroy_and_deallocate(m_root);
             m_root = 0;
+            m_rightmost = 0;
             m_dummy->left = 0;
         }
         
@@ -237,56 +581,26 @@ namespace creek{
         {
             node_pointer cur = _a.base();
             assert(cur != 0 && cur != m_dummy && cur != m_foot);
-            if(cur->left == 0 && cur->right == 0){
-                node_pointer parent = cur->parent;
-                bool left = parent->left == cur;
-                bool black = cur->color == color_t::black;
-                if(cur->parent->left == cur) cur->parent->left = 0;
-                else cur->parent->right = 0;
-                if(cur == m_root) m_root = 0;
-                destroy_and_deallocate(cur);
-                if(black){
-                    if(left) balance_left(parent);
-                    else     balance_right(parent);
-                }
-            }else if(cur->left == 0 || cur->right == 0){
-                node_pointer parent = cur->parent;
-                node_pointer b = (cur->left != 0) ? cur->left : cur->right;
-                bool left = parent->left == cur;
-                bool black = cur->color == color_t::black;
-                if(left) parent->left = b;
-                else     parent->right = b;
-                b->parent = parent;
-                destroy_and_deallocate(cur);
-                if(black){
-                    if(left) balance_left(parent);
-                    else     balance_right(parent);
-                }
-            }else{
+            count_stat(&rbtree_statistics::m_erases);
+            if(cur == m_rightmost) m_rightmost = prev_node(cur);
+            if(cur->left != 0 && cur->right != 0){
                 node_pointer next = cur->right;
                 while(next->left != 0) next = next->left;
                 std::swap(cur->value, next->value);
-                node_pointer parent = next->parent;
-                bool left = parent->left == next;
-                bool black = next->color == color_t::black;
-                if(parent->left == next) parent->left = next->right;
-                else parent->right = next->right;
-                if(next->right == 0){
-                    destroy_and_deallocate(next);
-                    if(black){
-                        if(left) balance_left(parent);
-                        else     balance_right(parent);
-                    }
-                }else{
-                    node_pointer b = next->right;
-                    b->parent = parent;
-                    destroy_and_deallocate(next);
-                    if(black){
-                        if(left) balance_left(parent);
-                        else     balance_right(parent);
-                    }
-                }
+                if(next == m_rightmost) m_rightmost = cur;
+                cur = next;
             }
+            node_pointer child = (cur->left != 0) ? cur->left : cur->right;
+            node_pointer parent = cur->parent();
+            bool left = parent->left == cur;
+            bool black = cur->color() == color_t::black;
+            if(left) parent->left = child;
+            else     parent->right = child;
+            if(child != 0) child->parent(parent);
+            if(cur == m_root) m_root = child;
+            destroy_and_deallocate(cur);
+            update_path(parent);
+            if(black) erase_fixup(child, parent, left);
         }
         
         size_type size() const
@@ -304,239 +618,459 @@ namespace creek{
             return (m_size == 0);
         }
         
+        Compare const& value_comp() const
+        {
+            return m_compare;
+        }
+        
+        // statistics
+        // stats() and reset_stats() only with rbtree_stats.
+        // depth_histogram and black_height walk any tree.
+        
+        typename Stats::counters const& stats() const
+        {
+            static_assert(Stats::is_enabled, "rbtree::stats needs rbtree_stats");
+            return m_stats;
+        }
+        
+        void reset_stats()
+        {
+            static_assert(Stats::is_enabled, "rbtree::reset_stats needs rbtree_stats");
+            m_stats = typename Stats::counters();
+        }
+        
+        // ---- the number of nodes at every depth, the root at 0
+        std::vector<size_type> depth_histogram() const
+        {
+            std::vector<size_type> h;
+            count_depths(m_root, 0, h);
+            return h;
+        }
+        
+        // ---- black nodes on every path from the root to a leaf
+        size_type black_height() const
+        {
+            return black_height(m_root);
+        }
+        
     private:
+        static void count_depths(node_pointer _a, size_type _depth, std::vector<size_type>& _h)
+        {
+            if(_a == 0) return;
+            if(_h.size() <= _depth) _h.resize(_depth + 1);
+            ++_h[_depth];
+            count_depths(_a->left, _depth + 1, _h);
+            count_depths(_a->right, _depth + 1, _h);
+        }
+        
         void rotate_right(node_pointer _a)
+        {
+            count_stat(&rbtree_statistics::m_rotations);
+            node_pointer left = _a->left;
+            rotate_right_node(_a);
+            if(_a == m_root)
+                m_root = left;
+        }
+        
+        void rotate_left(node_pointer _a)
+        {
+            count_stat(&rbtree_statistics::m_rotations);
+            node_pointer right = _a->right;
+            rotate_left_node(_a);
+            if(_a == m_root)
+                m_root = right;
+        }
+        
+        static void swap_color(node_pointer _a, node_pointer _b)
+        {
+            color_t c = _a->color();
+            _a->color(_b->color());
+            _b->color(c);
+        }
+        
+        static void rotate_right_node(node_pointer _a)
         {
             assert(_a != 0 && _a->left != 0);
             node_pointer left = _a->left;
             _a->left = left->right;
-            if(_a->left != 0) _a->left->parent = _a;
+            if(_a->left != 0) _a->left->parent(_a);
             left->right = _a;
-            left->parent = _a->parent;
-            _a->parent = left;
-            if(left->parent != 0){
-                if(left->parent->left == _a) left->parent->left = left;
-                else left->parent->right = left;
+            left->parent(_a->parent());
+            _a->parent(left);
+            if(left->parent() != 0){
+                if(left->parent()->left == _a) left->parent()->left = left;
+                else left->parent()->right = left;
             }
-            std::swap(_a->color, left->color);
-            if(_a == m_root)
-                m_root = left;
+            swap_color(_a, left);
+            Augment::update(*_a);
+            Augment::update(*left);
         }
         
-        void rotate_left(node_pointer _a)
+        static void rotate_left_node(node_pointer _a)
         {
             assert(_a != 0 && _a->right != 0);
             node_pointer right = _a->right;
             _a->right = right->left;
-            if(_a->right != 0) _a->right->parent = _a;
+            if(_a->right != 0) _a->right->parent(_a);
             right->left = _a;
-            right->parent = _a->parent;
-            _a->parent = right;
-            if(right->parent != 0){
-                if(right->parent->left == _a) right->parent->left = right;
-                else right->parent->right = right;
+            right->parent(_a->parent());
+            _a->parent(right);
+            if(right->parent() != 0){
+                if(right->parent()->left == _a) right->parent()->left = right;
+                else right->parent()->right = right;
             }
-            std::swap(_a->color, right->color);
-            if(_a == m_root)
-                m_root = right;
+            swap_color(_a, right);
+            Augment::update(*_a);
+            Augment::update(*right);
         }
         
-        void change_color(node_pointer _a)
+        // ---- a new node with _a as the _b child of _parent, which
+        //      has none there, or as the root if _parent is 0
+        node_pointer insert_leaf(node_pointer _parent, branch_t _b, value_type const& _a)
         {
-            assert(_a != 0 && _a->left != 0 && _a->right != 0);
-            _a->color = color_t::red;
-            _a->left->color = color_t::black;
-            _a->right->color = color_t::black;
+            return link_leaf(_parent, _b, create_node(_a));
         }
         
-        void insert_left(node_pointer _parent, branch_t _b, value_type const& _a)
+        // ---- links the new node _a as insert_leaf places its value
+        node_pointer link_leaf(node_pointer _parent, branch_t _b, node_pointer _a)
         {
-            assert(_parent != 0);
-            node_pointer grand_parent = _parent->parent;
-            node_pointer uncle = grand_parent->right;
-            if(uncle != 0 && uncle->color == color_t::red){
-                change_color(grand_parent);
-                if(grand_parent == m_root){
-                    m_root->color = color_t::black;
-                    return;
-                }else{
-                    node_pointer ggp = grand_parent->parent;
-                    if(ggp->color == color_t::black)
-                        return;
-                    node_pointer gggp = ggp->parent;
-                    branch_t branch = (ggp->left == grand_parent) ?
-                        branch_t::left : branch_t::right;
-                    if(gggp->left == ggp){
-                        insert_left(ggp, branch, _a);
-                    }else{
-                        insert_right(ggp, branch, _a);
-                    }
+            count_stat(&rbtree_statistics::m_inserts);
+            if(_parent == 0){
+                _a->parent(m_dummy);
+                _a->color(color_t::black);
+                m_root = _a;
+                m_dummy->left = m_root;
+                m_rightmost = m_root;
+                Augment::update(*m_root);
+                return m_root;
+            }
+            node_pointer& link = (_b == branch_t::left) ? _parent->left : _parent->right;
+            assert(link == 0);
+            _a->parent(_parent);
+            _a->color(color_t::red);
+            link = _a;
+            if(_parent == m_rightmost && _b == branch_t::right) m_rightmost = _a;
+            Augment::update(*_a);
+            update_path(_parent);
+            insert_fixup(_a);
+            return _a;
+        }
+        
+        // ---- the leaf insert(_a) links _a to: equal elements
+        //      go after those already in the tree
+        leaf_position descent_position(value_type const& _a)
+        {
+            if(empty()) return leaf_position(node_pointer(0), branch_t::left);
+            node_pointer cur = m_root;
+            while(1){
+                branch_t branch = (compare(_a, cur->value)) ? branch_t::left : branch_t::right;
+                node_pointer next = (branch == branch_t::left) ? cur->left : cur->right;
+                if(next == 0) return leaf_position(cur, branch);
+                cur = next;
+            }
+        }
+        
+        // ---- the leaf next to the hint _h when _a belongs there,
+        //      else the one of the descent
+        leaf_position hint_position(node_pointer _h, value_type const& _a)
+        {
+            if(_h == 0 || _h == m_dummy){
+                if(!empty() && !compare(_a, m_rightmost->value))
+                    return leaf_position(m_rightmost, branch_t::right);
+                return descent_position(_a);
+            }
+            if(!compare(_h->value, _a)){
+                node_pointer prev = prev_node(_h);
+                if(prev == 0 || !compare(_a, prev->value)){
+                    if(_h->left == 0) return leaf_position(_h, branch_t::left);
+                    return leaf_position(prev, branch_t::right);
                 }
             }else{
-                if(_b == branch_t::left){
-                    rotate_right(grand_parent);
-                    return;
-                }else{
-                    rotate_left(_parent);
-                    rotate_right(grand_parent);
-                    return;
+                node_pointer next = (_h == m_rightmost) ? 0 : next_node(_h);
+                if(next == 0 || !compare(next->value, _a)){
+                    if(_h->right == 0) return leaf_position(_h, branch_t::right);
+                    return leaf_position(next, branch_t::left);
                 }
             }
+            return descent_position(_a);
         }
         
-        void insert_right(node_pointer _parent, branch_t _b, value_type const& _a)
+        // ---- in order neighbours, 0 past either end
+        node_pointer next_node(node_pointer _a) const
         {
-            assert(_parent != 0);
-            node_pointer grand_parent = _parent->parent;
-            node_pointer uncle = grand_parent->left;
-            if(uncle != 0 && uncle->color == color_t::red){
-                change_color(grand_parent);
-                if(grand_parent == m_root){
-                    m_root->color = color_t::black;
-                    return;
-                }else{
-                    node_pointer ggp = grand_parent->parent;
-                    if(ggp->color == color_t::black)
-                        return;
-                    node_pointer gggp = ggp->parent;
-                    branch_t branch = (ggp->left == grand_parent) ?
-                        branch_t::left : branch_t::right;
-                    if(gggp->left == ggp){
-                        insert_left(ggp, branch, _a);
-                    }else{
-                        insert_right(ggp, branch, _a);
+            if(_a->right != 0){
+                _a = _a->right;
+                while(_a->left != 0) _a = _a->left;
+                return _a;
+            }
+            while(_a->parent() != m_dummy && _a->parent()->right == _a) _a = _a->parent();
+            return (_a->parent() == m_dummy) ? 0 : _a->parent();
+        }
+        
+        node_pointer prev_node(node_pointer _a) const
+        {
+            if(_a->left != 0){
+                _a = _a->left;
+                while(_a->right != 0) _a = _a->right;
+                return _a;
+            }
+            while(_a->parent() != m_dummy && _a->parent()->left == _a) _a = _a->parent();
+            return (_a->parent() == m_dummy) ? 0 : _a->parent();
+        }
+        
+        void reset_rightmost()
+        {
+            m_rightmost = m_root;
+            if(m_rightmost == 0) return;
+            while(m_rightmost->right != 0) m_rightmost = m_rightmost->right;
+        }
+        
+        // ---- _a is red and may have a red parent. recolouring moves
+        //      the conflict two levels up, at most two rotations end it.
+        void insert_fixup(node_pointer _a)
+        {
+            while(_a != m_root && _a->parent()->color() == color_t::red){
+                count_stat(&rbtree_statistics::m_insert_fixup_steps);
+                node_pointer parent = _a->parent();
+                node_pointer grand_parent = parent->parent();
+                if(grand_parent->left == parent){
+                    node_pointer uncle = grand_parent->right;
+                    if(uncle != 0 && uncle->color() == color_t::red){
+                        parent->color(color_t::black);
+                        uncle->color(color_t::black);
+                        grand_parent->color(color_t::red);
+                        count_stat(&rbtree_statistics::m_recolours, 3);
+                        _a = grand_parent;
+                        continue;
                     }
-                }
-            }else{
-                if(_b == branch_t::right){
-                    rotate_left(grand_parent);
+                    if(parent->right == _a) rotate_left(parent);
+                    rotate_right(grand_parent);
                     return;
                 }else{
-                    rotate_right(_parent);
+                    node_pointer uncle = grand_parent->left;
+                    if(uncle != 0 && uncle->color() == color_t::red){
+                        parent->color(color_t::black);
+                        uncle->color(color_t::black);
+                        grand_parent->color(color_t::red);
+                        count_stat(&rbtree_statistics::m_recolours, 3);
+                        _a = grand_parent;
+                        continue;
+                    }
+                    if(parent->left == _a) rotate_right(parent);
                     rotate_left(grand_parent);
                     return;
                 }
             }
+            if(Stats::is_enabled && m_root->color() == color_t::red)
+                count_stat(&rbtree_statistics::m_recolours);
+            m_root->color(color_t::black);
         }
         
-        void balance_left(node_pointer _a)
+        // ---- the subtree _a, the _left child of _parent, lacks one
+        //      black node. a red sibling is rotated up first, then
+        //      either the sibling is recoloured and the lack moves one
+        //      level up, or at most two more rotations end it. rotate
+        //      swaps the colours of the two nodes it turns.
+        void erase_fixup(node_pointer _a, node_pointer _parent, bool _left)
         {
-            assert(_a != 0);
-            if(_a->left == m_root){
-                return;
-            }else if(_a->right == 0){
-                if(_a->parent->left == _a->parent)
-                    balance_left(_a->parent);
-                else
-                    balance_right(_a->parent);
-            }else{
-                node_pointer parent = _a;
-                node_pointer bro = parent->right;
-                if(bro->color == color_t::red){
-                    rotate_left(parent);
-                    balance_left(parent);
-                }else if(bro->right != 0 && bro->right->color == color_t::red){
-                    rotate_left(parent);
-                    bro->right->color = color_t::black;
-                }else if(bro->left != 0 && bro->left->color == color_t::red){
-                    rotate_right(bro);
-                    rotate_left(parent);
-                    bro->color = color_t::black;
-                }else if(parent->color == color_t::red){
-                    bro->color = color_t::red;
-                    parent->color = color_t::black;
+            while(_a != m_root && (_a == 0 || _a->color() == color_t::black)){
+                count_stat(&rbtree_statistics::m_erase_fixup_steps);
+                if(_left){
+                    node_pointer bro = _parent->right;
+                    if(bro->color() == color_t::red){
+                        rotate_left(_parent);
+                        bro = _parent->right;
+                    }
+                    if(!is_red(bro->left) && !is_red(bro->right)){
+                        bro->color(color_t::red);
+                        count_stat(&rbtree_statistics::m_recolours);
+                        _a = _parent;
+                    }else{
+                        if(!is_red(bro->right)){
+                            rotate_right(bro);
+                            bro = _parent->right;
+                        }
+                        rotate_left(_parent);
+                        bro->right->color(color_t::black);
+                        count_stat(&rbtree_statistics::m_recolours);
+                        return;
+                    }
                 }else{
-                    bro->color = color_t::red;
-                    if(parent->parent->left == parent) balance_left(parent->parent);
-                    else balance_right(parent->parent);
+                    node_pointer bro = _parent->left;
+                    if(bro->color() == color_t::red){
+                        rotate_right(_parent);
+                        bro = _parent->left;
+                    }
+                    if(!is_red(bro->left) && !is_red(bro->right)){
+                        bro->color(color_t::red);
+                        count_stat(&rbtree_statistics::m_recolours);
+                        _a = _parent;
+                    }else{
+                        if(!is_red(bro->left)){
+                            rotate_left(bro);
+                            bro = _parent->left;
+                        }
+                        rotate_right(_parent);
+                        bro->left->color(color_t::black);
+                        count_stat(&rbtree_statistics::m_recolours);
+                        return;
+                    }
                 }
+                _parent = _a->parent();
+                _left = _parent->left == _a;
             }
+            if(_a == 0) return;
+            if(Stats::is_enabled && _a->color() == color_t::red)
+                count_stat(&rbtree_statistics::m_recolours);
+            _a->color(color_t::black);
         }
         
-        void balance_right(node_pointer _a)
+        // ---- adds _n to a counter of Stats
+        void count_stat(std::size_t rbtree_statistics::* _field, std::size_t _n = 1)
         {
-            assert(_a != 0);
-            if(_a->right == m_root){
-                return;
-            }else if(_a->left == 0){
-                if(_a->parent->left == _a->parent)
-                    balance_left(_a->parent);
-                else
-                    balance_right(_a->parent);
-            }else{
-                node_pointer parent = _a;
-                node_pointer bro = parent->left;
-                if(bro->color == color_t::red){
-                    rotate_right(parent);
-                    balance_right(parent);
-                }else if(bro->left != 0 && bro->left->color == color_t::red){
-                    rotate_right(parent);
-                    bro->left->color = color_t::black;
-                }else if(bro->right != 0 && bro->right->color == color_t::red){
-                    rotate_left(bro);
-                    rotate_right(parent);
-                    bro->color = color_t::black;
-                }else if(parent->color == color_t::red){
-                    bro->color = color_t::red;
-                    parent->color = color_t::black;
-                }else{
-                    bro->color = color_t::red;
-                    if(parent->parent->left == parent) balance_left(parent->parent);
-                    else balance_right(parent->parent);
-                }
-            }
+            Stats::count(m_stats, _field, _n);
         }
         
-        static size_type check(node_pointer _a)
+        static bool is_red(node_pointer _a)
         {
-            if(_a == 0) return 0;
-            if(_a->color == color_t::red){
-                if(_a->left != 0 && _a->left->color == color_t::red) throw std::runtime_error("red");
-                if(_a->right != 0 && _a->right->color == color_t::red) throw std::runtime_error("red");
-            }
-            size_type left = check(_a->left);
-            size_type right = check(_a->right);
-            if(left != right) throw std::runtime_error("black");
-            
-            if(_a->color == color_t::black) return left + 1;
-            else return left;
+            return _a != 0 && _a->color() == color_t::red;
         }
         
-        template<typename Tp>
+        // ---- node data of _a and of everything above it
+        void update_path(node_pointer _a)
+        {
+            if(!Augment::is_enabled) return;
+            for(; _a != 0 && _a != m_dummy; _a = _a->parent())
+                Augment::update(*_a);
+        }
+        
+        static void copy_node_data(node_pointer _a, node_pointer _b)
+        {
+            static_cast<typename Augment::node_data&>(*_a) = *_b;
+        }
+        
+        static size_type subtree_size(node_pointer _a)
+        {
+            return (_a != 0) ? _a->m_count : 0;
+        }
+        
+        template<typename Key>
+        size_type count_impl(Key const& _key, std::false_type) const
+        {
+            auto r = equal_range(_key);
+            return static_cast<size_type>(std::distance(r.first, r.second));
+        }
+        
+        template<typename Key>
+        size_type count_impl(Key const& _key, std::true_type) const
+        {
+            return rank_impl(upper_bound_node(_key)) - rank_impl(lower_bound_node(_key));
+        }
+        
+        // ---- number of nodes before _a in order, size() for m_dummy
+        size_type rank_impl(node_pointer _a) const
+        {
+            if(_a == 0 || _a == m_dummy) return m_size;
+            size_type r = subtree_size(_a->left);
+            for(; _a->parent() != m_dummy; _a = _a->parent()){
+                if(_a->parent()->right == _a) r += subtree_size(_a->parent()->left) + 1;
+            }
+            return r;
+        }
+        
+        static size_type check(node_pointer _a)
+        {
+            if(_a == 0) return 0;
+            if(_a->color() == color_t::red){
+                if(_a->left != 0 && _a->left->color() == color_t::red) throw std::runtime_error("red");
+                if(_a->right != 0 && _a->right->color() == color_t::red) throw std::runtime_error("red");
+            }
+            size_type left = check(_a->left);
+            size_type right = check(_a->right);
+            if(left != right) throw std::runtime_error("black");
+            
+            if(_a->color() == color_t::black) return left + 1;
+            else return left;
+        }
+        
+        template<typename Tp, typename Up>
         inline static typename std::enable_if<
             std::is_same<Tp, Tp>::value &&
             std::is_same<Compare, rbtree_default>::value, bool>::type
-        compare(Tp const& _a, Tp const& _b)
+        compare(Tp const& _a, Up const& _b)
         {
             return (_a < _b);
         }
         
-        template<typename Tp>
+        template<typename Tp, typename Up>
         inline typename std::enable_if<
             std::is_same<Tp, Tp>::value &&
             !std::is_same<Compare, rbtree_default>::value, bool>::type
-        compare(Tp const& _a, Tp const& _b) const
+        compare(Tp const& _a, Up const& _b) const
         {
             return m_compare(_a, _b);
         }
         
-    public:
-        // pre order
-        typedef tree_iterator<false, pre_order_tag, self_type> pre_order_iterator;
-        typedef tree_iterator<true,  pre_order_tag, self_type> const_pre_order_iterator;
-        typedef tree_iterator<false, reverse_tag<pre_order_tag>, self_type> reverse_pre_order_iterator;
-        typedef tree_iterator<true,  reverse_tag<pre_order_tag>, self_type> const_reverse_pre_order_iterator;
-        // in order
-        typedef tree_iterator<false, in_order_tag, self_type> in_order_iterator;
-        typedef tree_iterator<true,  in_order_tag, self_type> const_in_order_iterator;
-        typedef tree_iterator<false, reverse_tag<in_order_tag>, self_type> reverse_in_order_iterator;
-        typedef tree_iterator<true,  reverse_tag<in_order_tag>, self_type> const_reverse_in_order_iterator;
-        // post order
-        typedef tree_iterator<false, post_order_tag, self_type> post_order_iterator;
-        typedef tree_iterator<true,  post_order_tag, self_type> const_post_order_iterator;
-        typedef tree_iterator<false, reverse_tag<post_order_tag>, self_type> reverse_post_order_iterator;
-        typedef tree_iterator<true,  reverse_tag<post_order_tag>, self_type> const_reverse_post_order_iterator;
+        // ---- key type of a lookup
+        template<typename Key>
+        struct lookup_key
+        {
+            typedef typename std::conditional<
+                detail::is_transparent_compare<Compare>::value, Key, value_type>::type type;
+            static bool const value =
+                detail::is_transparent_compare<Compare>::value ||
+                std::is_convertible<Key const&, value_type>::value;
+        };
         
+        // ---- first node not less than _key, m_dummy if none
+        template<typename Key>
+        node_pointer lower_bound_node(Key const& _key) const
+        {
+            node_pointer result = m_dummy;
+            node_pointer cur = m_root;
+            while(cur != 0){
+                if(compare(cur->value, _key)){
+                    cur = cur->right;
+                }else{
+                    result = cur;
+                    cur = cur->left;
+                }
+            }
+            return result;
+        }
+        
+        // ---- first node greater than _key, m_dummy if none
+        template<typename Key>
+        node_pointer upper_bound_node(Key const& _key) const
+        {
+            node_pointer result = m_dummy;
+            node_pointer cur = m_root;
+            while(cur != 0){
+                if(compare(_key, cur->value)){
+                    result = cur;
+                    cur = cur->left;
+                }else{
+                    cur = cur->right;
+                }
+            }
+            return result;
+        }
+        
+        template<typename Key>
+        node_pointer find_node(Key const& _key) const
+        {
+            node_pointer a = lower_bound_node(_key);
+            if(a == m_dummy || compare(_key, a->value)) return m_dummy;
+            return a;
+        }
+        
+        // ---- the end of the in order walk, 0 for an empty tree
+        node_pointer in_order_node(node_pointer _a) const
+        {
+            return (m_root == 0) ? 0 : _a;
+        }
+        
+    public:
         // pre order
         const_pre_order_iterator pre_order_begin() const
         {
@@ -631,6 +1165,300 @@ namespace creek{
             return reverse_in_order_iterator(in_order_begin().base());
         }
         
+        // lookup
+        //     keys of another type than value_type are taken as they are
+        //     when the comparator is transparent (or rbtree_default).
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, const_in_order_iterator>::type
+        find(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return const_in_order_iterator(in_order_node(find_node<key_type>(_key)));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, in_order_iterator>::type
+        find(Key const& _key)
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return in_order_iterator(in_order_node(find_node<key_type>(_key)));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, const_in_order_iterator>::type
+        lower_bound(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return const_in_order_iterator(in_order_node(lower_bound_node<key_type>(_key)));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, in_order_iterator>::type
+        lower_bound(Key const& _key)
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return in_order_iterator(in_order_node(lower_bound_node<key_type>(_key)));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, const_in_order_iterator>::type
+        upper_bound(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return const_in_order_iterator(in_order_node(upper_bound_node<key_type>(_key)));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, in_order_iterator>::type
+        upper_bound(Key const& _key)
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return in_order_iterator(in_order_node(upper_bound_node<key_type>(_key)));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value,
+            std::pair<const_in_order_iterator, const_in_order_iterator>>::type
+        equal_range(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return std::make_pair(
+                const_in_order_iterator(in_order_node(lower_bound_node<key_type>(_key))),
+                const_in_order_iterator(in_order_node(upper_bound_node<key_type>(_key))));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value,
+            std::pair<in_order_iterator, in_order_iterator>>::type
+        equal_range(Key const& _key)
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return std::make_pair(
+                in_order_iterator(in_order_node(lower_bound_node<key_type>(_key))),
+                in_order_iterator(in_order_node(upper_bound_node<key_type>(_key))));
+        }
+        
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, size_type>::type
+        count(Key const& _key) const
+        {
+            typedef typename lookup_key<Key>::type key_type;
+            return count_impl<key_type>(_key, has_order_statistics());
+        }
+        
+        // order statistics
+        // only with rbtree_order_statistics, which keeps the size of
+        // every subtree in its node. all of these are O(log n).
+        
+        // ---- the element at position _k in order, in_order_end() if _k >= size()
+        const_in_order_iterator nth(size_type _k) const
+        {
+            static_assert(has_order_statistics::value, "rbtree::nth needs rbtree_order_statistics");
+            if(_k >= m_size) return in_order_end();
+            node_pointer cur = m_root;
+            while(1){
+                size_type left = subtree_size(cur->left);
+                if(_k < left){
+                    cur = cur->left;
+                }else if(_k == left){
+                    return const_in_order_iterator(cur);
+                }else{
+                    _k -= left + 1;
+                    cur = cur->right;
+                }
+            }
+        }
+        
+        in_order_iterator nth(size_type _k)
+        {
+            return in_order_iterator(((self_type const&)*this).nth(_k).base());
+        }
+        
+        // ---- number of elements less than _key
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value, size_type>::type
+        rank(Key const& _key) const
+        {
+            static_assert(has_order_statistics::value, "rbtree::rank needs rbtree_order_statistics");
+            typedef typename lookup_key<Key>::type key_type;
+            size_type r = 0;
+            node_pointer cur = m_root;
+            while(cur != 0){
+                if(compare(cur->value, static_cast<key_type const&>(_key))){
+                    r += subtree_size(cur->left) + 1;
+                    cur = cur->right;
+                }else{
+                    cur = cur->left;
+                }
+            }
+            return r;
+        }
+        
+        // ---- position of _a in order, size() for in_order_end()
+        size_type index(const_in_order_iterator _a) const
+        {
+            static_assert(has_order_statistics::value, "rbtree::index needs rbtree_order_statistics");
+            return rank_impl(_a.base());
+        }
+        
+        // ---- std::distance(_first, _last) without walking
+        difference_type distance(const_in_order_iterator _first, const_in_order_iterator _last) const
+        {
+            return static_cast<difference_type>(index(_last)) - static_cast<difference_type>(index(_first));
+        }
+        
+        // aggregates
+        // only with rbtree_aggregate, which keeps the Aggregate of
+        // every subtree in its node.
+        
+        // ---- Aggregate of all elements, O(1)
+        template<typename G = Augment>
+        typename G::result_type aggregate() const
+        {
+            static_assert(has_aggregate::value, "rbtree::aggregate needs rbtree_aggregate");
+            return G::aggregate(m_root);
+        }
+        
+        // ---- Aggregate of the elements in [_lo, _hi) in order, O(log n)
+        template<typename Key, typename G = Augment>
+        typename std::enable_if<lookup_key<Key>::value, typename G::result_type>::type
+        aggregate(Key const& _lo, Key const& _hi) const
+        {
+            static_assert(has_aggregate::value, "rbtree::aggregate needs rbtree_aggregate");
+            typedef typename lookup_key<Key>::type key_type;
+            typedef typename G::result_type result_type;
+            key_type const& lo = _lo;
+            key_type const& hi = _hi;
+            typename G::aggregate_type g;
+            
+            // the highest node in range parts the two bounds
+            node_pointer top = m_root;
+            while(top != 0){
+                if(compare(top->value, lo)) top = top->right;
+                else if(!compare(top->value, hi)) top = top->left;
+                else break;
+            }
+            if(top == 0) return g.identity();
+            
+            result_type left = g.identity();
+            for(node_pointer cur = top->left; cur != 0;){
+                if(compare(cur->value, lo)){
+                    cur = cur->right;
+                }else{
+                    left = g.combine(g.combine(g.lift(cur->value), G::aggregate(cur->right)), left);
+                    cur = cur->left;
+                }
+            }
+            result_type right = g.identity();
+            for(node_pointer cur = top->right; cur != 0;){
+                if(compare(cur->value, hi)){
+                    right = g.combine(right, g.combine(G::aggregate(cur->left), g.lift(cur->value)));
+                    cur = cur->right;
+                }else{
+                    cur = cur->left;
+                }
+            }
+            return g.combine(g.combine(left, g.lift(top->value)), right);
+        }
+        
+        // split and join
+        // both trees have to use equal allocators, the nodes change
+        // hands. split is O(log n) with rbtree_order_statistics and
+        // else counts the smaller of the two halves.
+        
+        // ---- *this keeps the elements less than _key, the others go to _right
+        template<typename Key>
+        typename std::enable_if<lookup_key<Key>::value>::type
+        split(Key const& _key, self_type& _right)
+        {
+            assert(&_right != this && m_allocator == _right.m_allocator);
+            typedef typename lookup_key<Key>::type key_type;
+            _right.clear();
+            size_type total = m_size;
+            std::pair<subtree, subtree> p = split_nodes<key_type>(release_root(), _key, false);
+            size_type left = count_left(p.first.root, p.second.root, total);
+            attach_root(p.first);
+            _right.attach_root(p.second);
+            m_size = left;
+            _right.m_size = total - left;
+        }
+        
+        // ---- appends _pivot and the elements of _right, which have
+        //      to be ordered after *this and _pivot. _right is left empty.
+        void join(value_type const& _pivot, self_type& _right)
+        {
+            assert(&_right != this && m_allocator == _right.m_allocator);
+            assert(empty() || !compare(_pivot, *std::prev(in_order_end())));
+            assert(_right.empty() || !compare(*_right.in_order_begin(), _pivot));
+            node_pointer k = create_node(_pivot);
+            subtree r = _right.release_root();
+            attach_root(join_nodes(release_root(), k, r));
+            m_size += _right.m_size;
+            _right.m_size = 0;
+        }
+        
+        void join(self_type& _right)
+        {
+            assert(&_right != this && m_allocator == _right.m_allocator);
+            assert(empty() || _right.empty() || !compare(*_right.in_order_begin(), *std::prev(in_order_end())));
+            subtree r = _right.release_root();
+            attach_root(concat(release_root(), r));
+            m_size += _right.m_size;
+            _right.m_size = 0;
+        }
+        
+        // set operations
+        // elements are matched by equivalence, all elements of *this
+        // equivalent to one of _other count as found. the two halves
+        // of every step run through _pool.fork while the subtree of
+        // _other they work on has more than about _grain nodes; a
+        // parallel::thread_pool runs them as tasks, the default
+        // rbtree_sequential one after the other.
+        
+        // ---- moves the elements of _other not found in *this over,
+        //      _other is left empty.
+        template<typename Pool = rbtree_sequential>
+        void union_with(self_type& _other, size_type _grain = 1024, Pool&& _pool = Pool())
+        {
+            assert(m_allocator == _other.m_allocator);
+            if(&_other == this) return;
+            set_context<typename std::remove_reference<Pool>::type> c(_pool, _grain);
+            subtree a = release_root();
+            subtree b = _other.release_root();
+            attach_root(union_nodes(a, b, c));
+            for(std::size_t i = 0; i < c.m_dropped.size(); ++i)
+                _other.erase(c.m_dropped[i]);
+            m_size += _other.m_size;
+            _other.m_size = 0;
+        }
+        
+        // ---- keeps the elements found in _other
+        template<typename Pool = rbtree_sequential>
+        void intersect_with(self_type const& _other, size_type _grain = 1024, Pool&& _pool = Pool())
+        {
+            if(&_other == this) return;
+            set_context<typename std::remove_reference<Pool>::type> c(_pool, _grain);
+            subtree a = release_root();
+            attach_root(intersect_nodes(a, _other.m_root, black_height(_other.m_root), c));
+            for(std::size_t i = 0; i < c.m_dropped.size(); ++i)
+                erase(c.m_dropped[i]);
+        }
+        
+        // ---- removes the elements found in _other
+        template<typename Pool = rbtree_sequential>
+        void difference_with(self_type const& _other, size_type _grain = 1024, Pool&& _pool = Pool())
+        {
+            if(&_other == this){
+                clear();
+                return;
+            }
+            set_context<typename std::remove_reference<Pool>::type> c(_pool, _grain);
+            subtree a = release_root();
+            attach_root(difference_nodes(a, _other.m_root, black_height(_other.m_root), c));
+            for(std::size_t i = 0; i < c.m_dropped.size(); ++i)
+                erase(c.m_dropped[i]);
+        }
+        
         // post order
         const_post_order_iterator post_order_begin() const
         {
@@ -682,7 +1510,47 @@ namespace creek{
             return reverse_post_order_iterator(post_order_begin().base());
         }
         
+        // level order
+        const_level_order_iterator level_order_begin() const
+        {
+            return const_level_order_iterator(level_position::at_depth(m_root, 0, false));
+        }
+        
+        const_level_order_iterator level_order_end() const
+        {
+            return const_level_order_iterator();
+        }
+        
+        level_order_iterator level_order_begin()
+        {
+            return level_order_iterator(level_position::at_depth(m_root, 0, false));
+        }
+        
+        level_order_iterator level_order_end()
+        {
+            return level_order_iterator();
+        }
+        
+        // nodes at depth _depth from left to right, the root at 0
+        std::pair<const_level_order_iterator, const_level_order_iterator> level_range(size_type _depth) const
+        {
+            return std::make_pair(
+                const_level_order_iterator(level_position::at_depth(m_root, _depth, true)),
+                const_level_order_iterator());
+        }
+        
+        std::pair<level_order_iterator, level_order_iterator> level_range(size_type _depth)
+        {
+            return std::make_pair(
+                level_order_iterator(level_position::at_depth(m_root, _depth, true)),
+                level_order_iterator());
+        }
+        
     private:
+        typedef typename level_order_iterator::sub_iterator level_position;
+        typedef std::is_base_of<rbtree_order_statistics::node_data, node> has_order_statistics;
+        typedef detail::is_rbtree_aggregate<Augment> has_aggregate;
+        
         node_pointer create_node(value_type const& _v)
         {
             node_pointer tmp = m_allocator.allocate(1);
@@ -697,6 +1565,22 @@ namespace creek{
             return tmp;
         }
         
+        // ---- unlike create_node, leaves m_size to the caller, which
+        //      still has to place the node
+        template<typename... Args>
+        node_pointer emplace_node(Args&&... _args)
+        {
+            node_pointer tmp = m_allocator.allocate(1);
+            try{
+                m_allocator.construct(tmp, std::piecewise_construct, std::forward<Args>(_args)...);
+            }
+            catch(...){
+                m_allocator.deallocate(tmp, 1);
+                throw;
+            }
+            return tmp;
+        }
+        
         node_pointer create_node(
             value_type const& _v, color_t _color,
             node_pointer _parent, node_pointer _left, node_pointer _right)
@@ -713,6 +1597,136 @@ namespace creek{
             return tmp;
         }
         
+        template<typename Iterator>
+        void assign_range(Iterator _first, Iterator _last, std::input_iterator_tag)
+        {
+            std::vector<value_type> v(_first, _last);
+            assign_range(v.begin(), v.end(), std::random_access_iterator_tag());
+        }
+        
+        template<typename RAIterator>
+        void assign_range(RAIterator _first, RAIterator _last, std::random_access_iterator_tag)
+        {
+            auto pred = [this](value_type const& _a, value_type const& _b){ return compare(_a, _b); };
+            if(std::is_sorted(_first, _last, pred)){
+                build(_first, _last);
+            }else{
+                std::vector<value_type> v(_first, _last);
+                std::stable_sort(v.begin(), v.end(), pred);
+                build(v.begin(), v.end());
+            }
+        }
+        
+        // ---- a perfectly balanced tree from sorted input. every
+        //      path to a leaf has the same length give or take one,
+        //      so colouring the deepest level red and the rest black
+        //      keeps the black heights equal.
+        template<typename RAIterator>
+        void build(RAIterator _first, RAIterator _last)
+        {
+            size_type n = _last - _first;
+            if(n == 0) return;
+            size_type depth = 0;
+            while((size_type(2) << depth) <= n) ++depth;
+            try{
+                build(_first, _last, m_dummy, m_dummy->left, 0, depth);
+            }
+            catch(...){
+                m_root = m_dummy->left;
+                clear();
+                throw;
+            }
+            m_root = m_dummy->left;
+            reset_rightmost();
+            count_stat(&rbtree_statistics::m_inserts, n);
+        }
+        
+        template<typename RAIterator>
+        void build(RAIterator _first, RAIterator _last, node_pointer _parent, node_pointer& _link,
+            size_type _depth, size_type _red_depth)
+        {
+            if(_first == _last) return;
+            RAIterator mid = _first + (_last - _first) / 2;
+            color_t color = (_depth == _red_depth && _depth != 0) ? color_t::red : color_t::black;
+            _link = create_node(*mid, color, _parent, 0, 0);
+            build(_first, mid, _link, _link->left, _depth + 1, _red_depth);
+            build(mid + 1, _last, _link, _link->right, _depth + 1, _red_depth);
+            Augment::update(*_link);
+        }
+        
+        // ---- inserts _a, which is not less than the value of
+        //      _finger. the climb stops below the first ancestor
+        //      greater than _a to its right, the descent from there
+        //      finds the leaf.
+        node_pointer insert_after(node_pointer _finger, value_type const& _a)
+        {
+            assert(!compare(_a, _finger->value));
+            node_pointer cur = _finger;
+            while(cur != m_root){
+                node_pointer parent = cur->parent();
+                if(parent->left == cur && compare(_a, parent->value)) break;
+                cur = parent;
+            }
+            while(1){
+                branch_t branch = (compare(_a, cur->value)) ? branch_t::left : branch_t::right;
+                node_pointer next = (branch == branch_t::left) ? cur->left : cur->right;
+                if(next == 0) return insert_leaf(cur, branch, _a);
+                cur = next;
+            }
+        }
+        
+        // ---- the nodes in order merged with new nodes for the
+        //      sorted _v, equal ones of the tree first, relinked as
+        //      build links a sorted range
+        void merge_rebuild(std::vector<value_type> const& _v)
+        {
+            std::vector<node_pointer> nodes;
+            std::vector<node_pointer> fresh;
+            nodes.reserve(m_size + _v.size());
+            fresh.reserve(_v.size());
+            try{
+                for(std::size_t i = 0; i < _v.size(); ++i) fresh.push_back(create_node(_v[i]));
+            }
+            catch(...){
+                for(std::size_t i = 0; i < fresh.size(); ++i) destroy_and_deallocate(fresh[i]);
+                throw;
+            }
+            
+            node_pointer a = in_order_begin().base();
+            for(std::size_t i = 0; i < fresh.size(); ++i){
+                while(a != 0 && !compare(fresh[i]->value, a->value)){
+                    nodes.push_back(a);
+                    a = next_node(a);
+                }
+                nodes.push_back(fresh[i]);
+            }
+            for(; a != 0; a = next_node(a)) nodes.push_back(a);
+            
+            size_type depth = 0;
+            while((size_type(2) << depth) <= nodes.size()) ++depth;
+            link(nodes.data(), nodes.data() + nodes.size(), m_dummy, m_dummy->left, 0, depth);
+            m_root = m_dummy->left;
+            reset_rightmost();
+            count_stat(&rbtree_statistics::m_inserts, _v.size());
+        }
+        
+        void link(node_pointer const* _first, node_pointer const* _last, node_pointer _parent,
+            node_pointer& _link, size_type _depth, size_type _red_depth)
+        {
+            if(_first == _last){
+                _link = 0;
+                return;
+            }
+            node_pointer const* mid = _first + (_last - _first) / 2;
+            node_pointer a = *mid;
+            a->parent(_parent);
+            a->color((_depth == _red_depth && _depth != 0) ? color_t::red : color_t::black);
+            _link = a;
+            link(_first, mid, a, a->left, _depth + 1, _red_depth);
+            link(mid + 1, _last, a, a->right, _depth + 1, _red_depth);
+            Augment::update(*a);
+        }
+        
         void destroy_and_deallocate(node_pointer _node)
         {
             m_allocator.destroy(_node);
@@ -738,7 +1752,7 @@ namespace creek{
                 destroy_and_deallocate(tmp.base());
             }
             
-            node_pointer p = _a->parent;
+            node_pointer p = _a->parent();
             if(p != 0){
                 if(p->left == _a) p->left = 0;
                 else if(p->right == _a) p->right = 0;
@@ -746,6 +1760,331 @@ namespace creek{
             if(_a == m_root) m_root = 0;
             destroy_and_deallocate(_a);
         }
+        
+        //-----------------------------------------------------------
+        //    join based operations
+        //    work on detached subtrees: the root has no parent and is
+        //    black, its black height is carried along so that a join
+        //    costs the difference of the two heights only.
+        //-----------------------------------------------------------
+        struct subtree
+        {
+            node_pointer root;
+            size_type height;
+        };
+        
+        static subtree make_subtree(node_pointer _a, size_type _height)
+        {
+            subtree t = {_a, _height};
+            return t;
+        }
+        
+        static size_type black_height(node_pointer _a)
+        {
+            size_type h = 0;
+            for(; _a != 0; _a = _a->left)
+                if(_a->color() == color_t::black) ++h;
+            return h;
+        }
+        
+        subtree release_root()
+        {
+            node_pointer a = m_root;
+            m_root = 0;
+            m_rightmost = 0;
+            m_dummy->left = 0;
+            if(a == 0) return make_subtree(0, 0);
+            a->parent(0);
+            a->color(color_t::black);
+            return make_subtree(a, black_height(a));
+        }
+        
+        void attach_root(subtree _t)
+        {
+            m_root = _t.root;
+            m_dummy->left = m_root;
+            if(m_root != 0) m_root->parent(m_dummy);
+            reset_rightmost();
+        }
+        
+        // ---- cuts the child _link of the root of _t off as a subtree of its own
+        static subtree detach(subtree _t, node_pointer& _link)
+        {
+            node_pointer c = _link;
+            _link = 0;
+            if(c == 0) return make_subtree(0, 0);
+            size_type h = (c->color() == color_t::black) ? _t.height - 1 : _t.height;
+            c->parent(0);
+            c->color(color_t::black);
+            return make_subtree(c, h);
+        }
+        
+        // ---- _l, _k and _r in this order. _k goes down the spine of the
+        //      higher tree to the first black node as high as the other
+        //      tree, then the red-red conflicts are fixed going up.
+        static subtree join_nodes(subtree _l, node_pointer _k, subtree _r)
+        {
+            _k->parent(0);
+            if(_l.height == _r.height){
+                _k->left = _l.root;
+                _k->right = _r.root;
+                if(_l.root != 0) _l.root->parent(_k);
+                if(_r.root != 0) _r.root->parent(_k);
+                _k->color(color_t::black);
+                Augment::update(*_k);
+                return make_subtree(_k, _l.height + 1);
+            }
+            bool right = _l.height > _r.height;
+            subtree& high = right ? _l : _r;
+            subtree& low = right ? _r : _l;
+            node_pointer p = 0;
+            node_pointer c = high.root;
+            size_type h = high.height;
+            while(c != 0 && !(c->color() == color_t::black && h == low.height)){
+                if(c->color() == color_t::black) --h;
+                p = c;
+                c = right ? c->right : c->left;
+            }
+            if(right){
+                _k->left = c;
+                _k->right = low.root;
+                p->right = _k;
+            }else{
+                _k->left = low.root;
+                _k->right = c;
+                p->left = _k;
+            }
+            if(c != 0) c->parent(_k);
+            if(low.root != 0) low.root->parent(_k);
+            _k->parent(p);
+            _k->color(color_t::red);
+            Augment::update(*_k);
+            
+            node_pointer x = _k;
+            while(x->parent() != 0 && x->parent()->color() == color_t::red){
+                node_pointer parent = x->parent();
+                node_pointer grand_parent = parent->parent();
+                bool left = grand_parent->left == parent;
+                node_pointer uncle = left ? grand_parent->right : grand_parent->left;
+                if(uncle != 0 && uncle->color() == color_t::red){
+                    parent->color(color_t::black);
+                    uncle->color(color_t::black);
+                    grand_parent->color(color_t::red);
+                    x = grand_parent;
+                    continue;
+                }
+                if(left){
+                    if(parent->right == x) rotate_left_node(parent);
+                    rotate_right_node(grand_parent);
+                }else{
+                    if(parent->left == x) rotate_right_node(parent);
+                    rotate_left_node(grand_parent);
+                }
+                break;
+            }
+            
+            node_pointer root = _k;
+            while(root->parent() != 0){
+                root = root->parent();
+                Augment::update(*root);
+            }
+            h = high.height;
+            if(root->color() == color_t::red){
+                root->color(color_t::black);
+                ++h;
+            }
+            return make_subtree(root, h);
+        }
+        
+        // ---- the last node of _t and the rest of it
+        static std::pair<subtree, node_pointer> split_last(subtree _t)
+        {
+            node_pointer a = _t.root;
+            subtree l = detach(_t, a->left);
+            subtree r = detach(_t, a->right);
+            if(r.root == 0) return std::make_pair(l, a);
+            std::pair<subtree, node_pointer> p = split_last(r);
+            return std::make_pair(join_nodes(l, a, p.first), p.second);
+        }
+        
+        static subtree concat(subtree _l, subtree _r)
+        {
+            if(_l.root == 0) return _r;
+            if(_r.root == 0) return _l;
+            std::pair<subtree, node_pointer> p = split_last(_l);
+            return join_nodes(p.first, p.second, _r);
+        }
+        
+        // ---- elements less than _key and the others, or with _upper
+        //      the elements not greater than _key and the others
+        template<typename Key>
+        std::pair<subtree, subtree> split_nodes(subtree _t, Key const& _key, bool _upper) const
+        {
+            node_pointer a = _t.root;
+            if(a == 0) return std::make_pair(_t, _t);
+            subtree l = detach(_t, a->left);
+            subtree r = detach(_t, a->right);
+            bool to_left = _upper ? !compare(_key, a->value) : compare(a->value, _key);
+            if(to_left){
+                std::pair<subtree, subtree> p = split_nodes(r, _key, _upper);
+                return std::make_pair(join_nodes(l, a, p.first), p.second);
+            }else{
+                std::pair<subtree, subtree> p = split_nodes(l, _key, _upper);
+                return std::make_pair(p.first, join_nodes(p.second, a, r));
+            }
+        }
+        
+        // ---- less than, equivalent to and greater than _key
+        void split3(subtree _t, value_type const& _key, subtree& _less, subtree& _equal, subtree& _greater) const
+        {
+            std::pair<subtree, subtree> p = split_nodes(_t, _key, false);
+            std::pair<subtree, subtree> q = split_nodes(p.second, _key, true);
+            _less = p.first;
+            _equal = q.first;
+            _greater = q.second;
+        }
+        
+        // ---- pre order successor of _a inside the subtree of _top
+        static node_pointer next_in_subtree(node_pointer _a, node_pointer _top)
+        {
+            if(_a->left != 0) return _a->left;
+            if(_a->right != 0) return _a->right;
+            while(_a != _top){
+                node_pointer p = _a->parent();
+                if(p->left == _a && p->right != 0) return p->right;
+                _a = p;
+            }
+            return 0;
+        }
+        
+        // ---- size of _a when _a and _b hold _total nodes together.
+        //      both are walked in lockstep until one of them ends.
+        static size_type count_left(node_pointer _a, node_pointer _b, size_type _total)
+        {
+            return count_left(_a, _b, _total, has_order_statistics());
+        }
+        
+        static size_type count_left(node_pointer _a, node_pointer, size_type, std::true_type)
+        {
+            return subtree_size(_a);
+        }
+        
+        static size_type count_left(node_pointer _a, node_pointer _b, size_type _total, std::false_type)
+        {
+            node_pointer a = _a;
+            node_pointer b = _b;
+            size_type n = 0;
+            while(a != 0 && b != 0){
+                a = next_in_subtree(a, _a);
+                b = next_in_subtree(b, _b);
+                ++n;
+            }
+            return (a == 0) ? n : _total - n;
+        }
+        
+        // ---- the nodes a set operation leaves over are collected
+        //      and freed once it is done, never from inside a task.
+        //      a forked first half collects into a context of its
+        //      own, merged after the join, so no lock is needed.
+        template<typename Pool>
+        struct set_context
+        {
+            Pool& m_pool;
+            size_type m_grain;
+            std::vector<node_pointer> m_dropped;
+            
+            set_context(Pool& _pool, size_type _grain)
+                : m_pool(_pool), m_grain(_grain), m_dropped()
+            {}
+            
+            //---- a subtree of black height _height has 2^_height - 1 nodes at least
+            bool is_parallel(size_type _height) const
+            {
+                if(std::is_same<Pool, rbtree_sequential>::value) return false;
+                if(_height >= sizeof(size_type) * 8 - 1) return true;
+                return (size_type(1) << _height) > m_grain;
+            }
+            
+            void drop(node_pointer _a)
+            {
+                if(_a != 0) m_dropped.push_back(_a);
+            }
+            
+            template<typename F1, typename F2>
+            void fork(bool _parallel, F1 _f1, F2 _f2)
+            {
+                if(!_parallel){
+                    _f1(*this);
+                    _f2(*this);
+                    return;
+                }
+                set_context c1(m_pool, m_grain);
+                m_pool.fork([&](){ _f1(c1); }, [&](){ _f2(*this); });
+                m_dropped.insert(m_dropped.end(), c1.m_dropped.begin(), c1.m_dropped.end());
+            }
+        };
+        
+        template<typename Context>
+        subtree union_nodes(subtree _a, subtree _b, Context& _c) const
+        {
+            if(_a.root == 0) return _b;
+            if(_b.root == 0) return _a;
+            node_pointer k = _b.root;
+            subtree l2 = detach(_b, k->left);
+            subtree r2 = detach(_b, k->right);
+            subtree l1, e1, r1;
+            split3(_a, k->value, l1, e1, r1);
+            if(e1.root != 0){
+                //---- found, the copies in _b all go
+                std::pair<subtree, subtree> p = split_nodes(l2, k->value, false);
+                std::pair<subtree, subtree> q = split_nodes(r2, k->value, true);
+                _c.drop(k);
+                _c.drop(p.second.root);
+                _c.drop(q.first.root);
+                l2 = p.first;
+                r2 = q.second;
+            }
+            subtree l, r;
+            _c.fork(_c.is_parallel(_b.height),
+                [&](Context& _c1){ l = union_nodes(l1, l2, _c1); },
+                [&](Context& _c2){ r = union_nodes(r1, r2, _c2); });
+            if(e1.root != 0) return concat(concat(l, e1), r);
+            return join_nodes(l, k, r);
+        }
+        
+        // ---- _b is a node of the other tree, which is only read
+        template<typename Context>
+        subtree intersect_nodes(subtree _a, node_pointer _b, size_type _height, Context& _c) const
+        {
+            if(_a.root == 0) return _a;
+            if(_b == 0){
+                _c.drop(_a.root);
+                return make_subtree(0, 0);
+            }
+            subtree l1, e1, r1;
+            split3(_a, _b->value, l1, e1, r1);
+            size_type h = (_b->color() == color_t::black) ? _height - 1 : _height;
+            subtree l, r;
+            _c.fork(_c.is_parallel(_height),
+                [&](Context& _c1){ l = intersect_nodes(l1, _b->left, h, _c1); },
+                [&](Context& _c2){ r = intersect_nodes(r1, _b->right, h, _c2); });
+            return concat(concat(l, e1), r);
+        }
+        
+        template<typename Context>
+        subtree difference_nodes(subtree _a, node_pointer _b, size_type _height, Context& _c) const
+        {
+            if(_a.root == 0 || _b == 0) return _a;
+            subtree l1, e1, r1;
+            split3(_a, _b->value, l1, e1, r1);
+            _c.drop(e1.root);
+            size_type h = (_b->color() == color_t::black) ? _height - 1 : _height;
+            subtree l, r;
+            _c.fork(_c.is_parallel(_height),
+                [&](Context& _c1){ l = difference_nodes(l1, _b->left, h, _c1); },
+                [&](Context& _c2){ r = difference_nodes(r1, _b->right, h, _c2); });
+            return concat(l, r);
+        }
     
     public:
         void output_dot(std::ostream& out, std::string const& graph_name = std::string("G")) const
@@ -756,7 +2095,7 @@ namespace creek{
             out << "digraph " << "\"" << graph_name << "\" {\n";
             while(it != end){
                 out << "\t" << "N" << it.base() << "[ label=\"" << *it << "\", ";
-                if(it.base()->color == color_t::black){
+                if(it.base()->color() == color_t::black){
                     out << "style = filled, fillcolor = \"#cccccc\"];\n";
                 }else{
                     out << "style = filled, fillcolor = \"#CC9999\"];\n";
@@ -777,11 +2116,19 @@ namespace creek{
         }
     };
     
-    template<typename T, typename C, typename A>
-    struct binary_tree_traits<rbtree<T, C, A>>
+    // ---- rbtree answering aggregate(lo, hi) for a user monoid
+    template<
+        typename T,
+        typename Compare,
+        typename Aggregate,
+        typename Allocator = std::allocator<T>>
+    using augmented_rbtree = rbtree<T, Compare, Allocator, rbtree_aggregate<Aggregate>>;
+    
+    template<typename T, typename C, typename A, typename G, typename S>
+    struct binary_tree_traits<rbtree<T, C, A, G, S>>
     {
-        typedef typename rbtree<T, C, A>::node_pointer sub_iterator;
-        typedef typename rbtree<T, C, A>::value_type value_type;
+        typedef typename rbtree<T, C, A, G, S>::node_pointer sub_iterator;
+        typedef typename rbtree<T, C, A, G, S>::value_type value_type;
         
         static sub_iterator base(sub_iterator _a)
         {
@@ -796,7 +2143,7 @@ namespace creek{
         static sub_iterator parent(sub_iterator _a)
         {
             assert(_a != sub_iterator());
-            return _a->parent;
+            return _a->parent();
         }
         
         static sub_iterator left_child(sub_iterator _a)
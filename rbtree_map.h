@@ -0,0 +1,203 @@
+//-----------------------------------------------------------
+//    rbtree_map.h
+//-----------------------------------------------------------
+#ifndef CREEK_RBTREE_MAP_H
+#define CREEK_RBTREE_MAP_H
+
+#include <utility>
+#include <tuple>
+#include <memory>
+#include <stdexcept>
+
+#include "fwd.h"
+#include "rbtree.h"
+
+namespace creek
+{
+    namespace detail
+    {
+        //---- map compare
+        //     orders the pairs of an rbtree_map by their keys. it is
+        //     transparent, so that rbtree looks up keys of any type
+        //     Compare accepts without building a pair.
+        template<typename Key, typename Mapped, typename Compare>
+        struct map_compare
+        {
+            typedef void is_transparent;
+            typedef std::pair<Key, Mapped> value_type;
+            
+            Compare m_compare;
+            
+            explicit map_compare(Compare _compare = Compare())
+                : m_compare(_compare)
+            {}
+            
+            bool operator()(value_type const& _a, value_type const& _b) const
+            { return key_less<Compare>::apply(m_compare, _a.first, _b.first); }
+            
+            template<typename Tp>
+            bool operator()(value_type const& _a, Tp const& _b) const
+            { return key_less<Compare>::apply(m_compare, _a.first, _b); }
+            
+            template<typename Tp>
+            bool operator()(Tp const& _a, value_type const& _b) const
+            { return key_less<Compare>::apply(m_compare, _a, _b.first); }
+        };
+    }
+    
+    //-----------------------------------------------------------
+    //    class rbtree_map
+    //    ordered map with unique keys on top of rbtree. the nodes
+    //    hold the key and the mapped value, only the keys are
+    //    compared, through Compare called directly.
+    //-----------------------------------------------------------
+    template<
+        typename Key,
+        typename Mapped,
+        typename Compare = rbtree_default,
+        typename Allocator = std::allocator<std::pair<Key, Mapped>>>
+    class rbtree_map
+    {
+    public:
+        typedef Key key_type;
+        typedef Mapped mapped_type;
+        typedef std::pair<Key, Mapped> value_type;
+        typedef Compare key_compare;
+        typedef Allocator allocator_type;
+        
+    private:
+        typedef detail::map_compare<Key, Mapped, Compare> compare_type;
+        typedef rbtree<value_type, compare_type, Allocator> tree_type;
+        
+        tree_type m_tree;
+        
+    public:
+        typedef typename tree_type::size_type size_type;
+        typedef typename tree_type::in_order_iterator iterator;
+        typedef typename tree_type::const_in_order_iterator const_iterator;
+        typedef typename tree_type::reverse_in_order_iterator reverse_iterator;
+        typedef typename tree_type::const_reverse_in_order_iterator const_reverse_iterator;
+        
+        explicit rbtree_map(Compare _compare = Compare())
+            : m_tree(compare_type(_compare))
+        {}
+        
+        iterator begin() { return m_tree.in_order_begin(); }
+        iterator end() { return m_tree.in_order_end(); }
+        const_iterator begin() const { return m_tree.in_order_begin(); }
+        const_iterator end() const { return m_tree.in_order_end(); }
+        reverse_iterator rbegin() { return m_tree.in_order_rbegin(); }
+        reverse_iterator rend() { return m_tree.in_order_rend(); }
+        const_reverse_iterator rbegin() const { return m_tree.in_order_rbegin(); }
+        const_reverse_iterator rend() const { return m_tree.in_order_rend(); }
+        
+        size_type size() const { return m_tree.size(); }
+        bool empty() const { return m_tree.empty(); }
+        void clear() { m_tree.clear(); }
+        
+        key_compare key_comp() const { return m_tree.value_comp().m_compare; }
+        
+        //---- lookup
+        //     _key may be of any type Compare compares with key_type.
+        template<typename Tp>
+        iterator find(Tp const& _key) { return m_tree.find(_key); }
+        
+        template<typename Tp>
+        const_iterator find(Tp const& _key) const { return m_tree.find(_key); }
+        
+        template<typename Tp>
+        size_type count(Tp const& _key) const
+        { return (find(_key) != end()) ? 1 : 0; }
+        
+        template<typename Tp>
+        iterator lower_bound(Tp const& _key) { return m_tree.lower_bound(_key); }
+        
+        template<typename Tp>
+        const_iterator lower_bound(Tp const& _key) const { return m_tree.lower_bound(_key); }
+        
+        template<typename Tp>
+        iterator upper_bound(Tp const& _key) { return m_tree.upper_bound(_key); }
+        
+        template<typename Tp>
+        const_iterator upper_bound(Tp const& _key) const { return m_tree.upper_bound(_key); }
+        
+        template<typename Tp>
+        std::pair<iterator, iterator> equal_range(Tp const& _key) { return m_tree.equal_range(_key); }
+        
+        template<typename Tp>
+        std::pair<const_iterator, const_iterator> equal_range(Tp const& _key) const
+        { return m_tree.equal_range(_key); }
+        
+        mapped_type& at(key_type const& _key)
+        {
+            iterator it = find(_key);
+            if(it == end()) throw std::out_of_range("rbtree_map::at");
+            return it->second;
+        }
+        
+        mapped_type const& at(key_type const& _key) const
+        {
+            const_iterator it = find(_key);
+            if(it == end()) throw std::out_of_range("rbtree_map::at");
+            return it->second;
+        }
+        
+        //---- insertion
+        //     one descent finds the place, a present key leaves the
+        //     map and _args untouched.
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(key_type const& _key, Args&&... _args)
+        {
+            iterator it = m_tree.lower_bound(_key);
+            if(it != end() && !m_tree.value_comp()(_key, *it)) return std::make_pair(it, false);
+            it = m_tree.emplace_hint(it, std::piecewise_construct,
+                std::forward_as_tuple(_key), std::forward_as_tuple(std::forward<Args>(_args)...));
+            return std::make_pair(it, true);
+        }
+        
+        std::pair<iterator, bool> insert(value_type const& _value)
+        {
+            return try_emplace(_value.first, _value.second);
+        }
+        
+        //---- insert or assign
+        template<typename Mp>
+        std::pair<iterator, bool> insert_or_assign(key_type const& _key, Mp&& _mapped)
+        {
+            iterator it = m_tree.lower_bound(_key);
+            if(it != end() && !m_tree.value_comp()(_key, *it)){
+                it->second = std::forward<Mp>(_mapped);
+                return std::make_pair(it, false);
+            }
+            it = m_tree.emplace_hint(it, std::piecewise_construct,
+                std::forward_as_tuple(_key), std::forward_as_tuple(std::forward<Mp>(_mapped)));
+            return std::make_pair(it, true);
+        }
+        
+        mapped_type& operator[](key_type const& _key)
+        {
+            return try_emplace(_key).first->second;
+        }
+        
+        void erase(iterator _it)
+        {
+            m_tree.erase(_it);
+        }
+        
+        void erase(const_iterator _it)
+        {
+            m_tree.erase(_it);
+        }
+        
+        template<typename Tp>
+        size_type erase(Tp const& _key)
+        {
+            iterator it = find(_key);
+            if(it == end()) return 0;
+            m_tree.erase(it);
+            return 1;
+        }
+    };
+}//---- namespace creek
+
+#endif
@@ -0,0 +1,396 @@
+//-----------------------------------------------------------
+//    rbtree_path_copy.h
+//-----------------------------------------------------------
+#ifndef CREEK_RBTREE_PATH_COPY_H
+#define CREEK_RBTREE_PATH_COPY_H
+
+#include <iterator>
+#include <cstddef>
+#include <assert.h>
+
+#include "fwd.h"
+#include "rbtree.h"
+
+namespace creek
+{
+    namespace detail
+    {
+        enum class path_copy_color : unsigned char { red, black };
+        
+        // ---- deepest path of a red black tree, two per bit of size_t
+        static std::size_t const path_copy_depth = 2 * 8 * sizeof(std::size_t);
+        
+        //-----------------------------------------------------------
+        //    class path_copy_iterator
+        //    in order walk of nodes without parent links, the path
+        //    from the root is kept on a stack of fixed size.
+        //-----------------------------------------------------------
+        template<typename Node, typename T>
+        class path_copy_iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef T const* pointer;
+            typedef T const& reference;
+            
+        private:
+            Node const* m_stack[path_copy_depth];
+            std::size_t m_depth;
+            
+            template<typename, typename, typename>
+            friend class rbtree_path_copy;
+            
+            void push(Node const* _a)
+            {
+                assert(m_depth < path_copy_depth);
+                m_stack[m_depth++] = _a;
+            }
+            
+            void push_left(Node const* _a)
+            {
+                for(; _a != 0; _a = _a->left) push(_a);
+            }
+            
+        public:
+            path_copy_iterator() : m_depth(0) {}
+            
+            reference operator*() const { return m_stack[m_depth - 1]->value; }
+            pointer operator->() const { return &m_stack[m_depth - 1]->value; }
+            
+            path_copy_iterator& operator++()
+            {
+                Node const* a = m_stack[--m_depth];
+                push_left(a->right);
+                return *this;
+            }
+            
+            path_copy_iterator operator++(int)
+            {
+                path_copy_iterator tmp(*this);
+                ++*this;
+                return tmp;
+            }
+            
+            bool operator==(path_copy_iterator const& _a) const
+            {
+                if(m_depth != _a.m_depth) return false;
+                return m_depth == 0 || m_stack[m_depth - 1] == _a.m_stack[m_depth - 1];
+            }
+            
+            bool operator!=(path_copy_iterator const& _a) const { return !(*this == _a); }
+        };
+        
+        //-----------------------------------------------------------
+        //    class rbtree_path_copy
+        //    insert and erase on red black trees whose nodes may be
+        //    shared: every node a write changes is first made its
+        //    own by Derived. Derived provides
+        //      own(a)       a node of this write in place of a, a
+        //                   itself if it already is one
+        //      is_fresh(a)  whether a is a node of this write
+        //      drop(a)      a leaves the tree
+        //    Node has value_type, value, left, right and color.
+        //-----------------------------------------------------------
+        template<typename Derived, typename Node, typename Compare>
+        class rbtree_path_copy
+        {
+        protected:
+            typedef Node* node_pointer;
+            typedef path_copy_color color_t;
+            typedef path_copy_iterator<Node, typename Node::value_type> iterator_type;
+            
+            static std::size_t const max_depth = path_copy_depth;
+            
+            Compare m_compare;
+            
+            explicit rbtree_path_copy(Compare const& _cmp)
+                : m_compare(_cmp)
+            {}
+            
+            template<typename Tp, typename Up>
+            bool compare(Tp const& _a, Up const& _b) const
+            {
+                return key_less<Compare>::apply(m_compare, _a, _b);
+            }
+            
+            static bool is_red(node_pointer _a)
+            {
+                return _a != 0 && _a->color == color_t::red;
+            }
+            
+            // ---- lookup
+            template<typename Key>
+            node_pointer lower_bound_node(node_pointer _root, Key const& _key) const
+            {
+                node_pointer found = 0;
+                for(node_pointer a = _root; a != 0;){
+                    if(compare(a->value, _key)) a = a->right;
+                    else{
+                        found = a;
+                        a = a->left;
+                    }
+                }
+                return found;
+            }
+            
+            // ---- path from _root to the first element equivalent
+            //      to _key, its length or 0 if there is none.
+            //      _path has room for max_depth + 2 nodes.
+            template<typename Key>
+            std::size_t find_path(node_pointer _root, Key const& _key, node_pointer* _path) const
+            {
+                std::size_t n = 0, depth = 0;
+                for(node_pointer a = _root; a != 0;){
+                    _path[n++] = a;
+                    if(compare(a->value, _key)) a = a->right;
+                    else{
+                        depth = n;
+                        a = a->left;
+                    }
+                }
+                if(depth == 0 || compare(_key, _path[depth - 1]->value)) return 0;
+                return depth;
+            }
+            
+            static iterator_type begin_iterator(node_pointer _root)
+            {
+                iterator_type it;
+                it.push_left(_root);
+                return it;
+            }
+            
+            template<typename Key>
+            iterator_type lower_bound_iterator(node_pointer _root, Key const& _key) const
+            {
+                iterator_type it;
+                for(node_pointer a = _root; a != 0;){
+                    if(compare(a->value, _key)) a = a->right;
+                    else{
+                        it.push(a);
+                        a = a->left;
+                    }
+                }
+                return it;
+            }
+            
+            // ---- insert
+            //      copies the path down to the new leaf. a black node
+            //      of the path with a red child and grandchild on the
+            //      path rotates them up on the way back.
+            node_pointer insert_node(node_pointer _a, node_pointer _k)
+            {
+                if(_a == 0) return _k;
+                node_pointer b = derived().own(_a);
+                if(compare(_k->value, b->value)){
+                    b->left = insert_node(b->left, _k);
+                    node_pointer c = b->left;
+                    if(b->color == color_t::black && is_red(c)){
+                        if(is_red(c->left)){
+                            assert(derived().is_fresh(c->left));
+                            c->left->color = color_t::black;
+                            b->left = c->right;
+                            c->right = b;
+                            return c;
+                        }
+                        if(is_red(c->right)){
+                            node_pointer d = c->right;
+                            assert(derived().is_fresh(d));
+                            c->color = color_t::black;
+                            c->right = d->left;
+                            b->left = d->right;
+                            d->left = c;
+                            d->right = b;
+                            return d;
+                        }
+                    }
+                }else{
+                    b->right = insert_node(b->right, _k);
+                    node_pointer c = b->right;
+                    if(b->color == color_t::black && is_red(c)){
+                        if(is_red(c->right)){
+                            assert(derived().is_fresh(c->right));
+                            c->right->color = color_t::black;
+                            b->right = c->left;
+                            c->left = b;
+                            return c;
+                        }
+                        if(is_red(c->left)){
+                            node_pointer d = c->left;
+                            assert(derived().is_fresh(d));
+                            c->color = color_t::black;
+                            c->left = d->right;
+                            b->right = d->left;
+                            d->right = c;
+                            d->left = b;
+                            return d;
+                        }
+                    }
+                }
+                return b;
+            }
+            
+            // ---- erase
+            //      _path holds the nodes from the root down to the node
+            //      to erase. they are made own, then the fixup runs on
+            //      them and makes own every sibling it changes.
+            //      returns the new root.
+            node_pointer erase_node(node_pointer* _path, std::size_t _n)
+            {
+                node_pointer root = 0;
+                for(std::size_t i = 0; i < _n; ++i){
+                    node_pointer b = derived().own(_path[i]);
+                    replace(_path, i, root, _path[i], b);
+                    _path[i] = b;
+                }
+                
+                node_pointer x = _path[_n - 1];
+                if(x->left != 0 && x->right != 0){
+                    // the successor takes the place of x
+                    node_pointer s = derived().own(x->right);
+                    x->right = s;
+                    _path[_n++] = s;
+                    while(s->left != 0){
+                        node_pointer t = derived().own(s->left);
+                        s->left = t;
+                        _path[_n++] = t;
+                        s = t;
+                    }
+                    x->value = s->value;
+                    x = s;
+                }
+                
+                --_n;
+                node_pointer c = (x->left != 0) ? x->left : x->right;
+                bool left = _n > 0 && _path[_n - 1]->left == x;
+                replace(_path, _n, root, x, c);
+                bool black = x->color == color_t::black;
+                derived().drop(x);
+                if(black){
+                    if(is_red(c)){
+                        node_pointer d = derived().own(c);
+                        replace(_path, _n, root, c, d);
+                        d->color = color_t::black;
+                    }
+                    else erase_fixup(_path, _n, root, left);
+                }
+                return root;
+            }
+            
+            // the black height below the _left child of _path[_n - 1]
+            // is one short.
+            void erase_fixup(node_pointer* _path, std::size_t _n, node_pointer& _root, bool _left)
+            {
+                while(_n > 0){
+                    node_pointer p = _path[_n - 1];
+                    if(_left){
+                        node_pointer bro = derived().own(p->right);
+                        p->right = bro;
+                        if(bro->color == color_t::red){
+                            bro->color = color_t::black;
+                            p->color = color_t::red;
+                            p->right = bro->left;
+                            bro->left = p;
+                            replace(_path, _n - 1, _root, p, bro);
+                            _path[_n - 1] = bro;
+                            _path[_n++] = p;
+                            bro = derived().own(p->right);
+                            p->right = bro;
+                        }
+                        if(!is_red(bro->left) && !is_red(bro->right)){
+                            bro->color = color_t::red;
+                        }else{
+                            if(!is_red(bro->right)){
+                                node_pointer t = derived().own(bro->left);
+                                t->color = color_t::black;
+                                bro->color = color_t::red;
+                                bro->left = t->right;
+                                t->right = bro;
+                                bro = t;
+                            }
+                            node_pointer t = derived().own(bro->right);
+                            t->color = color_t::black;
+                            bro->right = t;
+                            bro->color = p->color;
+                            p->color = color_t::black;
+                            p->right = bro->left;
+                            bro->left = p;
+                            replace(_path, _n - 1, _root, p, bro);
+                            return;
+                        }
+                    }else{
+                        node_pointer bro = derived().own(p->left);
+                        p->left = bro;
+                        if(bro->color == color_t::red){
+                            bro->color = color_t::black;
+                            p->color = color_t::red;
+                            p->left = bro->right;
+                            bro->right = p;
+                            replace(_path, _n - 1, _root, p, bro);
+                            _path[_n - 1] = bro;
+                            _path[_n++] = p;
+                            bro = derived().own(p->left);
+                            p->left = bro;
+                        }
+                        if(!is_red(bro->left) && !is_red(bro->right)){
+                            bro->color = color_t::red;
+                        }else{
+                            if(!is_red(bro->left)){
+                                node_pointer t = derived().own(bro->right);
+                                t->color = color_t::black;
+                                bro->color = color_t::red;
+                                bro->right = t->left;
+                                t->left = bro;
+                                bro = t;
+                            }
+                            node_pointer t = derived().own(bro->left);
+                            t->color = color_t::black;
+                            bro->left = t;
+                            bro->color = p->color;
+                            p->color = color_t::black;
+                            p->left = bro->right;
+                            bro->right = p;
+                            replace(_path, _n - 1, _root, p, bro);
+                            return;
+                        }
+                    }
+                    if(p->color == color_t::red){
+                        p->color = color_t::black;
+                        return;
+                    }
+                    --_n;
+                    _left = _n > 0 && _path[_n - 1]->left == p;
+                }
+            }
+            
+            // ---- link _b where _a was, below _path[_i - 1] or at the root
+            static void replace(node_pointer* _path, std::size_t _i, node_pointer& _root,
+                node_pointer _a, node_pointer _b)
+            {
+                if(_i == 0) _root = _b;
+                else if(_path[_i - 1]->left == _a) _path[_i - 1]->left = _b;
+                else _path[_i - 1]->right = _b;
+            }
+            
+            // black height of _a, -1 if broken
+            int check_node(node_pointer _a, std::size_t& _count) const
+            {
+                if(_a == 0) return 0;
+                ++_count;
+                if(is_red(_a) && (is_red(_a->left) || is_red(_a->right))) return -1;
+                if(_a->left != 0 && compare(_a->value, _a->left->value)) return -1;
+                if(_a->right != 0 && compare(_a->right->value, _a->value)) return -1;
+                int l = check_node(_a->left, _count);
+                int r = check_node(_a->right, _count);
+                if(l < 0 || l != r) return -1;
+                return l + ((_a->color == color_t::black) ? 1 : 0);
+            }
+            
+        private:
+            Derived& derived() { return static_cast<Derived&>(*this); }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,149 @@
+#define BOOST_TEST_MODULE arena_allocator
+#include <boost/test/included/unit_test.hpp>
+
+#include "tree.h"
+#include "arena_allocator.h"
+#include <string>
+#include <algorithm>
+#include <type_traits>
+
+using namespace creek;
+
+BOOST_AUTO_TEST_CASE( allocate )
+{
+    arena_allocator<int, 1024> alloc;
+    int* a = alloc.allocate(1);
+    int* b = alloc.allocate(1);
+    BOOST_CHECK( a != b );
+    BOOST_CHECK_EQUAL( alloc.chunk_count(), 1 );
+    
+    arena_allocator<double, 1024> alloc2(alloc);
+    BOOST_CHECK( alloc2 == alloc );
+    double* c = alloc2.allocate(1);
+    BOOST_CHECK_EQUAL( reinterpret_cast<std::size_t>(c) % alignof(double), 0 );
+    BOOST_CHECK_EQUAL( alloc.chunk_count(), 1 );
+    
+    alloc2.allocate(4096);
+    BOOST_CHECK_EQUAL( alloc.chunk_count(), 2 );
+    alloc.release();
+    BOOST_CHECK_EQUAL( alloc2.chunk_count(), 0 );
+    
+    arena_allocator<int, 1024> alloc3;
+    BOOST_CHECK( alloc3 != alloc );
+}
+
+BOOST_AUTO_TEST_CASE( tree_bulk_release )
+{
+    typedef tree<int, arena_allocator<int>> tree_type;
+    tree_type t1;
+    tree_type::pre_order_iterator root = t1.insert(t1.pre_order_begin(), 0);
+    for(int i = 1; i < 10000; ++i){
+        tree_type::pre_order_iterator c = t1.append_child(root, i);
+        t1.append_child(c, -i);
+    }
+    BOOST_CHECK_EQUAL( t1.size(), 19999 );
+    
+    tree_type t2(t1);
+    BOOST_CHECK( std::equal(t1.pre_order_begin(), t1.pre_order_end(), t2.pre_order_begin()) );
+    
+    t1.clear();
+    BOOST_CHECK( t1.empty() );
+    BOOST_CHECK( t1.pre_order_begin() == t1.pre_order_end() );
+    BOOST_CHECK_EQUAL( t2.size(), 19999 );
+    BOOST_CHECK_EQUAL( *(t2.pre_order_begin()), 0 );
+    BOOST_CHECK_EQUAL( *(--t2.pre_order_end()), -9999 );
+    
+    root = t1.insert(t1.pre_order_begin(), 1);
+    t1.append_child(root, 2);
+    BOOST_CHECK_EQUAL( t1.size(), 2 );
+    BOOST_CHECK_EQUAL( *(t1.post_order_begin()), 2 );
+    
+    t1.swap(t2);
+    BOOST_CHECK_EQUAL( t1.size(), 19999 );
+    BOOST_CHECK_EQUAL( t2.size(), 2 );
+}
+
+BOOST_AUTO_TEST_CASE( tree_move_reuse )
+{
+    typedef tree<int, arena_allocator<int>> tree_type;
+    static_assert(std::is_nothrow_move_constructible<tree_type>::value, "tree move may throw");
+    static_assert(std::is_nothrow_move_assignable<tree_type>::value, "tree move may throw");
+    tree_type a;
+    tree_type::pre_order_iterator root = a.insert(a.pre_order_begin(), 0);
+    for(int i = 1; i < 1000; ++i)
+        a.append_child(root, i);
+    
+    // the moved-from tree must not release the arena of the new owner
+    tree_type b(std::move(a));
+    a.insert(a.pre_order_begin(), -1);
+    a.clear();
+    BOOST_CHECK( a.empty() );
+    BOOST_CHECK_EQUAL( b.size(), 1000 );
+    int i = 0;
+    for(tree_type::pre_order_iterator it = b.pre_order_begin(); it != b.pre_order_end(); ++it, ++i)
+        BOOST_CHECK_EQUAL( *it, i );
+    
+    tree_type x(b), y;
+    y.insert(y.pre_order_begin(), 5);
+    y = std::move(x);
+    x.insert(x.pre_order_begin(), -1);
+    x.clear();
+    BOOST_CHECK( x.empty() );
+    BOOST_CHECK_EQUAL( y.size(), 1000 );
+    BOOST_CHECK( std::equal(b.pre_order_begin(), b.pre_order_end(), y.pre_order_begin()) );
+}
+
+BOOST_AUTO_TEST_CASE( tree_shared_arena )
+{
+    typedef tree<int, arena_allocator<int>> tree_type;
+    arena_allocator<int> alloc;
+    BOOST_CHECK( alloc.sole_owner() );
+    tree_type t1(alloc), t2(alloc);
+    BOOST_CHECK( !alloc.sole_owner() );
+    
+    // clearing one tree must keep the nodes of the other
+    t1.append_child(t1.insert(t1.pre_order_begin(), 1), 2);
+    t2.append_child(t2.insert(t2.pre_order_begin(), 3), 4);
+    t1.clear();
+    BOOST_CHECK( t1.empty() );
+    BOOST_CHECK_EQUAL( t2.size(), 2 );
+    BOOST_CHECK_EQUAL( *(t2.pre_order_begin()), 3 );
+    BOOST_CHECK_EQUAL( *(t2.post_order_begin()), 4 );
+    
+    t1.insert(t1.pre_order_begin(), 5);
+    t2.clear();
+    BOOST_CHECK_EQUAL( *(t1.pre_order_begin()), 5 );
+    BOOST_CHECK_EQUAL( alloc.chunk_count(), 1 );
+}
+
+struct Element
+{
+    static int construction_count;
+    static int destruction_count;
+    
+    Element(){++construction_count;}
+    Element(Element const& _other){++construction_count;}
+    ~Element(){++destruction_count;}
+};
+int Element::construction_count = 0;
+int Element::destruction_count = 0;
+
+BOOST_AUTO_TEST_CASE( tree_nontrivial_value )
+{
+    {
+        typedef tree<Element, arena_allocator<Element>> tree_type;
+        tree_type t1;
+        tree_type::pre_order_iterator root = t1.insert(t1.pre_order_begin(), Element());
+        for(int i = 0; i < 100; ++i)
+            t1.append_child(root, Element());
+        tree_type t2(t1);
+        t2.erase(child_order_begin(t2.pre_order_begin()));
+        t1.clear();
+    }
+    BOOST_CHECK_EQUAL( Element::construction_count, Element::destruction_count );
+    
+    tree<std::string, arena_allocator<std::string>> t3;
+    t3.append_child(t3.insert(t3.pre_order_begin(), "root"), std::string(100, 'x'));
+    t3.clear();
+    BOOST_CHECK( t3.empty() );
+}
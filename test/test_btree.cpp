@@ -0,0 +1,195 @@
+#define BOOST_TEST_MODULE btree
+#include <boost/test/included/unit_test.hpp>
+
+#include <set>
+#include <string>
+#include <vector>
+#include <random>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+
+#include "btree.h"
+
+using namespace creek;
+
+//---- four ints to a leaf, so that every path splits and merges
+typedef btree<int, rbtree_default, 32> small_tree;
+
+//---- a value equal to others in its key, told apart by its tag
+struct tagged
+{
+    int key;
+    int tag;
+    tagged() : key(), tag() {}
+    tagged(int _key, int _tag) : key(_key), tag(_tag) {}
+    bool operator<(tagged const& _a) const { return key < _a.key; }
+    bool operator==(tagged const& _a) const { return key == _a.key && tag == _a.tag; }
+};
+
+//---- compares strings with the ints they hold
+struct number_less
+{
+    typedef void is_transparent;
+    bool operator()(std::string const& _a, std::string const& _b) const { return std::stoi(_a) < std::stoi(_b); }
+    bool operator()(std::string const& _a, int _b) const { return std::stoi(_a) < _b; }
+    bool operator()(int _a, std::string const& _b) const { return _a < std::stoi(_b); }
+};
+
+template<typename Tree>
+void random_operations(unsigned _seed, int _range)
+{
+    std::mt19937 gen(_seed);
+    std::uniform_int_distribution<int> dist(0, _range);
+    Tree t;
+    std::multiset<int> s;
+    for(int round = 0; round < 6; ++round){
+        for(int i = 0; i < 2000; ++i){
+            int k = dist(gen);
+            BOOST_CHECK_EQUAL(*t.insert(k), k);
+            s.insert(k);
+        }
+        for(int i = 0; i < 1500; ++i){
+            int k = dist(gen);
+            auto it = t.find(k);
+            BOOST_REQUIRE_EQUAL(it != t.in_order_end(), s.count(k) != 0);
+            if(it == t.in_order_end()) continue;
+            BOOST_CHECK_EQUAL(*it, k);
+            t.erase(it);
+            s.erase(s.find(k));
+        }
+        BOOST_REQUIRE(t.check_invariant());
+        BOOST_REQUIRE_EQUAL(t.size(), s.size());
+        BOOST_CHECK(std::equal(s.begin(), s.end(), t.in_order_begin()));
+        BOOST_CHECK(std::equal(s.rbegin(), s.rend(), t.in_order_rbegin()));
+        BOOST_CHECK_EQUAL(std::distance(t.in_order_rbegin(), t.in_order_rend()), static_cast<long>(s.size()));
+        
+        for(int k = -1; k <= _range + 1; k += 3){
+            BOOST_CHECK_EQUAL(t.count(k), s.count(k));
+            BOOST_CHECK(std::distance(t.in_order_begin(), t.lower_bound(k))
+                == std::distance(s.begin(), s.lower_bound(k)));
+            BOOST_CHECK(std::distance(t.in_order_begin(), t.upper_bound(k))
+                == std::distance(s.begin(), s.upper_bound(k)));
+        }
+    }
+    
+    // erase all, from both ends and the middle
+    while(!t.empty()){
+        auto it = t.in_order_begin();
+        switch(t.size() % 3){
+        case 0: break;
+        case 1: it = t.in_order_end(); --it; break;
+        case 2: std::advance(it, t.size() / 2); break;
+        }
+        t.erase(it);
+        if(t.size() % 97 == 0) BOOST_REQUIRE(t.check_invariant());
+    }
+    BOOST_CHECK(t.check_invariant());
+    BOOST_CHECK(t.in_order_begin() == t.in_order_end());
+}
+
+BOOST_AUTO_TEST_CASE( insert_find_erase )
+{
+    random_operations<small_tree>(1, 3000);
+    random_operations<small_tree>(2, 40);
+    random_operations<btree<int>>(3, 3000);
+    random_operations<btree<int, rbtree_default, 64>>(4, 200);
+}
+
+BOOST_AUTO_TEST_CASE( equal_elements )
+{
+    btree<tagged, rbtree_default, 48> t;
+    std::vector<tagged> v;
+    for(int i = 0; i < 600; ++i){
+        tagged a(i % 7, i);
+        t.insert(a);
+        v.push_back(a);
+    }
+    std::stable_sort(v.begin(), v.end());
+    BOOST_CHECK(t.check_invariant());
+    BOOST_CHECK(std::equal(v.begin(), v.end(), t.in_order_begin()));
+    
+    auto r = t.equal_range(tagged(3, 0));
+    BOOST_CHECK_EQUAL(std::distance(r.first, r.second), 86);
+    BOOST_CHECK_EQUAL(r.first->tag, 3);
+    BOOST_CHECK(t.find(tagged(3, 0)) == r.first);
+    BOOST_CHECK(t.find(tagged(9, 0)) == t.in_order_end());
+}
+
+BOOST_AUTO_TEST_CASE( hint_and_append )
+{
+    small_tree t;
+    for(int i = 0; i < 1000; ++i) t.push_back_max(2 * i);
+    BOOST_CHECK(t.check_invariant());
+    
+    // a sorted stream inserted one by one gives the same
+    small_tree u;
+    for(int i = 0; i < 1000; ++i) u.insert(2 * i);
+    BOOST_CHECK(t == u);
+    
+    auto it = t.lower_bound(501);
+    for(int i = 0; i < 200; ++i) it = t.insert(it, 501);
+    BOOST_CHECK_EQUAL(t.count(501), 200u);
+    it = t.insert(t.in_order_end(), 3000);
+    BOOST_CHECK_EQUAL(*it, 3000);
+    it = t.insert(t.in_order_begin(), -1);
+    BOOST_CHECK(it == t.in_order_begin());
+    
+    // a wrong hint still inserts in order
+    t.insert(t.in_order_begin(), 1001);
+    BOOST_CHECK_EQUAL(t.count(1001), 1u);
+    BOOST_CHECK(t.check_invariant());
+    BOOST_CHECK_EQUAL(t.size(), 1203u);
+    BOOST_CHECK(std::is_sorted(t.in_order_begin(), t.in_order_end()));
+}
+
+BOOST_AUTO_TEST_CASE( copy_assign_swap )
+{
+    std::vector<int> v;
+    std::mt19937 gen(5);
+    for(int i = 0; i < 3000; ++i) v.push_back(static_cast<int>(gen() % 10000));
+    small_tree t(v.begin(), v.end());
+    BOOST_CHECK(t.check_invariant());
+    std::sort(v.begin(), v.end());
+    BOOST_CHECK(std::equal(v.begin(), v.end(), t.in_order_begin()));
+    
+    small_tree u(t);
+    BOOST_CHECK(u.check_invariant());
+    BOOST_CHECK(u == t);
+    u.erase(u.find(v[100]));
+    BOOST_CHECK(u != t);
+    
+    small_tree w;
+    w = u;
+    w.swap(t);
+    BOOST_CHECK(t == u);
+    BOOST_CHECK_EQUAL(w.size(), v.size());
+    w.clear();
+    BOOST_CHECK(w.empty());
+    BOOST_CHECK(w.check_invariant());
+    w = t;
+    BOOST_CHECK(w == u);
+}
+
+BOOST_AUTO_TEST_CASE( comparators )
+{
+    btree<int, std::greater<int>, 32> t;
+    for(int i = 0; i < 300; ++i) t.insert(i % 50);
+    BOOST_CHECK(t.check_invariant());
+    BOOST_CHECK(std::is_sorted(t.in_order_begin(), t.in_order_end(), std::greater<int>()));
+    BOOST_CHECK_EQUAL(*t.lower_bound(60), 49);
+    BOOST_CHECK(t.upper_bound(0) == t.in_order_end());
+    
+    btree<std::string, number_less, 128> s;
+    for(int i = 0; i < 300; ++i) s.insert(std::to_string((i * 37) % 300));
+    BOOST_CHECK(s.check_invariant());
+    BOOST_CHECK_EQUAL(*s.find(120), "120");
+    BOOST_CHECK(s.find(301) == s.in_order_end());
+    BOOST_CHECK_EQUAL(*s.lower_bound(-5), "0");
+    BOOST_CHECK_EQUAL(s.count(7), 1u);
+    
+    // the values can be changed in place while their order holds
+    for(auto it = s.in_order_begin(); it != s.in_order_end(); ++it) *it = "0" + *it;
+    BOOST_CHECK(s.check_invariant());
+    BOOST_CHECK_EQUAL(*s.find(120), "0120");
+}
@@ -0,0 +1,140 @@
+#define BOOST_TEST_MODULE concurrent_rbtree
+#include <boost/test/included/unit_test.hpp>
+
+#include <set>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "concurrent_rbtree.h"
+
+using namespace creek;
+
+BOOST_AUTO_TEST_CASE( insert_erase )
+{
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> dist(0, 300);
+    concurrent_rbtree<int> t;
+    concurrent_rbtree<int>::reader r(t);
+    std::multiset<int> s;
+    BOOST_CHECK(t.empty());
+    BOOST_CHECK(r.pin().empty());
+    
+    for(int i = 0; i < 5000; ++i){
+        int k = dist(gen);
+        if(gen() % 3 != 0){
+            t.insert(k);
+            s.insert(k);
+        }
+        else{
+            bool found = s.find(k) != s.end();
+            if(found) s.erase(s.find(k));
+            BOOST_CHECK_EQUAL(t.erase(k), found);
+        }
+        BOOST_REQUIRE(t.check_invariant());
+        if(i % 50 == 0){
+            concurrent_rbtree<int>::snapshot v = r.pin();
+            BOOST_REQUIRE(std::equal(s.begin(), s.end(), v.begin()));
+            BOOST_CHECK(std::distance(v.begin(), v.end()) == static_cast<long>(s.size()));
+            BOOST_CHECK_EQUAL(v.contains(k), s.count(k) != 0);
+            concurrent_rbtree<int>::const_iterator it = v.lower_bound(k);
+            std::multiset<int>::const_iterator sit = s.lower_bound(k);
+            BOOST_CHECK(std::equal(sit, s.end(), it));
+        }
+    }
+    BOOST_CHECK_EQUAL(t.size(), s.size());
+    BOOST_CHECK_EQUAL(t.retired(), 0u);
+    
+    t.clear();
+    BOOST_CHECK(t.empty());
+    BOOST_CHECK(r.pin().empty());
+}
+
+BOOST_AUTO_TEST_CASE( snapshot_isolation )
+{
+    concurrent_rbtree<int> t;
+    concurrent_rbtree<int>::reader r1(t), r2(t);
+    for(int i = 0; i < 100; ++i) t.insert(i);
+    
+    {
+        concurrent_rbtree<int>::snapshot v = r1.pin();
+        for(int i = 0; i < 100; i += 2) t.erase(i);
+        for(int i = 100; i < 200; ++i) t.insert(i);
+        BOOST_CHECK(t.check_invariant());
+        BOOST_CHECK(t.retired() > 0);
+        
+        // the old version is intact
+        int k = 0;
+        for(int a : v) BOOST_CHECK_EQUAL(a, k++);
+        BOOST_CHECK_EQUAL(k, 100);
+        BOOST_CHECK(v.find(150) == 0);
+        BOOST_REQUIRE(v.find(42) != 0);
+        BOOST_CHECK_EQUAL(*v.find(42), 42);
+        
+        concurrent_rbtree<int>::snapshot w = r2.pin();
+        BOOST_CHECK(w.find(42) == 0);
+        BOOST_CHECK(w.find(150) != 0);
+        BOOST_CHECK_EQUAL(std::distance(w.begin(), w.end()), 150);
+    }
+    
+    // nothing is pinned, the next write frees every retired node
+    t.insert(1000);
+    BOOST_CHECK_EQUAL(t.retired(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE( comparator )
+{
+    concurrent_rbtree<int, std::greater<int>> t;
+    concurrent_rbtree<int, std::greater<int>>::reader r(t);
+    for(int i = 0; i < 64; ++i) t.insert(i % 16);
+    BOOST_CHECK(t.check_invariant());
+    concurrent_rbtree<int, std::greater<int>>::snapshot v = r.pin();
+    BOOST_CHECK(std::is_sorted(v.begin(), v.end(), std::greater<int>()));
+    BOOST_CHECK_EQUAL(*v.lower_bound(20), 15);
+    BOOST_CHECK(v.lower_bound(-1) == v.end());
+}
+
+BOOST_AUTO_TEST_CASE( concurrent_readers )
+{
+    // the writer slides a window of consecutive keys, every
+    // version holds window or window + 1 of them.
+    int const window = 500;
+    concurrent_rbtree<int> t;
+    for(int i = 0; i < window; ++i) t.insert(i);
+    
+    std::atomic<bool> stop(false);
+    std::atomic<int> errors(0);
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 3; ++i){
+        readers.push_back(std::thread([&, i](){
+            concurrent_rbtree<int>::reader r(t);
+            std::mt19937 gen(i);
+            while(!stop.load()){
+                concurrent_rbtree<int>::snapshot v = r.pin();
+                int first = *v.begin();
+                int n = 0;
+                for(int a : v){
+                    if(a != first + n) ++errors;
+                    ++n;
+                }
+                if(n != window && n != window + 1) ++errors;
+                int k = first + static_cast<int>(gen() % n);
+                if(v.find(k) == 0 || *v.find(k) != k) ++errors;
+                if(v.contains(first + n)) ++errors;
+            }
+        }));
+    }
+    
+    for(int i = window; i < 20 * window; ++i){
+        t.insert(i);
+        BOOST_CHECK(t.erase(i - window));
+    }
+    stop.store(true);
+    for(std::thread& th : readers) th.join();
+    
+    BOOST_CHECK_EQUAL(errors.load(), 0);
+    BOOST_CHECK(t.check_invariant());
+    BOOST_CHECK_EQUAL(t.size(), static_cast<std::size_t>(window));
+}
@@ -0,0 +1,106 @@
+#define BOOST_TEST_MODULE fold
+#include <boost/test/included/unit_test.hpp>
+
+#include "tree.h"
+#include "nary_tree.h"
+#include "frozen_tree.h"
+#include "fold.h"
+#include <random>
+#include <numeric>
+#include <stdexcept>
+
+using namespace creek;
+
+typedef tree<int>::pre_order_iterator iterator;
+
+struct subtree_sum
+{
+    long operator()(int const& _v) const
+    { return _v; }
+    
+    long operator()(int const& _v, long const* _first, long const* _last) const
+    { return std::accumulate(_first, _last, static_cast<long>(_v)); }
+};
+
+//---- height, to check that children come in child order as well
+struct leftmost_depth
+{
+    std::size_t operator()(int const&) const
+    { return 0; }
+    
+    std::size_t operator()(int const&, std::size_t const* _first, std::size_t const*) const
+    { return *_first + 1; }
+};
+
+BOOST_AUTO_TEST_CASE( fold_tree )
+{
+    parallel::thread_pool pool(4);
+    std::mt19937 gen(7);
+    
+    tree<int> t1;
+    std::vector<iterator> nodes;
+    nodes.push_back(t1.insert(t1.pre_order_begin(), 1));
+    long expected = 1;
+    for(int i = 2; i < 30000; ++i){
+        std::uniform_int_distribution<std::size_t> pick(0, nodes.size() - 1);
+        nodes.push_back(t1.append_child(nodes[pick(gen)], i));
+        expected += i;
+    }
+    subtree_sum f;
+    BOOST_CHECK_EQUAL( fold_up(t1, f, f, 32, pool), expected );
+    BOOST_CHECK_EQUAL( fold_up(t1, f, f, 1 << 30, pool), expected );
+    
+    tree<int> const& ct = t1;
+    BOOST_CHECK_EQUAL( fold_up(ct, f, f), expected );
+    
+    frozen_tree<int> f1 = t1.freeze();
+    BOOST_CHECK_EQUAL( fold_up(f1, f, f, 32, pool), expected );
+    
+    //---- spine with a leaf on every level
+    tree<int> t2;
+    iterator it = t2.insert(t2.pre_order_begin(), 0);
+    for(int i = 0; i < 50000; ++i){
+        iterator next = t2.append_child(it, 1);
+        t2.append_child(it, 1);
+        it = next;
+    }
+    leftmost_depth d;
+    BOOST_CHECK_EQUAL( fold_up(t2, f, f, 16, pool), 100000 );
+    BOOST_CHECK_EQUAL( fold_up(t2, d, d, 16, pool), 50000 );
+    
+    tree<int> empty;
+    BOOST_CHECK_EQUAL( fold_up(empty, f, f, 16, pool), 0 );
+    
+    tree<int> single;
+    single.insert(single.pre_order_begin(), 5);
+    BOOST_CHECK_EQUAL( fold_up(single, f, f, 16, pool), 5 );
+}
+
+BOOST_AUTO_TEST_CASE( fold_nary_tree )
+{
+    parallel::thread_pool pool(2);
+    nary_tree<3, int> t1(8, 1);
+    BOOST_CHECK_EQUAL( t1.size(), 3280 );
+    subtree_sum f;
+    BOOST_CHECK_EQUAL( fold_up(t1, f, f, 16, pool), 3280 );
+    leftmost_depth d;
+    BOOST_CHECK_EQUAL( fold_up(t1, d, d, 16, pool), 7 );
+    
+    nary_tree<2, int> t2;
+    BOOST_CHECK_EQUAL( fold_up(t2, f, f, 16, pool), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( fold_exception )
+{
+    parallel::thread_pool pool(2);
+    tree<int> t1;
+    iterator it = t1.insert(t1.pre_order_begin(), 0);
+    for(int i = 1; i < 2000; ++i){
+        iterator c = t1.append_child(it, i);
+        t1.append_child(c, -i);
+    }
+    subtree_sum f;
+    BOOST_CHECK_THROW( fold_up(t1, [](int const& _v) -> long {
+        if(_v == -1500) throw std::runtime_error("leaf");
+        return _v; }, f, 8, pool), std::runtime_error );
+}
@@ -0,0 +1,114 @@
+#define BOOST_TEST_MODULE frozen_tree
+#include <boost/test/included/unit_test.hpp>
+
+#include "tree.h"
+#include "frozen_tree.h"
+#include <string>
+#include <algorithm>
+
+using namespace creek;
+
+// F(B(A D(C E)) G(I(H)))
+tree<std::string> make_tree()
+{
+    tree<std::string> t1;
+    tree<std::string>::pre_order_iterator a, b, c, d, e, f, g, h, i;
+    f = t1.insert(t1.pre_order_begin(), "F");
+    b = t1.append_child(f, "B");
+    g = t1.append_child(f, "G");
+    a = t1.append_child(b, "A");
+    d = t1.append_child(b, "D");
+    c = t1.append_child(d, "C");
+    e = t1.append_child(d, "E");
+    i = t1.append_child(g, "I");
+    h = t1.append_child(i, "H");
+    return t1;
+}
+
+BOOST_AUTO_TEST_CASE( freeze_orders )
+{
+    tree<std::string> t1 = make_tree();
+    frozen_tree<std::string> f1 = t1.freeze();
+    BOOST_CHECK_EQUAL( f1.size(), 9 );
+    BOOST_CHECK( !f1.empty() );
+    
+    BOOST_CHECK( std::equal(t1.pre_order_begin(), t1.pre_order_end(), f1.pre_order_begin()) );
+    BOOST_CHECK( std::equal(f1.values().begin(), f1.values().end(), t1.pre_order_begin()) );
+    BOOST_CHECK( std::equal(t1.post_order_begin(), t1.post_order_end(), f1.post_order_begin()) );
+    BOOST_CHECK( std::equal(t1.pre_order_rbegin(), t1.pre_order_rend(), f1.pre_order_rbegin()) );
+    BOOST_CHECK( std::equal(t1.post_order_rbegin(), t1.post_order_rend(), f1.post_order_rbegin()) );
+    BOOST_CHECK_EQUAL( std::distance(f1.post_order_begin(), f1.post_order_end()), 9 );
+    BOOST_CHECK_EQUAL( std::distance(f1.post_order_rbegin(), f1.post_order_rend()), 9 );
+    
+    tree<std::string>::const_pre_order_iterator it = t1.pre_order_begin();
+    frozen_tree<std::string>::const_pre_order_iterator jt = f1.pre_order_begin();
+    for(; it != t1.pre_order_end(); ++it, ++jt){
+        BOOST_CHECK( std::equal(child_order_begin(it), child_order_end(it), child_order_begin(jt)) );
+        BOOST_CHECK_EQUAL( std::distance(child_order_begin(jt), child_order_end(jt)),
+            std::distance(child_order_begin(it), child_order_end(it)) );
+        BOOST_CHECK( std::equal(child_order_rbegin(it), child_order_rend(it), child_order_rbegin(jt)) );
+        if(it != t1.pre_order_begin())
+            BOOST_CHECK_EQUAL( *parent(jt), *parent(it) );
+    }
+    BOOST_CHECK( jt == f1.pre_order_end() );
+}
+
+BOOST_AUTO_TEST_CASE( random_access_and_links )
+{
+    tree<std::string> t1 = make_tree();
+    frozen_tree<std::string> f1(t1);
+    typedef frozen_tree<std::string>::const_pre_order_iterator iterator;
+    
+    iterator b = f1.pre_order_begin();
+    BOOST_CHECK_EQUAL( f1.pre_order_end() - b, 9 );
+    BOOST_CHECK_EQUAL( b[3], "D" );
+    BOOST_CHECK_EQUAL( *(b + 6), "G" );
+    BOOST_CHECK( b < b + 1 );
+    BOOST_CHECK( b + 9 == f1.pre_order_end() );
+    
+    iterator g = b + 6;
+    BOOST_CHECK_EQUAL( f1.subtree_size(b), 9 );
+    BOOST_CHECK_EQUAL( f1.subtree_size(b + 1), 5 );
+    BOOST_CHECK_EQUAL( f1.subtree_size(g), 3 );
+    BOOST_CHECK_EQUAL( f1.index(g), 6 );
+    BOOST_CHECK( parent(g) == b );
+    BOOST_CHECK( parent(b) == iterator() );
+    BOOST_CHECK_EQUAL( *first_child(g), "I" );
+    BOOST_CHECK_EQUAL( *last_child(b), "G" );
+    BOOST_CHECK_EQUAL( *last_child(b + 1), "D" );
+    
+    frozen_tree<std::string>::const_child_order_iterator ch = child_order_end(b + 1);
+    --ch;
+    BOOST_CHECK_EQUAL( *ch, "D" );
+    --ch;
+    BOOST_CHECK_EQUAL( *ch, "A" );
+    BOOST_CHECK( ch == child_order_begin(b + 1) );
+    BOOST_CHECK( child_order_begin(b + 2) == child_order_end(b + 2) );
+    
+    //---- shares nothing with the source
+    t1.clear();
+    BOOST_CHECK_EQUAL( *b, "F" );
+    BOOST_CHECK_EQUAL( *(--f1.post_order_end()), "F" );
+}
+
+BOOST_AUTO_TEST_CASE( empty_and_single )
+{
+    tree<int> t1;
+    frozen_tree<int> f1 = t1.freeze(), f0;
+    BOOST_CHECK( f1.empty() );
+    BOOST_CHECK( f0.empty() );
+    BOOST_CHECK( f1.pre_order_begin() == f1.pre_order_end() );
+    BOOST_CHECK( f1.post_order_begin() == f1.post_order_end() );
+    BOOST_CHECK( f1.pre_order_rbegin() == f1.pre_order_rend() );
+    
+    t1.insert(t1.pre_order_begin(), 7);
+    frozen_tree<int> f2 = t1.freeze();
+    BOOST_CHECK_EQUAL( f2.size(), 1 );
+    BOOST_CHECK_EQUAL( *f2.post_order_begin(), 7 );
+    BOOST_CHECK_EQUAL( std::distance(f2.post_order_begin(), f2.post_order_end()), 1 );
+    BOOST_CHECK_EQUAL( *f2.pre_order_rbegin(), 7 );
+    
+    f1.swap(f2);
+    BOOST_CHECK_EQUAL( f1.size(), 1 );
+    BOOST_CHECK( f2.empty() );
+}
@@ -0,0 +1,112 @@
+#define BOOST_TEST_MODULE interval_tree
+#include <boost/test/included/unit_test.hpp>
+
+#include <vector>
+#include <random>
+#include <utility>
+#include <algorithm>
+
+#include "interval_tree.h"
+
+using namespace creek;
+
+typedef std::pair<int, int> interval;
+
+//---- the intervals of v overlapping [a, b), or holding a if b is a
+std::vector<interval> brute_force(std::vector<interval> const& _v, int _a, int _b, bool _point)
+{
+    std::vector<interval> r;
+    for(interval const& i : _v){
+        bool starts = _point ? i.first <= _a : i.first < _b;
+        if(starts && _a < i.second) r.push_back(i);
+    }
+    std::sort(r.begin(), r.end());
+    return r;
+}
+
+std::vector<interval> sorted(std::vector<interval> _v)
+{
+    std::sort(_v.begin(), _v.end());
+    return _v;
+}
+
+BOOST_AUTO_TEST_CASE( queries )
+{
+    std::mt19937 gen(23);
+    std::uniform_int_distribution<int> start(0, 1000), length(0, 60);
+    interval_tree<interval> t;
+    std::vector<interval> v;
+    BOOST_CHECK(!t.any_overlap(0, 100));
+    BOOST_CHECK(t.overlapping(0, 100).first == t.overlapping(0, 100).second);
+    
+    for(int round = 0; round < 8; ++round){
+        for(int i = 0; i < 300; ++i){
+            int s = start(gen);
+            interval a(s, s + length(gen));
+            t.insert(a);
+            v.push_back(a);
+        }
+        for(int i = 0; i < 100; ++i){
+            int a = start(gen);
+            auto r = t.overlapping(a, a + 5);
+            if(r.first == r.second) continue;
+            v.erase(std::find(v.begin(), v.end(), *r.first));
+            t.erase(r.first);
+        }
+        BOOST_REQUIRE(t.check_invariant());
+        BOOST_CHECK_EQUAL(t.size(), v.size());
+        
+        for(int q = 0; q < 200; ++q){
+            int a = start(gen) - 20;
+            int b = a + length(gen);
+            bool point = q % 4 == 0;
+            std::vector<interval> expect = brute_force(v, a, b, point);
+            
+            std::vector<interval> found;
+            if(point) t.for_each_overlapping(a, [&](interval const& _i){ found.push_back(_i); });
+            else t.for_each_overlapping(a, b, [&](interval const& _i){ found.push_back(_i); });
+            BOOST_CHECK(std::is_sorted(found.begin(), found.end(),
+                [](interval const& _x, interval const& _y){ return _x.first < _y.first; }));
+            BOOST_CHECK(sorted(found) == expect);
+            
+            auto r = point ? t.overlapping(a) : t.overlapping(a, b);
+            std::vector<interval> walked(r.first, r.second);
+            BOOST_CHECK(walked == found);
+            
+            BOOST_CHECK_EQUAL(point ? t.any_overlap(a) : t.any_overlap(a, b), !expect.empty());
+        }
+    }
+    
+    t.clear();
+    BOOST_CHECK(t.empty());
+    BOOST_CHECK(!t.any_overlap(0, 2000));
+}
+
+BOOST_AUTO_TEST_CASE( bounds )
+{
+    std::vector<interval> v = { {0, 10}, {10, 20}, {5, 5}, {15, 30}, {25, 26} };
+    interval_tree<interval> t(v.begin(), v.end());
+    BOOST_CHECK(t.check_invariant());
+    
+    //---- the ends are open
+    std::vector<interval> r;
+    t.for_each_overlapping(10, [&](interval const& _i){ r.push_back(_i); });
+    BOOST_CHECK(r == std::vector<interval>({ {10, 20} }));
+    r.clear();
+    t.for_each_overlapping(20, 25, [&](interval const& _i){ r.push_back(_i); });
+    BOOST_CHECK(r == std::vector<interval>({ {15, 30} }));
+    BOOST_CHECK(!t.any_overlap(30, 40));
+    BOOST_CHECK(t.any_overlap(29, 40));
+    BOOST_CHECK(!t.any_overlap(-5, 0));
+    
+    //---- erase through the overlap range
+    auto range = t.overlapping(0, 12);
+    for(auto it = range.first; it != range.second; ++it) BOOST_CHECK(it->first < 12);
+    BOOST_CHECK(*t.overlapping(25).first == interval(15, 30));
+    t.erase(t.overlapping(25).first);
+    r.clear();
+    t.for_each_overlapping(25, [&](interval const& _i){ r.push_back(_i); });
+    BOOST_CHECK(r == std::vector<interval>({ {25, 26} }));
+    BOOST_CHECK_EQUAL(t.size(), 4u);
+    BOOST_CHECK(t.check_invariant());
+}
@@ -516,4 +516,22 @@ BOOST_AUTO_TEST_CASE( with_out_traits_with_predicate )
     BOOST_CHECK(std::equal(it, end, jt));
 }
 
-
+BOOST_AUTO_TEST_CASE( level_order )
+{
+    std::vector<double> elem =
+        {96.0, 47.0, 11.0, 32.0, 56.0, 8.0, 13.0, 23.0, 61.0, 72.0};
+    
+    typedef creek::kdtree<double, 1> tree;
+    tree const t1(elem.begin(), elem.end());
+    std::vector<double> expect =
+        {47.0, 13.0, 72.0, 11.0, 32.0, 61.0, 96.0, 8.0, 23.0, 56.0};
+    BOOST_CHECK(std::equal(t1.level_order_begin(), t1.level_order_end(), expect.begin()));
+    BOOST_CHECK(std::distance(t1.level_order_begin(), t1.level_order_end()) == 10);
+    
+    auto r = t1.level_range(2);
+    BOOST_CHECK(std::distance(r.first, r.second) == 4);
+    BOOST_CHECK(std::equal(r.first, r.second, expect.begin() + 3));
+    
+    tree empty;
+    BOOST_CHECK(empty.level_order_begin() == empty.level_order_end());
+}
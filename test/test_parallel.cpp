@@ -0,0 +1,136 @@
+#define BOOST_TEST_MODULE parallel
+#include <boost/test/included/unit_test.hpp>
+
+#include "tree.h"
+#include "frozen_tree.h"
+#include "parallel.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace creek;
+
+typedef tree<int>::pre_order_iterator iterator;
+
+bool all_visited_once(tree<int> const& _t)
+{
+    return std::count(_t.pre_order_begin(), _t.pre_order_end(), 1) == _t.size();
+}
+
+BOOST_AUTO_TEST_CASE( task_group )
+{
+    parallel::thread_pool pool(3);
+    BOOST_CHECK_EQUAL( pool.size(), 3 );
+    
+    std::atomic<int> count(0);
+    parallel::task_group group(pool);
+    for(int i = 0; i < 1000; ++i)
+        group.run([&count](){ ++count; });
+    group.wait();
+    BOOST_CHECK_EQUAL( count.load(), 1000 );
+    
+    group.run([](){ throw std::runtime_error("task"); });
+    BOOST_CHECK_THROW( group.wait(), std::runtime_error );
+    group.wait();
+}
+
+BOOST_AUTO_TEST_CASE( for_each_node_shapes )
+{
+    parallel::thread_pool pool(4);
+    std::mt19937 gen(42);
+    
+    //---- random
+    tree<int> t1;
+    std::vector<iterator> nodes;
+    nodes.push_back(t1.insert(t1.pre_order_begin(), 0));
+    for(int i = 0; i < 20000; ++i){
+        std::uniform_int_distribution<std::size_t> pick(0, nodes.size() - 1);
+        nodes.push_back(t1.append_child(nodes[pick(gen)], 0));
+    }
+    parallel::for_each_node(t1, [](int& _v){ ++_v; }, 16, pool);
+    BOOST_CHECK( all_visited_once(t1) );
+    
+    //---- spine with a leaf on every level
+    tree<int> t2;
+    iterator it = t2.insert(t2.pre_order_begin(), 0);
+    for(int i = 0; i < 20000; ++i){
+        t2.append_child(it, 0);
+        it = t2.append_child(it, 0);
+    }
+    parallel::for_each_node(t2, [](int& _v){ ++_v; }, 16, pool);
+    BOOST_CHECK( all_visited_once(t2) );
+    
+    //---- wide
+    tree<int> t3;
+    it = t3.insert(t3.pre_order_begin(), 0);
+    for(int i = 0; i < 100; ++i){
+        iterator c = t3.append_child(it, 0);
+        for(int j = 0; j < 100; ++j)
+            t3.append_child(c, 0);
+    }
+    parallel::for_each_node(t3, [](int& _v){ ++_v; }, 64, pool);
+    BOOST_CHECK( all_visited_once(t3) );
+    
+    //---- const tree, default pool and grain
+    std::atomic<long> sum(0);
+    tree<int> const& ct = t3;
+    parallel::for_each_node(ct, [&sum](int const& _v){ sum += _v; });
+    BOOST_CHECK_EQUAL( sum.load(), static_cast<long>(t3.size()) );
+    
+    tree<int> empty;
+    parallel::for_each_node(empty, [](int& _v){ ++_v; }, 16, pool);
+}
+
+BOOST_AUTO_TEST_CASE( for_each_node_frozen )
+{
+    parallel::thread_pool pool(4);
+    tree<int> t1;
+    iterator it = t1.insert(t1.pre_order_begin(), 1);
+    for(int i = 2; i <= 5000; ++i){
+        t1.append_child(it, i);
+        if(i % 7 == 0) it = t1.append_child(it, ++i);
+    }
+    frozen_tree<int> f1 = t1.freeze();
+    
+    std::atomic<long> sum(0), count(0);
+    parallel::for_each_node(f1, [&](int const& _v){ sum += _v; ++count; }, 8, pool);
+    BOOST_CHECK_EQUAL( count.load(), static_cast<long>(f1.size()) );
+    long expected = 0;
+    for(frozen_tree<int>::const_pre_order_iterator jt = f1.pre_order_begin(); jt != f1.pre_order_end(); ++jt)
+        expected += *jt;
+    BOOST_CHECK_EQUAL( sum.load(), expected );
+    
+    BOOST_CHECK_THROW( parallel::for_each_node(f1, [](int const& _v){
+        if(_v == 4000) throw std::runtime_error("node"); }, 8, pool), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( size_after_splice )
+{
+    tree<int> t1, t2;
+    iterator a = t1.insert(t1.pre_order_begin(), 0);
+    iterator b = t2.insert(t2.pre_order_begin(), 0);
+    for(int i = 1; i <= 1000; ++i){
+        iterator c = t1.append_child(a, i);
+        t1.append_child(c, -i);
+    }
+    
+    // a subtree with children leaves both counts to be recomputed,
+    // here by several readers of the const trees at once
+    for(int round = 1; round <= 20; ++round){
+        t2.splice_child(b, child_order_end(b), t1, child_order_begin(a));
+        tree<int> const& c1 = t1;
+        tree<int> const& c2 = t2;
+        std::atomic<int> wrong(0);
+        std::vector<std::thread> readers;
+        for(int i = 0; i < 4; ++i)
+            readers.push_back(std::thread([&]{
+                if(c1.size() != 2001u - 2 * round) ++wrong;
+                if(c2.size() != 1u + 2 * round) ++wrong;
+            }));
+        for(std::size_t i = 0; i < readers.size(); ++i) readers[i].join();
+        BOOST_CHECK_EQUAL( wrong.load(), 0 );
+    }
+}
@@ -0,0 +1,155 @@
+#define BOOST_TEST_MODULE persistent_rbtree
+#include <boost/test/included/unit_test.hpp>
+
+#include <set>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "persistent_rbtree.h"
+
+using namespace creek;
+
+std::atomic<long> live_nodes(0);
+
+//---- counts the nodes alive
+template<typename T>
+struct node_counter : public std::allocator<T>
+{
+    template<typename U>
+    struct rebind { typedef node_counter<U> other; };
+    
+    node_counter() {}
+    template<typename U>
+    node_counter(node_counter<U> const&) {}
+    
+    T* allocate(std::size_t _n)
+    {
+        live_nodes += static_cast<long>(_n);
+        return std::allocator<T>::allocate(_n);
+    }
+    
+    void deallocate(T* _p, std::size_t _n)
+    {
+        live_nodes -= static_cast<long>(_n);
+        std::allocator<T>::deallocate(_p, _n);
+    }
+};
+
+typedef persistent_rbtree<int, rbtree_default, node_counter<int>> counted_tree;
+
+BOOST_AUTO_TEST_CASE( versions )
+{
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(0, 400);
+    {
+        std::vector<counted_tree> versions(1);
+        std::vector<std::multiset<int>> sets(1);
+        for(int i = 0; i < 3000; ++i){
+            int k = dist(gen);
+            std::multiset<int> s = sets.back();
+            if(gen() % 3 != 0){
+                versions.push_back(versions.back().insert(k));
+                s.insert(k);
+            }
+            else{
+                versions.push_back(versions.back().erase(k));
+                if(s.find(k) != s.end()) s.erase(s.find(k));
+            }
+            sets.push_back(s);
+            BOOST_REQUIRE(versions.back().check_invariant());
+        }
+        
+        // every version still holds what it held when it was made
+        for(std::size_t i = 0; i < versions.size(); i += 37){
+            counted_tree const& t = versions[i];
+            BOOST_REQUIRE(t.check_invariant());
+            BOOST_CHECK_EQUAL(t.size(), sets[i].size());
+            BOOST_CHECK(std::equal(sets[i].begin(), sets[i].end(), t.begin()));
+            BOOST_CHECK(std::distance(t.begin(), t.end()) == static_cast<long>(sets[i].size()));
+            int k = dist(gen);
+            BOOST_CHECK_EQUAL(t.contains(k), sets[i].count(k) != 0);
+            BOOST_CHECK(std::equal(sets[i].lower_bound(k), sets[i].end(), t.lower_bound(k)));
+        }
+        
+        // the versions share their nodes, a few per write
+        BOOST_CHECK(live_nodes < 3000 * 40);
+        
+        counted_tree last = versions.back();
+        versions.clear();
+        BOOST_CHECK_EQUAL(live_nodes, static_cast<long>(last.size()));
+        BOOST_CHECK(std::equal(sets.back().begin(), sets.back().end(), last.begin()));
+    }
+    BOOST_CHECK_EQUAL(live_nodes, 0);
+}
+
+BOOST_AUTO_TEST_CASE( copy_and_assign )
+{
+    {
+        counted_tree t1;
+        for(int i = 0; i < 200; ++i) t1 = t1.insert(i);
+        long n = live_nodes;
+        BOOST_CHECK_EQUAL(n, 200);
+        
+        counted_tree t2(t1);
+        counted_tree t3;
+        t3 = t2;
+        BOOST_CHECK_EQUAL(live_nodes, n);
+        
+        t2 = t2.erase(100);
+        BOOST_CHECK(t2.find(100) == 0);
+        BOOST_REQUIRE(t1.find(100) != 0);
+        BOOST_CHECK_EQUAL(*t1.find(100), 100);
+        BOOST_CHECK(live_nodes < n + 40);
+        
+        counted_tree t4 = t2.erase(1000);
+        BOOST_CHECK_EQUAL(t4.size(), t2.size());
+        
+        t1 = counted_tree();
+        t3 = std::move(t4);
+        BOOST_CHECK(t1.empty());
+        BOOST_CHECK_EQUAL(t3.size(), 199u);
+        BOOST_CHECK(t3.check_invariant());
+    }
+    BOOST_CHECK_EQUAL(live_nodes, 0);
+}
+
+BOOST_AUTO_TEST_CASE( comparator )
+{
+    persistent_rbtree<int, std::greater<int>> t;
+    for(int i = 0; i < 64; ++i) t = t.insert(i % 16);
+    BOOST_CHECK(t.check_invariant());
+    BOOST_CHECK(std::is_sorted(t.begin(), t.end(), std::greater<int>()));
+    BOOST_CHECK_EQUAL(*t.lower_bound(20), 15);
+    BOOST_CHECK(t.lower_bound(-1) == t.end());
+}
+
+BOOST_AUTO_TEST_CASE( threads )
+{
+    // every thread grows its own versions from one shared base
+    {
+        counted_tree base;
+        for(int i = 0; i < 1000; ++i) base = base.insert(i);
+        
+        std::atomic<int> errors(0);
+        std::vector<std::thread> threads;
+        for(int i = 0; i < 4; ++i){
+            threads.push_back(std::thread([&, i](){
+                std::mt19937 gen(i);
+                counted_tree t = base;
+                for(int j = 0; j < 2000; ++j){
+                    int k = static_cast<int>(gen() % 1000);
+                    t = (j % 2 == 0) ? t.erase(k) : t.insert(k);
+                }
+                if(!t.check_invariant()) ++errors;
+                if(!base.check_invariant() || base.size() != 1000) ++errors;
+            }));
+        }
+        for(std::thread& th : threads) th.join();
+        BOOST_CHECK_EQUAL(errors.load(), 0);
+        BOOST_CHECK_EQUAL(live_nodes, 1000);
+    }
+    BOOST_CHECK_EQUAL(live_nodes, 0);
+}
@@ -4,11 +4,18 @@
 
 #include <iostream>
 #include <vector>
+#include <list>
+#include <set>
+#include <iterator>
 #include <array>
 #include <cstddef>
 #include <functional>
+#include <algorithm>
+#include <string>
+#include <numeric>
 
 #include "rbtree.h"
+#include "thread_pool.h"
 
 using namespace creek;
 
@@ -109,4 +116,659 @@ BOOST_AUTO_TEST_CASE( predicate )
     }
 }
 
+BOOST_AUTO_TEST_CASE( reverse_iterators )
+{
+    using namespace creek;
+    rbtree<int> t1;
+    t1.insert(5);
+    BOOST_CHECK_EQUAL(*t1.in_order_rbegin(), 5);
+    BOOST_CHECK(++t1.in_order_rbegin() == t1.in_order_rend());
+    
+    for(int i = 0; i < 500; ++i) t1.insert((i * 7919) % 1000);
+    {
+        std::vector<int> expect(t1.pre_order_begin(), t1.pre_order_end());
+        std::vector<int> r(t1.pre_order_rbegin(), t1.pre_order_rend());
+        std::reverse(expect.begin(), expect.end());
+        BOOST_CHECK(r == expect);
+    }
+    {
+        std::vector<int> expect(t1.post_order_begin(), t1.post_order_end());
+        std::vector<int> r(t1.post_order_rbegin(), t1.post_order_rend());
+        std::reverse(expect.begin(), expect.end());
+        BOOST_CHECK(r == expect);
+    }
+    {
+        std::vector<int> expect(t1.in_order_begin(), t1.in_order_end());
+        std::vector<int> r(t1.in_order_rbegin(), t1.in_order_rend());
+        std::reverse(expect.begin(), expect.end());
+        BOOST_CHECK(r == expect);
+        
+        //---- stepping back and forth
+        auto it = t1.in_order_rbegin();
+        ++it; ++it; --it;
+        BOOST_CHECK_EQUAL(*it, expect[1]);
+        auto jt = t1.in_order_rend();
+        --jt;
+        BOOST_CHECK_EQUAL(*jt, expect.back());
+        BOOST_CHECK(jt.base() == t1.in_order_begin().base());
+        
+        rbtree<int>::const_reverse_in_order_iterator ct = it;
+        BOOST_CHECK(ct == it);
+    }
+}
 
+BOOST_AUTO_TEST_CASE( level_order )
+{
+    using namespace creek;
+    rbtree<int> t1;
+    BOOST_CHECK(t1.level_order_begin() == t1.level_order_end());
+    for(int i = 0; i < 1000; ++i) t1.insert((i * 7919) % 1000);
+    
+    //---- breadth first by hand
+    typedef rbtree<int>::const_pre_order_iterator iterator;
+    rbtree<int> const& ct = t1;
+    std::vector<int> expect;
+    std::vector<std::size_t> first;
+    std::vector<iterator> level(1, ct.pre_order_begin()), next;
+    while(!level.empty()){
+        first.push_back(expect.size());
+        next.clear();
+        for(std::size_t i = 0; i < level.size(); ++i){
+            expect.push_back(*level[i]);
+            if(left_child(level[i]) != iterator()) next.push_back(left_child(level[i]));
+            if(right_child(level[i]) != iterator()) next.push_back(right_child(level[i]));
+        }
+        level.swap(next);
+    }
+    first.push_back(expect.size());
+    
+    std::vector<int> r(t1.level_order_begin(), t1.level_order_end());
+    BOOST_CHECK(r == expect);
+    for(std::size_t k = 0; k + 1 < first.size(); ++k){
+        auto range = ct.level_range(k);
+        std::vector<int> lv(range.first, range.second);
+        BOOST_CHECK(lv == std::vector<int>(expect.begin() + first[k], expect.begin() + first[k + 1]));
+    }
+    BOOST_CHECK(t1.level_range(first.size()).first == t1.level_range(first.size()).second);
+}
+
+//---- ordered by id, looked up by id alone
+struct record
+{
+    int id;
+    int payload;
+};
+
+struct record_less
+{
+    typedef void is_transparent;
+    bool operator()(record const& _a, record const& _b) const { return _a.id < _b.id; }
+    bool operator()(record const& _a, int _b) const { return _a.id < _b; }
+    bool operator()(int _a, record const& _b) const { return _a < _b.id; }
+};
+
+BOOST_AUTO_TEST_CASE( lookup )
+{
+    using namespace creek;
+    rbtree<int> t1;
+    BOOST_CHECK(t1.find(3) == t1.in_order_end());
+    BOOST_CHECK(t1.lower_bound(3) == t1.in_order_end());
+    BOOST_CHECK_EQUAL(t1.count(3), 0u);
+    
+    for(int i = 0; i < 200; ++i){
+        t1.insert(i * 2);
+        if(i % 10 == 0) t1.insert(i * 2);
+    }
+    for(int i = -2; i < 402; ++i){
+        auto lb = t1.lower_bound(i);
+        auto ub = t1.upper_bound(i);
+        auto eq = t1.equal_range(i);
+        BOOST_CHECK(eq.first == lb && eq.second == ub);
+        std::size_t expect = (i >= 0 && i < 400 && i % 2 == 0) ? ((i % 20 == 0) ? 2 : 1) : 0;
+        BOOST_CHECK_EQUAL(t1.count(i), expect);
+        BOOST_CHECK_EQUAL(std::distance(lb, ub), static_cast<std::ptrdiff_t>(expect));
+        if(lb != t1.in_order_end()) BOOST_CHECK(*lb >= i);
+        if(lb != t1.in_order_begin()) BOOST_CHECK(*std::prev(lb) < i);
+        if(expect != 0){
+            BOOST_CHECK(t1.find(i) == lb);
+            BOOST_CHECK_EQUAL(*t1.find(i), i);
+        }else{
+            BOOST_CHECK(t1.find(i) == t1.in_order_end());
+        }
+    }
+    
+    //---- other key types are fine with rbtree_default
+    BOOST_CHECK_EQUAL(*t1.lower_bound(3.5), 4);
+    rbtree<int> const& ct = t1;
+    BOOST_CHECK(ct.upper_bound(398) == ct.in_order_end());
+    
+    //---- the comparator orders the lookup as well
+    auto t2 = rbtree<int, std::function<bool(int,int)>>(std::greater<int>());
+    for(int i = 0; i < 50; ++i) t2.insert(i);
+    BOOST_CHECK_EQUAL(*t2.lower_bound(20), 20);
+    BOOST_CHECK_EQUAL(*t2.upper_bound(20), 19);
+    BOOST_CHECK_EQUAL(*t2.find(7), 7);
+    BOOST_CHECK(t2.find(70) == t2.in_order_end());
+    
+    auto t3 = rbtree<std::string, std::function<bool(std::string const&, std::string const&)>>(
+        std::less<std::string>());
+    t3.insert("b");
+    t3.insert("a");
+    BOOST_CHECK(t3.find("a") == t3.in_order_begin());
+    
+    //---- transparent comparator
+    rbtree<record, record_less> t4;
+    for(int i = 0; i < 100; ++i) t4.insert(record{i, i * i});
+    BOOST_CHECK_EQUAL(t4.find(12)->payload, 144);
+    BOOST_CHECK(t4.find(100) == t4.in_order_end());
+    BOOST_CHECK_EQUAL(t4.count(5), 1u);
+    BOOST_CHECK_EQUAL(t4.lower_bound(record{50, 0})->id, 50);
+}
+
+BOOST_AUTO_TEST_CASE( order_statistics )
+{
+    typedef rbtree<int, rbtree_default, std::allocator<int>, rbtree_order_statistics> tree_type;
+    boost::mt19937 gen(7);
+    boost::uniform_int<> dist(0, 500);
+    tree_type t1;
+    BOOST_CHECK(t1.nth(0) == t1.in_order_end());
+    BOOST_CHECK_EQUAL(t1.rank(3), 0u);
+    BOOST_CHECK_EQUAL(t1.index(t1.in_order_end()), 0u);
+    
+    for(int round = 0; round < 6; ++round){
+        for(int i = 0; i < 400; ++i) t1.insert(dist(gen));
+        for(int i = 0; i < 150; ++i){
+            auto it = t1.nth(std::size_t(dist(gen)) % t1.size());
+            t1.erase(it);
+        }
+        BOOST_CHECK(t1.check_invariant());
+        
+        std::vector<int> v(t1.in_order_begin(), t1.in_order_end());
+        for(std::size_t k = 0; k < v.size(); ++k){
+            auto it = t1.nth(k);
+            BOOST_CHECK_EQUAL(*it, v[k]);
+            BOOST_CHECK_EQUAL(t1.index(it), k);
+        }
+        BOOST_CHECK(t1.nth(v.size()) == t1.in_order_end());
+        BOOST_CHECK_EQUAL(t1.index(t1.in_order_end()), v.size());
+        for(int i = -1; i < 502; i += 3){
+            std::size_t less = std::lower_bound(v.begin(), v.end(), i) - v.begin();
+            std::size_t same = std::upper_bound(v.begin(), v.end(), i) - v.begin() - less;
+            BOOST_CHECK_EQUAL(t1.rank(i), less);
+            BOOST_CHECK_EQUAL(t1.count(i), same);
+            auto r = t1.equal_range(i);
+            BOOST_CHECK_EQUAL(t1.distance(r.first, r.second), static_cast<std::ptrdiff_t>(same));
+        }
+        BOOST_CHECK_EQUAL(t1.distance(t1.in_order_end(), t1.in_order_begin()),
+            -static_cast<std::ptrdiff_t>(v.size()));
+    }
+    
+    //---- copies keep the sizes
+    tree_type t2 = t1;
+    BOOST_CHECK_EQUAL(*t2.nth(t2.size() / 2), *t1.nth(t1.size() / 2));
+    BOOST_CHECK_EQUAL(t2.rank(250), t1.rank(250));
+}
+
+//---- sum of the elements
+struct sum_aggregate
+{
+    typedef long result_type;
+    long identity() const { return 0; }
+    long lift(int _a) const { return _a; }
+    long combine(long _a, long _b) const { return _a + _b; }
+};
+
+//---- the elements in order, to see that combine keeps it
+struct concat_aggregate
+{
+    typedef std::string result_type;
+    std::string identity() const { return std::string(); }
+    std::string lift(int _a) const { return std::to_string(_a) + ","; }
+    std::string combine(std::string const& _a, std::string const& _b) const { return _a + _b; }
+};
+
+BOOST_AUTO_TEST_CASE( aggregate )
+{
+    typedef augmented_rbtree<int, rbtree_default, sum_aggregate> sum_tree;
+    boost::mt19937 gen(17);
+    boost::uniform_int<> dist(0, 300);
+    sum_tree t1;
+    std::multiset<int> s;
+    BOOST_CHECK_EQUAL(t1.aggregate(), 0);
+    BOOST_CHECK_EQUAL(t1.aggregate(0, 100), 0);
+    
+    for(int i = 0; i < 3000; ++i){
+        int k = dist(gen);
+        if(i % 3 != 2){
+            t1.insert(k);
+            s.insert(k);
+        }
+        else if(s.count(k) != 0){
+            t1.erase(t1.find(k));
+            s.erase(s.find(k));
+        }
+        if(i % 100 == 0){
+            BOOST_REQUIRE(t1.check_invariant());
+            BOOST_CHECK_EQUAL(t1.aggregate(), std::accumulate(s.begin(), s.end(), 0L));
+            for(int j = 0; j < 20; ++j){
+                int lo = dist(gen) - 5, hi = dist(gen) + 5;
+                long expect = std::accumulate(s.lower_bound(lo),
+                    (lo < hi) ? s.lower_bound(hi) : s.lower_bound(lo), 0L);
+                BOOST_CHECK_EQUAL(t1.aggregate(lo, hi), expect);
+            }
+        }
+    }
+    
+    //---- split, join and copies keep the sums
+    sum_tree t2;
+    t1.split(150, t2);
+    BOOST_CHECK_EQUAL(t1.aggregate(), std::accumulate(s.begin(), s.lower_bound(150), 0L));
+    BOOST_CHECK_EQUAL(t2.aggregate(), std::accumulate(s.lower_bound(150), s.end(), 0L));
+    t1.join(t2);
+    sum_tree t3 = t1;
+    BOOST_CHECK_EQUAL(t3.aggregate(20, 250), std::accumulate(s.lower_bound(20), s.lower_bound(250), 0L));
+    
+    //---- combine is not assumed to commute
+    augmented_rbtree<int, std::greater<int>, concat_aggregate> t4;
+    for(int i = 0; i < 40; ++i) t4.insert((i * 7) % 40);
+    std::string expect;
+    for(int i = 29; i > 9; --i) expect += std::to_string(i) + ",";
+    BOOST_CHECK_EQUAL(t4.aggregate(29, 9), expect);
+    BOOST_CHECK(t4.check_invariant());
+}
+
+BOOST_AUTO_TEST_CASE( bulk_construct )
+{
+    boost::mt19937 gen(3);
+    boost::uniform_int<> dist(0, 1000);
+    for(std::size_t n = 0; n < 70; ++n){
+        std::vector<int> v;
+        for(std::size_t i = 0; i < n; ++i) v.push_back(dist(gen));
+        std::vector<int> sorted = v;
+        std::sort(sorted.begin(), sorted.end());
+        
+        rbtree<int> t1(sorted.begin(), sorted.end());
+        BOOST_CHECK(t1.check_invariant());
+        BOOST_CHECK_EQUAL(t1.size(), n);
+        BOOST_CHECK(std::equal(sorted.begin(), sorted.end(), t1.in_order_begin()));
+        
+        rbtree<int> t2(v.begin(), v.end());
+        BOOST_CHECK(t2.check_invariant());
+        BOOST_CHECK(std::equal(sorted.begin(), sorted.end(), t2.in_order_begin()));
+        
+        //---- the tree stays usable
+        t2.insert(500);
+        if(n != 0) t2.erase(t2.in_order_begin());
+        BOOST_CHECK(t2.check_invariant());
+    }
+    
+    std::vector<int> v;
+    for(int i = 0; i < 5000; ++i) v.push_back(dist(gen));
+    std::list<int> l(v.begin(), v.end());
+    rbtree<int> t3;
+    t3.insert(-1);
+    t3.assign(l.begin(), l.end());
+    BOOST_CHECK(t3.check_invariant());
+    BOOST_CHECK_EQUAL(t3.size(), v.size());
+    BOOST_CHECK(std::is_sorted(t3.in_order_begin(), t3.in_order_end()));
+    BOOST_CHECK_EQUAL(*t3.in_order_begin(), *std::min_element(v.begin(), v.end()));
+    
+    //---- the comparator decides what is sorted
+    auto t4 = rbtree<int, std::function<bool(int,int)>>(v.begin(), v.end(), std::greater<int>());
+    BOOST_CHECK(t4.check_invariant());
+    BOOST_CHECK(std::is_sorted(t4.in_order_begin(), t4.in_order_end(), std::greater<int>()));
+    
+    //---- node data is built as well
+    typedef rbtree<int, rbtree_default, std::allocator<int>, rbtree_order_statistics> tree_type;
+    std::sort(v.begin(), v.end());
+    tree_type t5(v.begin(), v.end());
+    BOOST_CHECK_EQUAL(*t5.nth(1234), v[1234]);
+    BOOST_CHECK_EQUAL(t5.rank(v[4000]), std::size_t(std::lower_bound(v.begin(), v.end(), v[4000]) - v.begin()));
+}
+
+BOOST_AUTO_TEST_CASE( split_join )
+{
+    boost::mt19937 gen(17);
+    boost::uniform_int<> dist(0, 300);
+    for(int round = 0; round < 40; ++round){
+        std::vector<int> v;
+        std::size_t n = round * 25;
+        for(std::size_t i = 0; i < n; ++i) v.push_back(dist(gen));
+        std::sort(v.begin(), v.end());
+        
+        rbtree<int> t1;
+        for(std::size_t i = 0; i < n; ++i) t1.insert(v[i]);
+        rbtree<int> t2;
+        t2.insert(-5);
+        int key = dist(gen);
+        t1.split(key, t2);
+        auto mid = std::lower_bound(v.begin(), v.end(), key);
+        BOOST_CHECK(t1.check_invariant() && t2.check_invariant());
+        BOOST_CHECK_EQUAL(t1.size(), std::size_t(mid - v.begin()));
+        BOOST_CHECK_EQUAL(t2.size(), std::size_t(v.end() - mid));
+        BOOST_CHECK(std::equal(v.begin(), mid, t1.in_order_begin()));
+        BOOST_CHECK(std::equal(mid, v.end(), t2.in_order_begin()));
+        BOOST_CHECK(std::equal(v.rbegin(), std::vector<int>::reverse_iterator(mid), t2.in_order_rbegin()));
+        
+        t1.join(key, t2);
+        BOOST_CHECK(t1.check_invariant());
+        BOOST_CHECK(t2.empty());
+        v.insert(mid, key);
+        BOOST_CHECK_EQUAL(t1.size(), v.size());
+        BOOST_CHECK(std::equal(v.begin(), v.end(), t1.in_order_begin()));
+        
+        t1.split(key + 1, t2);
+        t1.join(t2);
+        BOOST_CHECK(t1.check_invariant());
+        BOOST_CHECK(std::equal(v.begin(), v.end(), t1.in_order_begin()));
+        t1.insert(key);
+        BOOST_CHECK(t1.check_invariant());
+    }
+    
+    //---- subtree sizes survive
+    typedef rbtree<int, rbtree_default, std::allocator<int>, rbtree_order_statistics> tree_type;
+    std::vector<int> v;
+    for(int i = 0; i < 3000; ++i) v.push_back(i);
+    tree_type t3(v.begin(), v.end());
+    tree_type t4;
+    t3.split(1000, t4);
+    BOOST_CHECK_EQUAL(t3.size(), 1000u);
+    BOOST_CHECK_EQUAL(*t4.nth(10), 1010);
+    t3.join(t4);
+    t3.split(2000, t4);
+    t3.join(1999, t4);
+    BOOST_CHECK(t3.check_invariant());
+    BOOST_CHECK_EQUAL(t3.size(), 3001u);
+    BOOST_CHECK_EQUAL(*t3.nth(2000), 1999);
+    BOOST_CHECK_EQUAL(*t3.nth(2001), 2000);
+    BOOST_CHECK_EQUAL(t3.rank(2000), 2001u);
+    BOOST_CHECK_EQUAL(t3.rank(500), 500u);
+}
+
+BOOST_AUTO_TEST_CASE( set_operations )
+{
+    boost::mt19937 gen(23);
+    parallel::thread_pool pool(3);
+    for(int round = 0; round < 30; ++round){
+        boost::uniform_int<> dist(0, 50 + round * 400);
+        std::vector<int> a, b;
+        for(int i = 0; i < round * 200; ++i) a.push_back(dist(gen));
+        for(int i = 0; i < round * 150 + (round % 3) * 2000; ++i) b.push_back(dist(gen));
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        std::size_t grain = (round % 2 == 0) ? 1024 : 4;
+        //---- every third round runs sequentially
+        
+        //---- duplicates in *this are kept, those of _other come over
+        //     when *this has none
+        std::vector<int> more;
+        for(std::size_t i = 0; i < b.size(); ++i)
+            if(!std::binary_search(a.begin(), a.end(), b[i])) more.push_back(b[i]);
+        std::vector<int> expect;
+        std::merge(a.begin(), a.end(), more.begin(), more.end(), std::back_inserter(expect));
+        
+        rbtree<int> t1(a.begin(), a.end());
+        rbtree<int> t2(b.begin(), b.end());
+        if(round % 3 == 0) t1.union_with(t2);
+        else t1.union_with(t2, grain, pool);
+        BOOST_CHECK(t1.check_invariant());
+        BOOST_CHECK(t2.empty());
+        BOOST_CHECK_EQUAL(t1.size(), expect.size());
+        BOOST_CHECK(std::equal(expect.begin(), expect.end(), t1.in_order_begin()));
+        
+        expect.clear();
+        for(std::size_t i = 0; i < a.size(); ++i)
+            if(std::binary_search(b.begin(), b.end(), a[i])) expect.push_back(a[i]);
+        rbtree<int> t3(a.begin(), a.end());
+        rbtree<int> t4(b.begin(), b.end());
+        if(round % 3 == 0) t3.intersect_with(t4);
+        else t3.intersect_with(t4, grain, pool);
+        BOOST_CHECK(t3.check_invariant());
+        BOOST_CHECK_EQUAL(t3.size(), expect.size());
+        BOOST_CHECK(std::equal(expect.begin(), expect.end(), t3.in_order_begin()));
+        BOOST_CHECK_EQUAL(t4.size(), b.size());
+        
+        expect.clear();
+        for(std::size_t i = 0; i < a.size(); ++i)
+            if(!std::binary_search(b.begin(), b.end(), a[i])) expect.push_back(a[i]);
+        rbtree<int> t5(a.begin(), a.end());
+        if(round % 3 == 0) t5.difference_with(t4);
+        else t5.difference_with(t4, grain, pool);
+        BOOST_CHECK(t5.check_invariant());
+        BOOST_CHECK_EQUAL(t5.size(), expect.size());
+        BOOST_CHECK(std::equal(expect.begin(), expect.end(), t5.in_order_begin()));
+        t5.insert(7);
+        BOOST_CHECK(t5.check_invariant());
+    }
+    
+    rbtree<int> t6;
+    for(int i = 0; i < 100; ++i) t6.insert(i);
+    t6.intersect_with(t6);
+    BOOST_CHECK_EQUAL(t6.size(), 100u);
+    t6.difference_with(t6);
+    BOOST_CHECK(t6.empty());
+}
+
+BOOST_AUTO_TEST_CASE( hinted_insert )
+{
+    rbtree<int> t1;
+    auto it = t1.push_back_max(0);
+    BOOST_CHECK_EQUAL(*it, 0);
+    for(int i = 1; i < 3000; ++i){
+        it = (i % 2 == 0) ? t1.insert(t1.in_order_end(), i) : t1.push_back_max(i);
+        BOOST_CHECK_EQUAL(*it, i);
+    }
+    BOOST_CHECK(t1.check_invariant());
+    BOOST_CHECK_EQUAL(t1.size(), 3000u);
+    BOOST_CHECK(std::is_sorted(t1.in_order_begin(), t1.in_order_end()));
+    
+    //---- the rightmost node follows erase
+    t1.erase(std::prev(t1.in_order_end()));
+    t1.erase(t1.find(2997));
+    t1.push_back_max(5000);
+    BOOST_CHECK_EQUAL(*std::prev(t1.in_order_end()), 5000);
+    BOOST_CHECK_EQUAL(*std::prev(t1.in_order_end(), 2), 2998);
+    
+    //---- right and wrong hints
+    boost::mt19937 gen(31);
+    boost::uniform_int<> dist(0, 6000);
+    std::vector<int> v(t1.in_order_begin(), t1.in_order_end());
+    auto hint = t1.in_order_begin();
+    for(int i = 0; i < 2000; ++i){
+        int x = dist(gen);
+        if(i % 3 == 0) hint = t1.lower_bound(x);
+        hint = t1.insert(hint, x);
+        BOOST_CHECK_EQUAL(*hint, x);
+        v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+    }
+    BOOST_CHECK(t1.check_invariant());
+    BOOST_CHECK_EQUAL(t1.size(), v.size());
+    BOOST_CHECK(std::equal(v.begin(), v.end(), t1.in_order_begin()));
+    
+    //---- order statistics stay right
+    typedef rbtree<int, rbtree_default, std::allocator<int>, rbtree_order_statistics> tree_type;
+    tree_type t2;
+    auto jt = t2.in_order_end();
+    for(int i = 0; i < 1000; ++i) jt = t2.insert(t2.in_order_end(), i);
+    for(int i = 1000; i < 2000; ++i) t2.push_back_max(i);
+    BOOST_CHECK_EQUAL(*t2.nth(1500), 1500);
+    BOOST_CHECK_EQUAL(t2.index(jt), 999u);
+}
+
+BOOST_AUTO_TEST_CASE( insert_batch )
+{
+    typedef std::pair<int, int> tagged;
+    typedef std::function<bool(tagged const&, tagged const&)> first_less;
+    first_less less = [](tagged const& _a, tagged const& _b){ return _a.first < _b.first; };
+    boost::mt19937 gen(43);
+    boost::uniform_int<> dist(0, 500);
+    
+    //---- small batches go in from the last one inserted, large
+    //     ones rebuild. equal elements follow those in the tree
+    //     and keep their order in the batch, as with insert.
+    for(int size : { 0, 1, 40, 3000 }){
+        for(int batch : { 0, 1, 7, 300, 5000 }){
+            rbtree<tagged, first_less> t1(less), t2(less);
+            for(int i = 0; i < size; ++i){
+                tagged a(dist(gen), i);
+                t1.insert(a);
+                t2.insert(a);
+            }
+            std::vector<tagged> v;
+            for(int i = 0; i < batch; ++i) v.push_back(tagged(dist(gen), size + i));
+            for(tagged const& a : v) t1.insert(a);
+            t2.insert_batch(v.begin(), v.end());
+            BOOST_CHECK(t2.check_invariant());
+            BOOST_CHECK_EQUAL(t2.size(), t1.size());
+            BOOST_CHECK(std::equal(t1.in_order_begin(), t1.in_order_end(), t2.in_order_begin()));
+        }
+    }
+    
+    //---- node data is kept on both paths
+    typedef rbtree<int, rbtree_default, std::allocator<int>, rbtree_order_statistics> tree_type;
+    std::vector<int> v;
+    tree_type t3;
+    for(int round = 0; round < 4; ++round){
+        std::vector<int> b;
+        for(int i = 0; i < (round % 2 == 0 ? 2000 : 50); ++i) b.push_back(dist(gen));
+        t3.insert_batch(b.begin(), b.end());
+        v.insert(v.end(), b.begin(), b.end());
+        std::sort(v.begin(), v.end());
+        BOOST_CHECK(t3.check_invariant());
+        for(std::size_t i = 0; i < v.size(); i += 37) BOOST_CHECK_EQUAL(*t3.nth(i), v[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( statistics )
+{
+    typedef rbtree<int, rbtree_default, std::allocator<int>, rbtree_no_augment, rbtree_stats> tree_type;
+    tree_type t1;
+    BOOST_CHECK_EQUAL(t1.stats().m_inserts, 0u);
+    BOOST_CHECK(t1.depth_histogram().empty());
+    BOOST_CHECK_EQUAL(t1.black_height(), 0u);
+    
+    //---- an ascending stream rotates at every other insert
+    for(int i = 0; i < 1000; ++i) t1.insert(i);
+    rbtree_statistics s = t1.stats();
+    BOOST_CHECK_EQUAL(s.m_inserts, 1000u);
+    BOOST_CHECK(s.m_rotations > 900 && s.m_rotations <= 2 * s.m_inserts);
+    BOOST_CHECK(s.m_recolours > 0);
+    BOOST_CHECK(s.m_insert_fixup_steps >= s.m_rotations / 2);
+    BOOST_CHECK_EQUAL(s.m_erases, 0u);
+    
+    //---- an erase rotates at most three times
+    boost::mt19937 gen(47);
+    boost::uniform_int<> dist(0, 999);
+    t1.reset_stats();
+    BOOST_CHECK_EQUAL(t1.stats().m_rotations, 0u);
+    for(int i = 0; i < 500; ++i){
+        auto it = t1.find(dist(gen));
+        if(it != t1.in_order_end()) t1.erase(it);
+    }
+    s = t1.stats();
+    BOOST_CHECK_EQUAL(s.m_erases, 1000u - t1.size());
+    BOOST_CHECK(s.m_rotations <= 3 * s.m_erases);
+    BOOST_CHECK(s.m_erase_fixup_steps > 0);
+    BOOST_CHECK(t1.check_invariant());
+    
+    //---- the shape
+    std::vector<std::size_t> h = t1.depth_histogram();
+    BOOST_CHECK_EQUAL(std::accumulate(h.begin(), h.end(), std::size_t(0)), t1.size());
+    BOOST_CHECK_EQUAL(h[0], 1u);
+    for(std::size_t d = 1; d < h.size(); ++d) BOOST_CHECK(h[d] <= 2 * h[d - 1]);
+    BOOST_CHECK(h.size() <= 2 * t1.black_height());
+    
+    //---- a batch counts every element, rebuilt or inserted one by one
+    std::vector<int> batch;
+    for(int i = 0; i < 2000; ++i) batch.push_back(dist(gen));
+    t1.reset_stats();
+    std::size_t n = t1.size();
+    t1.insert_batch(batch.begin(), batch.begin() + 10);
+    BOOST_CHECK_EQUAL(t1.stats().m_inserts, 10u);
+    t1.insert_batch(batch.begin() + 10, batch.end());
+    BOOST_CHECK_EQUAL(t1.stats().m_inserts, 2000u);
+    BOOST_CHECK_EQUAL(t1.size(), n + 2000);
+    t1.assign(batch.begin(), batch.end());
+    BOOST_CHECK_EQUAL(t1.stats().m_inserts, 4000u);
+    BOOST_CHECK(t1.check_invariant());
+    
+    //---- a tree built from sorted input is full but for its last level
+    rbtree<int> t2(t1.in_order_begin(), t1.in_order_end());
+    h = t2.depth_histogram();
+    for(std::size_t d = 0; d + 1 < h.size(); ++d) BOOST_CHECK_EQUAL(h[d], std::size_t(1) << d);
+    BOOST_CHECK_EQUAL(t2.black_height(), h.size() - 1);
+}
+
+BOOST_AUTO_TEST_CASE( stress )
+{
+    typedef rbtree<int, rbtree_default, std::allocator<int>, rbtree_order_statistics> tree_type;
+    boost::mt19937 gen(41);
+    for(int round = 0; round < 20; ++round){
+        boost::uniform_int<> value(0, 10 + round * 100);
+        boost::uniform_int<> action(0, 9);
+        int const grow = 3 + round % 5;
+        tree_type t1;
+        std::multiset<int> s;
+        for(int i = 0; i < 4000; ++i){
+            //---- the tree grows and shrinks in phases
+            bool erase = !s.empty() && action(gen) < ((i / 500) % 2 == 0 ? grow : 10 - grow);
+            if(erase){
+                std::size_t k = std::size_t(value(gen)) % s.size();
+                auto it = t1.nth(k);
+                auto jt = s.begin();
+                std::advance(jt, k);
+                BOOST_REQUIRE_EQUAL(*it, *jt);
+                t1.erase(it);
+                s.erase(jt);
+            }else{
+                int x = value(gen);
+                t1.insert(x);
+                s.insert(x);
+            }
+            if(i % 97 == 0){
+                BOOST_REQUIRE(t1.check_invariant());
+                BOOST_REQUIRE(std::equal(s.begin(), s.end(), t1.in_order_begin()));
+            }
+        }
+        BOOST_CHECK(t1.check_invariant());
+        BOOST_CHECK_EQUAL(t1.size(), s.size());
+        BOOST_CHECK(std::equal(s.begin(), s.end(), t1.in_order_begin()));
+        while(!t1.empty()) t1.erase(t1.nth(t1.size() / 2));
+        BOOST_CHECK(t1.check_invariant());
+    }
+}
+
+//---- remembers the size of the last object type it allocated
+std::size_t allocated_size = 0;
+
+template<typename T>
+struct size_recorder : public std::allocator<T>
+{
+    template<typename U>
+    struct rebind { typedef size_recorder<U> other; };
+    
+    size_recorder() {}
+    template<typename U>
+    size_recorder(size_recorder<U> const&) {}
+    
+    T* allocate(std::size_t _n)
+    {
+        allocated_size = sizeof(T);
+        return std::allocator<T>::allocate(_n);
+    }
+};
+
+BOOST_AUTO_TEST_CASE( node_size )
+{
+    //---- the colour shares the parent pointer
+    rbtree<double, rbtree_default, size_recorder<double>> t1;
+    for(int i = 0; i < 100; ++i) t1.insert(i * 0.5);
+    BOOST_CHECK_EQUAL(allocated_size, 4 * sizeof(void*));
+    BOOST_CHECK(t1.check_invariant());
+    t1.erase(t1.find(10.0));
+    BOOST_CHECK(t1.check_invariant());
+    
+    rbtree<void*, rbtree_default, size_recorder<void*>> t2;
+    t2.insert(&t1);
+    BOOST_CHECK_EQUAL(allocated_size, 4 * sizeof(void*));
+}
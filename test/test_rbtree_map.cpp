@@ -0,0 +1,147 @@
+#define BOOST_TEST_MODULE rbtree_map
+#include <boost/test/included/unit_test.hpp>
+
+#include <map>
+#include <string>
+#include <random>
+#include <functional>
+#include <stdexcept>
+#include <memory>
+
+#include "rbtree_map.h"
+
+using namespace creek;
+
+struct payload
+{
+    int a;
+    double b;
+    payload() : a(), b() {}
+    payload(int _a, double _b) : a(_a), b(_b) {}
+};
+
+//---- orders ids and names of ids by their id
+struct id_less
+{
+    typedef void is_transparent;
+    bool operator()(long _a, long _b) const { return _a < _b; }
+    bool operator()(long _a, std::string const& _b) const { return _a < std::stol(_b); }
+    bool operator()(std::string const& _a, long _b) const { return std::stol(_a) < _b; }
+};
+
+BOOST_AUTO_TEST_CASE( insert_find_erase )
+{
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<long> dist(0, 5000);
+    rbtree_map<long, payload> m1;
+    std::map<long, payload> m2;
+    BOOST_CHECK(m1.empty());
+    BOOST_CHECK(m1.find(3) == m1.end());
+    
+    for(int i = 0; i < 4000; ++i){
+        long k = dist(gen);
+        auto r1 = m1.try_emplace(k, int(k), k * 0.5);
+        auto r2 = m2.insert(std::make_pair(k, payload(int(k), k * 0.5)));
+        BOOST_CHECK_EQUAL(r1.second, r2.second);
+        BOOST_CHECK_EQUAL(r1.first->first, k);
+        if(i % 3 == 0){
+            long e = dist(gen);
+            BOOST_CHECK_EQUAL(m1.erase(e), m2.erase(e));
+        }
+    }
+    BOOST_CHECK_EQUAL(m1.size(), m2.size());
+    auto jt = m2.begin();
+    for(auto it = m1.begin(); it != m1.end(); ++it, ++jt){
+        BOOST_CHECK_EQUAL(it->first, jt->first);
+        BOOST_CHECK_EQUAL(it->second.a, jt->second.a);
+    }
+    for(long k = -1; k < 5002; k += 7){
+        BOOST_CHECK_EQUAL(m1.count(k), m2.count(k));
+        auto lb = m1.lower_bound(k);
+        BOOST_CHECK((lb == m1.end()) == (m2.lower_bound(k) == m2.end()));
+        if(lb != m1.end()) BOOST_CHECK_EQUAL(lb->first, m2.lower_bound(k)->first);
+    }
+    
+    //---- a present key keeps its value
+    long k = m1.begin()->first;
+    BOOST_CHECK(!m1.try_emplace(k, -1, -1.0).second);
+    BOOST_CHECK_EQUAL(m1.at(k).a, int(k));
+    BOOST_CHECK(!m1.insert_or_assign(k, payload(-1, 0)).second);
+    BOOST_CHECK_EQUAL(m1.at(k).a, -1);
+    BOOST_CHECK_THROW(m1.at(-5), std::out_of_range);
+    
+    m1.erase(m1.begin());
+    BOOST_CHECK(m1.find(k) == m1.end());
+    BOOST_CHECK_EQUAL(m1.size(), m2.size() - 1);
+}
+
+BOOST_AUTO_TEST_CASE( subscript )
+{
+    rbtree_map<std::string, int> m1;
+    std::string words[] = {"pine", "oak", "pine", "birch", "oak", "pine"};
+    for(auto const& w : words) ++m1[w];
+    BOOST_CHECK_EQUAL(m1.size(), 3u);
+    BOOST_CHECK_EQUAL(m1["pine"], 3);
+    BOOST_CHECK_EQUAL(m1.begin()->first, "birch");
+    BOOST_CHECK_EQUAL(m1.rbegin()->first, "pine");
+    
+    //---- keys compared with a key_type without conversion
+    BOOST_CHECK(m1.find("oak") != m1.end());
+    rbtree_map<std::string, int> const& c1 = m1;
+    BOOST_CHECK_EQUAL(c1.find("oak")->second, 2);
+    BOOST_CHECK_EQUAL(c1.at("birch"), 1);
+}
+
+//---- counts the copies and moves made of it
+struct counted
+{
+    static int transfers;
+    int v;
+    counted() : v() {}
+    explicit counted(int _v) : v(_v) {}
+    counted(counted const& _a) : v(_a.v) { ++transfers; }
+    counted(counted&& _a) : v(_a.v) { ++transfers; }
+    counted& operator=(counted const& _a) { v = _a.v; ++transfers; return *this; }
+};
+int counted::transfers = 0;
+
+BOOST_AUTO_TEST_CASE( in_place )
+{
+    //---- the mapped value is built once, in the node
+    rbtree_map<int, counted> m1;
+    counted::transfers = 0;
+    for(int i = 0; i < 50; ++i) m1.try_emplace((i * 7) % 50, i);
+    BOOST_CHECK_EQUAL(counted::transfers, 0);
+    BOOST_CHECK_EQUAL(m1.at(7).v, 1);
+    
+    //---- a move-only mapped type
+    rbtree_map<int, std::unique_ptr<int>> m2;
+    for(int i = 0; i < 20; ++i) BOOST_CHECK(m2.try_emplace(i, new int(i)).second);
+    BOOST_CHECK(m2.insert_or_assign(20, std::unique_ptr<int>(new int(20))).second);
+    BOOST_CHECK(!m2.insert_or_assign(5, std::unique_ptr<int>(new int(-5))).second);
+    m2[21].reset(new int(21));
+    BOOST_CHECK_EQUAL(m2.size(), 22u);
+    BOOST_CHECK_EQUAL(*m2.at(5), -5);
+    int k = 0;
+    for(auto it = m2.begin(); it != m2.end(); ++it, ++k){
+        BOOST_CHECK_EQUAL(it->first, k);
+        if(k != 5) BOOST_CHECK_EQUAL(*it->second, k);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( comparators )
+{
+    rbtree_map<int, int, std::greater<int>> m1;
+    for(int i = 0; i < 100; ++i) m1[i] = i * i;
+    BOOST_CHECK_EQUAL(m1.begin()->first, 99);
+    BOOST_CHECK_EQUAL(m1.lower_bound(50)->first, 50);
+    BOOST_CHECK_EQUAL(m1.upper_bound(50)->first, 49);
+    BOOST_CHECK(m1.key_comp()(2, 1));
+    
+    rbtree_map<long, int, id_less> m2;
+    for(long i = 0; i < 50; ++i) m2[i * 10] = int(i);
+    BOOST_CHECK_EQUAL(m2.find(std::string("120"))->second, 12);
+    BOOST_CHECK(m2.find(std::string("125")) == m2.end());
+    BOOST_CHECK_EQUAL(m2.erase(std::string("490")), 1u);
+    BOOST_CHECK_EQUAL(m2.size(), 49u);
+}
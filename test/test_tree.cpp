@@ -2,6 +2,7 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include "tree.h"
+#include "arena_allocator.h"
 #include <string>
 #include <fstream>
 #include <iostream>
@@ -726,3 +727,248 @@ BOOST_AUTO_TEST_CASE( get_sub_tree )
     std::cout << "12" << std::endl;
     
 }
+
+BOOST_AUTO_TEST_CASE( sibling_links )
+{
+    tree<std::string> t1;
+    tree<std::string>::pre_order_iterator ite1 = t1.pre_order_begin();
+    tree<std::string>::pre_order_iterator a, b, c, d, e, f;
+    f = t1.insert(ite1, "F");
+    a = t1.append_child(f, "A");
+    b = t1.append_child(f, "B");
+    c = t1.append_child(f, "C");
+    d = t1.append_child(b, "D");
+    e = t1.append_child(b, "E");
+    
+    t1.erase(b);
+    BOOST_CHECK_EQUAL( t1.size(), 3 );
+    tree<std::string>::child_order_iterator ch = child_order_begin(f);
+    BOOST_CHECK_EQUAL( *ch, "A" );
+    ++ch;
+    BOOST_CHECK_EQUAL( *ch, "C" );
+    ++ch;
+    BOOST_CHECK( ch == child_order_end(f) );
+    --ch;
+    BOOST_CHECK_EQUAL( *ch, "C" );
+    
+    t1.erase(c);
+    BOOST_CHECK( --child_order_end(f) == child_order_begin(f) );
+    t1.erase(a);
+    BOOST_CHECK( child_order_begin(f) == child_order_end(f) );
+    BOOST_CHECK( t1.post_order_begin().base() == t1.pre_order_begin().base() );
+    
+    a = t1.append_child(f, "A");
+    c = t1.append_child(f, "C");
+    b = t1.insert_child(f, c, "B");
+    t1.insert(a, "X");
+    
+    //FXABC
+    std::string const expected[] = {"F", "X", "A", "B", "C"};
+    BOOST_CHECK( std::equal(t1.pre_order_begin(), t1.pre_order_end(), expected) );
+    std::string const rexpected[] = {"C", "B", "X"};
+    BOOST_CHECK( std::equal(child_order_rbegin(f), child_order_rend(f), rexpected) );
+    
+    tree<std::string> t2;
+    t2.swap(t1);
+    BOOST_CHECK( t1.empty() );
+    BOOST_CHECK( t1.pre_order_begin() == t1.pre_order_end() );
+    BOOST_CHECK( std::equal(t2.pre_order_begin(), t2.pre_order_end(), expected) );
+    BOOST_CHECK_EQUAL( std::distance(t2.post_order_begin(), t2.post_order_end()), 5 );
+}
+
+struct Token
+{
+    static int copy_count;
+    
+    std::string m_text;
+    int m_line;
+    
+    Token()
+        : m_text(), m_line()
+    {}
+    Token(std::string const& _text, int _line)
+        : m_text(_text), m_line(_line)
+    {}
+    Token(Token const& _other)
+        : m_text(_other.m_text), m_line(_other.m_line)
+    {++copy_count;}
+    Token(Token&& _other)
+        : m_text(std::move(_other.m_text)), m_line(_other.m_line)
+    {}
+};
+int Token::copy_count = 0;
+
+BOOST_AUTO_TEST_CASE( move_and_emplace )
+{
+    BOOST_CHECK( std::is_nothrow_move_constructible<tree<std::string>>::value );
+    BOOST_CHECK( std::is_nothrow_move_assignable<tree<std::string>>::value );
+    
+    tree<Token> t1;
+    tree<Token>::pre_order_iterator a, b, c, d;
+    a = t1.emplace_insert(t1.pre_order_begin(), "+", 1);
+    b = t1.emplace_child(a, "1", 1);
+    d = t1.append_child(a, Token("3", 2));
+    c = t1.insert_child(a, d, Token("2", 2));
+    a = t1.insert(a, Token("-", 0));
+    BOOST_CHECK_EQUAL( Token::copy_count, 0 );
+    BOOST_CHECK_EQUAL( t1.size(), 5 );
+    
+    tree<Token> t2(std::move(t1));
+    BOOST_CHECK( t1.empty() );
+    BOOST_CHECK( t1.pre_order_begin() == t1.pre_order_end() );
+    BOOST_CHECK_EQUAL( t2.size(), 5 );
+    BOOST_CHECK( t2.pre_order_begin() == a );
+    BOOST_CHECK_EQUAL( std::distance(t2.pre_order_begin(), t2.pre_order_end()), 5 );
+    BOOST_CHECK_EQUAL( std::distance(t2.post_order_begin(), t2.post_order_end()), 5 );
+    BOOST_CHECK_EQUAL( (--t2.pre_order_end())->m_text, "3" );
+    
+    tree<Token> t3;
+    t3.emplace_insert(t3.pre_order_begin(), "x", 3);
+    t3 = std::move(t2);
+    BOOST_CHECK( t2.empty() );
+    BOOST_CHECK_EQUAL( t3.size(), 5 );
+    BOOST_CHECK_EQUAL( t3.pre_order_begin()->m_text, "-" );
+    BOOST_CHECK_EQUAL( (--t3.post_order_end())->m_text, "-" );
+    BOOST_CHECK_EQUAL( Token::copy_count, 0 );
+    
+    t3 = tree<Token>();
+    BOOST_CHECK( t3.empty() );
+    t1 = std::move(t3);
+    BOOST_CHECK( t1.empty() );
+    t1.emplace_insert(t1.pre_order_begin(), "y", 4);
+    BOOST_CHECK_EQUAL( t1.size(), 1 );
+    
+    tree<Token> t4(t1.get_subtree(t1.pre_order_begin()));
+    BOOST_CHECK_EQUAL( Token::copy_count, 1 );
+    BOOST_CHECK_EQUAL( t4.pre_order_begin()->m_text, "y" );
+}
+
+BOOST_AUTO_TEST_CASE( splice_and_move_subtree )
+{
+    typedef tree<std::string>::pre_order_iterator iterator;
+    tree<std::string> t1, t2;
+    iterator a, b, c, d, e, x, y, z;
+    a = t1.insert(t1.pre_order_begin(), "A");
+    b = t1.append_child(a, "B");
+    c = t1.append_child(a, "C");
+    d = t1.append_child(b, "D");
+    e = t1.append_child(b, "E");
+    
+    x = t2.insert(t2.pre_order_begin(), "X");
+    y = t2.append_child(x, "Y");
+    z = t2.append_child(y, "Z");
+    
+    //---- within one tree
+    iterator m = t1.move_subtree(b, c);
+    BOOST_CHECK( m == b );
+    std::string const expected1[] = {"A", "C", "B", "D", "E"};
+    BOOST_CHECK( std::equal(t1.pre_order_begin(), t1.pre_order_end(), expected1) );
+    BOOST_CHECK_EQUAL( t1.size(), 5 );
+    
+    t1.splice_child(a, child_order_begin(a), t1, e);
+    std::string const expected2[] = {"A", "E", "C", "B", "D"};
+    BOOST_CHECK( std::equal(t1.pre_order_begin(), t1.pre_order_end(), expected2) );
+    std::string const rexpected2[] = {"A", "C", "B", "D", "E"};
+    BOOST_CHECK( std::equal(t1.post_order_rbegin(), t1.post_order_rend(), rexpected2) );
+    
+    //---- between trees
+    t1.splice_child(c, child_order_begin(c), t2, y);
+    std::string const expected3[] = {"A", "E", "C", "Y", "Z", "B", "D"};
+    BOOST_CHECK( std::equal(t1.pre_order_begin(), t1.pre_order_end(), expected3) );
+    BOOST_CHECK_EQUAL( t1.size(), 7 );
+    BOOST_CHECK_EQUAL( t2.size(), 1 );
+    BOOST_CHECK( !t2.empty() );
+    BOOST_CHECK( child_order_begin(x) == child_order_end(x) );
+    
+    t2.splice_child(x, child_order_end(x), t1, e);
+    BOOST_CHECK_EQUAL( t1.size(), 6 );
+    BOOST_CHECK_EQUAL( t2.size(), 2 );
+    
+    t2.splice_child(x, child_order_begin(x), t1, a);
+    BOOST_CHECK( t1.empty() );
+    BOOST_CHECK_EQUAL( t1.size(), 0 );
+    BOOST_CHECK( t1.pre_order_begin() == t1.pre_order_end() );
+    std::string const expected4[] = {"X", "A", "C", "Y", "Z", "B", "D", "E"};
+    BOOST_CHECK( std::equal(t2.pre_order_begin(), t2.pre_order_end(), expected4) );
+    BOOST_CHECK_EQUAL( t2.size(), 8 );
+    BOOST_CHECK_EQUAL( std::distance(t2.post_order_begin(), t2.post_order_end()), 8 );
+    
+    //---- rvalue subtrees
+    tree<std::string> t3;
+    t3.append_child(t3.insert(t3.pre_order_begin(), "P"), "Q");
+    t2.append_child_tree(x, std::move(t3));
+    BOOST_CHECK( t3.empty() );
+    BOOST_CHECK_EQUAL( t2.size(), 10 );
+    
+    tree<std::string> t4;
+    t4.insert(t4.pre_order_begin(), "R");
+    iterator r = t2.insert_child_tree(x, child_order_begin(x), std::move(t4));
+    BOOST_CHECK_EQUAL( *r, "R" );
+    std::string const expected5[] = {"X", "R", "A", "C", "Y", "Z", "B", "D", "E", "P", "Q"};
+    BOOST_CHECK( std::equal(t2.pre_order_begin(), t2.pre_order_end(), expected5) );
+    BOOST_CHECK_EQUAL( t2.size(), 11 );
+    
+    t2.erase(a);
+    BOOST_CHECK_EQUAL( t2.size(), 5 );
+}
+
+BOOST_AUTO_TEST_CASE( splice_with_unequal_allocators )
+{
+    typedef tree<int, arena_allocator<int>> tree_type;
+    tree_type t1, t2;
+    tree_type::pre_order_iterator a = t1.insert(t1.pre_order_begin(), 1);
+    t1.append_child(t1.append_child(a, 2), 3);
+    tree_type::pre_order_iterator b = t2.insert(t2.pre_order_begin(), 10);
+    
+    tree_type::pre_order_iterator c = t2.splice_child(b, child_order_end(b), t1, child_order_begin(a));
+    BOOST_CHECK_EQUAL( *c, 2 );
+    BOOST_CHECK_EQUAL( t1.size(), 1 );
+    int const expected[] = {10, 2, 3};
+    BOOST_CHECK( std::equal(t2.pre_order_begin(), t2.pre_order_end(), expected) );
+    BOOST_CHECK_EQUAL( t2.size(), 3 );
+}
+
+BOOST_AUTO_TEST_CASE( level_order )
+{
+    typedef tree<std::string>::pre_order_iterator iterator;
+    tree<std::string> t1;
+    BOOST_CHECK( t1.level_order_begin() == t1.level_order_end() );
+    BOOST_CHECK( t1.level_range(0).first == t1.level_range(0).second );
+    
+    iterator f = t1.insert(t1.pre_order_begin(), "F");
+    iterator b = t1.append_child(f, "B");
+    iterator g = t1.append_child(f, "G");
+    t1.append_child(b, "A");
+    iterator d = t1.append_child(b, "D");
+    t1.append_child(d, "C");
+    t1.append_child(d, "E");
+    iterator i = t1.append_child(g, "I");
+    t1.append_child(i, "H");
+    
+    std::string const expected[] = {"F", "B", "G", "A", "D", "I", "C", "E", "H"};
+    BOOST_CHECK( std::equal(t1.level_order_begin(), t1.level_order_end(), expected) );
+    BOOST_CHECK_EQUAL( std::distance(t1.level_order_begin(), t1.level_order_end()), 9 );
+    
+    tree<std::string> const& ct = t1;
+    BOOST_CHECK( std::equal(ct.level_order_begin(), ct.level_order_end(), expected) );
+    
+    //---- levels
+    std::size_t const first[] = {0, 1, 3, 6, 9};
+    for(std::size_t k = 0; k < 4; ++k){
+        auto r = t1.level_range(k);
+        BOOST_CHECK_EQUAL( std::distance(r.first, r.second), first[k + 1] - first[k] );
+        BOOST_CHECK( std::equal(r.first, r.second, expected + first[k]) );
+    }
+    BOOST_CHECK( t1.level_range(4).first == t1.level_range(4).second );
+    
+    //---- a copy goes on where it was, whatever the other does
+    tree<std::string>::level_order_iterator it = t1.level_order_begin();
+    ++it; ++it;
+    tree<std::string>::level_order_iterator jt = it;
+    while(it != t1.level_order_end()) ++it;
+    BOOST_CHECK( std::equal(jt, t1.level_order_end(), expected + 2) );
+    
+    *t1.level_range(1).first = "b";
+    BOOST_CHECK_EQUAL( *b, "b" );
+    BOOST_CHECK( t1.level_range(2).first.base() == child_order_begin(b).base() );
+}
@@ -0,0 +1,212 @@
+#define BOOST_TEST_MODULE visitor
+#include <boost/test/included/unit_test.hpp>
+
+#include "tree.h"
+#include "nary_tree.h"
+#include "frozen_tree.h"
+#include "rbtree.h"
+#include "kdtree.h"
+#include "visitor.h"
+#include <random>
+#include <map>
+#include <vector>
+#include <array>
+#include <algorithm>
+
+using namespace creek;
+
+typedef tree<int>::pre_order_iterator iterator;
+
+struct collect
+{
+    std::vector<int>* m_out;
+    void operator()(int const& _v) const
+    { m_out->push_back(_v); }
+};
+
+//---- skips the children of multiples of _n, stops at _last
+struct prune
+{
+    std::vector<int>* m_out;
+    int m_n;
+    int m_last;
+    visit_result operator()(int const& _v) const
+    {
+        m_out->push_back(_v);
+        if(_v == m_last) return visit_result::stop;
+        if(_v % m_n == 0) return visit_result::skip_children;
+        return visit_result::proceed;
+    }
+};
+
+template<typename Iterator>
+std::vector<int> to_vector(Iterator _first, Iterator _last)
+{
+    return std::vector<int>(_first, _last);
+}
+
+//---- expected pruned pre order, from the parent of every value
+std::vector<int> pruned(std::vector<int> const& _pre, std::map<int, int> const& _parent, int _n, int _last)
+{
+    std::vector<int> r;
+    for(std::size_t i = 0; i < _pre.size(); ++i){
+        bool skip = false;
+        auto p = _parent.find(_pre[i]);
+        while(p != _parent.end()){
+            skip = skip || (p->second % _n == 0);
+            p = _parent.find(p->second);
+        }
+        if(skip) continue;
+        r.push_back(_pre[i]);
+        if(_pre[i] == _last) break;
+    }
+    return r;
+}
+
+BOOST_AUTO_TEST_CASE( visit_tree )
+{
+    std::mt19937 gen(11);
+    tree<int> t1;
+    std::vector<iterator> nodes;
+    std::map<int, int> parent;
+    nodes.push_back(t1.insert(t1.pre_order_begin(), 1));
+    for(int i = 2; i < 3000; ++i){
+        std::uniform_int_distribution<std::size_t> pick(0, nodes.size() - 1);
+        std::size_t p = pick(gen);
+        nodes.push_back(t1.append_child(nodes[p], i));
+        parent[i] = *nodes[p];
+    }
+    
+    std::vector<int> pre = to_vector(t1.pre_order_begin(), t1.pre_order_end());
+    std::vector<int> post = to_vector(t1.post_order_begin(), t1.post_order_end());
+    std::vector<int> v;
+    collect c = {&v};
+    BOOST_CHECK( visit_pre_order(t1, c) );
+    BOOST_CHECK( v == pre );
+    v.clear();
+    BOOST_CHECK( visit_post_order(t1, c) );
+    BOOST_CHECK( v == post );
+    
+    //---- pruning
+    v.clear();
+    prune p1 = {&v, 7, -1};
+    BOOST_CHECK( visit_pre_order(t1, p1) );
+    BOOST_CHECK( v == pruned(pre, parent, 7, -1) );
+    int last = v[v.size() / 2];
+    v.clear();
+    prune p2 = {&v, 7, last};
+    BOOST_CHECK( !visit_pre_order(t1, p2) );
+    BOOST_CHECK( v == pruned(pre, parent, 7, last) );
+    
+    //---- skip_children does nothing in post order, stop does
+    v.clear();
+    prune p3 = {&v, 7, post[100]};
+    BOOST_CHECK( !visit_post_order(t1, p3) );
+    BOOST_CHECK( v == std::vector<int>(post.begin(), post.begin() + 101) );
+    
+    //---- skipping the root
+    v.clear();
+    prune p4 = {&v, 1, -1};
+    BOOST_CHECK( visit_pre_order(t1, p4) );
+    BOOST_CHECK_EQUAL( v.size(), 1u );
+    
+    //---- the visitor may change the values
+    visit_pre_order(t1, [](int& _v){ _v = -_v; });
+    BOOST_CHECK_EQUAL( *t1.pre_order_begin(), -1 );
+    
+    tree<int> const& ct = t1;
+    v.clear();
+    BOOST_CHECK( visit_post_order(ct, c) );
+    BOOST_CHECK_EQUAL( v.size(), post.size() );
+    
+    tree<int> empty;
+    BOOST_CHECK( visit_pre_order(empty, c) );
+    BOOST_CHECK( visit_post_order(empty, c) );
+}
+
+BOOST_AUTO_TEST_CASE( visit_frozen_and_nary )
+{
+    tree<int> t1;
+    iterator root = t1.insert(t1.pre_order_begin(), 0);
+    int k = 1;
+    for(int i = 0; i < 5; ++i){
+        iterator a = t1.append_child(root, k++);
+        for(int j = 0; j < i; ++j) t1.append_child(a, k++);
+    }
+    
+    frozen_tree<int> f1 = t1.freeze();
+    std::vector<int> v;
+    collect c = {&v};
+    BOOST_CHECK( visit_pre_order(f1, c) );
+    BOOST_CHECK( v == to_vector(t1.pre_order_begin(), t1.pre_order_end()) );
+    v.clear();
+    BOOST_CHECK( visit_post_order(f1, c) );
+    BOOST_CHECK( v == to_vector(t1.post_order_begin(), t1.post_order_end()) );
+    
+    nary_tree<3, int> n1(4, 1);
+    std::size_t count = 0;
+    BOOST_CHECK( visit_pre_order(n1, [&count](int&){ ++count; }) );
+    BOOST_CHECK_EQUAL( count, n1.size() );
+    count = 0;
+    BOOST_CHECK( visit_post_order(n1, [&count](int&){ ++count; }) );
+    BOOST_CHECK_EQUAL( count, n1.size() );
+    count = 0;
+    visit_pre_order(n1, [&count](int&){ ++count; return visit_result::skip_children; });
+    BOOST_CHECK_EQUAL( count, 1u );
+}
+
+BOOST_AUTO_TEST_CASE( visit_binary )
+{
+    std::mt19937 gen(5);
+    std::vector<int> values;
+    for(int i = 0; i < 2000; ++i) values.push_back(i);
+    std::shuffle(values.begin(), values.end(), gen);
+    rbtree<int> t1;
+    for(std::size_t i = 0; i < values.size(); ++i) t1.insert(values[i]);
+    
+    std::vector<int> pre = to_vector(t1.pre_order_begin(), t1.pre_order_end());
+    std::vector<int> post = to_vector(t1.post_order_begin(), t1.post_order_end());
+    std::map<int, int> parent;
+    auto const none = rbtree<int>::const_pre_order_iterator();
+    for(auto it = t1.pre_order_begin(); it != t1.pre_order_end(); ++it){
+        if(left_child(it) != none) parent[*left_child(it)] = *it;
+        if(right_child(it) != none) parent[*right_child(it)] = *it;
+    }
+    
+    std::vector<int> v;
+    collect c = {&v};
+    BOOST_CHECK( visit_pre_order(t1, c) );
+    BOOST_CHECK( v == pre );
+    v.clear();
+    BOOST_CHECK( visit_post_order(t1, c) );
+    BOOST_CHECK( v == post );
+    
+    v.clear();
+    prune p1 = {&v, 5, -1};
+    BOOST_CHECK( visit_pre_order(t1, p1) );
+    BOOST_CHECK( v == pruned(pre, parent, 5, -1) );
+    int last = v[v.size() / 3];
+    v.clear();
+    prune p2 = {&v, 5, last};
+    BOOST_CHECK( !visit_pre_order(t1, p2) );
+    BOOST_CHECK( v == pruned(pre, parent, 5, last) );
+    
+    rbtree<int> const& ct = t1;
+    v.clear();
+    prune p3 = {&v, 5, post[10]};
+    BOOST_CHECK( !visit_post_order(ct, p3) );
+    BOOST_CHECK( v == std::vector<int>(post.begin(), post.begin() + 11) );
+    
+    rbtree<int> empty;
+    BOOST_CHECK( visit_pre_order(empty, c) );
+    BOOST_CHECK( visit_post_order(empty, c) );
+    
+    typedef std::array<double, 1> point;
+    std::vector<point> points;
+    for(int i = 0; i < 100; ++i) points.push_back(point{{double(i)}});
+    kdtree<point, 1> k1(points.begin(), points.end());
+    std::vector<point> kpre(k1.pre_order_begin(), k1.pre_order_end());
+    std::vector<point> kv;
+    visit_pre_order(k1, [&kv](point const& _v){ kv.push_back(_v); });
+    BOOST_CHECK( kv == kpre );
+}
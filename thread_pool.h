@@ -0,0 +1,241 @@
+//-----------------------------------------------------------
+//    thread_pool.h
+//-----------------------------------------------------------
+#ifndef CREEK_THREAD_POOL_H
+#define CREEK_THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+namespace creek
+{
+    namespace parallel
+    {
+        //-----------------------------------------------------------
+        //    class thread_pool
+        //    every worker owns a deque. the owner pushes and pops at
+        //    the back, idle workers steal from the front of the others.
+        //    threads that are not workers of the pool share one extra
+        //    deque.
+        //-----------------------------------------------------------
+        class thread_pool
+        {
+        private:
+            typedef std::function<void()> task;
+            
+            struct worker_queue
+            {
+                std::mutex m_mutex;
+                std::deque<task> m_tasks;
+            };
+            
+            std::vector<std::unique_ptr<worker_queue>> m_queues;
+            std::vector<std::thread> m_threads;
+            std::atomic<std::size_t> m_queued;
+            std::mutex m_sleep_mutex;
+            std::condition_variable m_wake;
+            bool m_stop;
+            
+            friend class task_group;
+            
+        public:
+            explicit thread_pool(std::size_t _threads = default_concurrency())
+                : m_queues(), m_threads(), m_queued(0),
+                m_sleep_mutex(), m_wake(), m_stop(false)
+            {
+                _threads = std::max<std::size_t>(_threads, 1);
+                for(std::size_t i = 0; i < _threads + 1; ++i)
+                    m_queues.push_back(std::unique_ptr<worker_queue>(new worker_queue()));
+                for(std::size_t i = 0; i < _threads; ++i)
+                    m_threads.push_back(std::thread(&thread_pool::worker_loop, this, i));
+            }
+            
+            thread_pool(thread_pool const&) = delete;
+            thread_pool& operator=(thread_pool const&) = delete;
+            
+            ~thread_pool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_sleep_mutex);
+                    m_stop = true;
+                }
+                m_wake.notify_all();
+                for(std::size_t i = 0; i < m_threads.size(); ++i)
+                    m_threads[i].join();
+            }
+            
+            //---- size
+            //     number of worker threads. a thread waiting on a
+            //     task_group helps, so up to size() + 1 threads run tasks.
+            std::size_t size() const
+            { return m_threads.size(); }
+            
+            //---- fork
+            //     runs _f1 as a task and _f2 on the calling thread,
+            //     returns once both are done.
+            template<typename F1, typename F2>
+            void fork(F1 _f1, F2 _f2);
+            
+            static std::size_t default_concurrency()
+            {
+                std::size_t const n = std::thread::hardware_concurrency();
+                return (n > 1) ? n - 1 : 1;
+            }
+            
+        private:
+            static thread_pool const*& current_pool()
+            {
+                static thread_local thread_pool const* pool = 0;
+                return pool;
+            }
+            
+            static std::size_t& current_index()
+            {
+                static thread_local std::size_t index = 0;
+                return index;
+            }
+            
+            std::size_t own_queue() const
+            { return (current_pool() == this) ? current_index() : m_threads.size(); }
+            
+            void push(task&& _task)
+            {
+                worker_queue& q = *m_queues[own_queue()];
+                {
+                    std::lock_guard<std::mutex> lock(q.m_mutex);
+                    q.m_tasks.push_back(std::move(_task));
+                }
+                ++m_queued;
+                {
+                    std::lock_guard<std::mutex> lock(m_sleep_mutex);
+                }
+                m_wake.notify_one();
+            }
+            
+            //---- try run one
+            //     newest own task first, then the oldest task of another queue.
+            bool try_run_one()
+            {
+                task t;
+                std::size_t const self = own_queue();
+                {
+                    worker_queue& q = *m_queues[self];
+                    std::lock_guard<std::mutex> lock(q.m_mutex);
+                    if(!q.m_tasks.empty()){
+                        t = std::move(q.m_tasks.back());
+                        q.m_tasks.pop_back();
+                    }
+                }
+                for(std::size_t i = 1; !t && i < m_queues.size(); ++i){
+                    worker_queue& q = *m_queues[(self + i) % m_queues.size()];
+                    std::lock_guard<std::mutex> lock(q.m_mutex);
+                    if(!q.m_tasks.empty()){
+                        t = std::move(q.m_tasks.front());
+                        q.m_tasks.pop_front();
+                    }
+                }
+                if(!t) return false;
+                --m_queued;
+                t();
+                return true;
+            }
+            
+            void worker_loop(std::size_t _index)
+            {
+                current_pool() = this;
+                current_index() = _index;
+                while(1){
+                    if(try_run_one()) continue;
+                    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+                    m_wake.wait(lock, [this]{ return m_stop || m_queued > 0; });
+                    if(m_stop) return;
+                }
+            }
+        };
+        
+        //---- default pool
+        inline thread_pool& default_pool()
+        {
+            static thread_pool pool;
+            return pool;
+        }
+        
+        //-----------------------------------------------------------
+        //    class task_group
+        //    tasks run on the pool; wait() helps executing tasks until
+        //    all tasks of the group are done, then rethrows the first
+        //    exception a task threw.
+        //-----------------------------------------------------------
+        class task_group
+        {
+        private:
+            thread_pool& m_pool;
+            std::atomic<std::size_t> m_pending;
+            std::mutex m_error_mutex;
+            std::exception_ptr m_error;
+            
+        public:
+            explicit task_group(thread_pool& _pool = default_pool())
+                : m_pool(_pool), m_pending(0), m_error_mutex(), m_error()
+            {}
+            
+            task_group(task_group const&) = delete;
+            task_group& operator=(task_group const&) = delete;
+            
+            ~task_group()
+            {
+                while(m_pending > 0){
+                    if(!m_pool.try_run_one()) std::this_thread::yield();
+                }
+            }
+            
+            template<typename Function>
+            void run(Function _f)
+            {
+                ++m_pending;
+                m_pool.push([this, _f](){
+                    try{
+                        _f();
+                    }
+                    catch(...){
+                        std::lock_guard<std::mutex> lock(m_error_mutex);
+                        if(!m_error) m_error = std::current_exception();
+                    }
+                    --m_pending;
+                });
+            }
+            
+            void wait()
+            {
+                while(m_pending > 0){
+                    if(!m_pool.try_run_one()) std::this_thread::yield();
+                }
+                if(m_error){
+                    std::exception_ptr e = m_error;
+                    m_error = std::exception_ptr();
+                    std::rethrow_exception(e);
+                }
+            }
+        };
+        
+        template<typename F1, typename F2>
+        void thread_pool::fork(F1 _f1, F2 _f2)
+        {
+            task_group group(*this);
+            group.run(_f1);
+            _f2();
+            group.wait();
+        }
+    }//---- namespace parallel
+}//---- namespace creek
+
+#endif
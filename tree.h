@@ -5,13 +5,16 @@
 #define CREEK_TREE_H
 
 #include <iterator>
-#include <list>
 #include <algorithm>
 #include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <atomic>
 #include <assert.h>
 
 #include "fwd.h"
 #include "iterator.h"
+#include "frozen_tree.h"
 
 namespace creek
 {
@@ -30,131 +33,207 @@ namespace creek
         typedef unsigned int size_type;
         typedef value_type* pointer;
         typedef value_type const* const_pointer;
-    
+        
     private:
+        //---- first child / next sibling layout
+        //     the links live in the node itself, so a node costs a single
+        //     allocation and every traversal step is one pointer hop.
         struct node
         {
-            typedef typename Allocator::template rebind<node*>::other allocator_type;
-            typedef std::list<node*> list_type;
-            typedef typename list_type::iterator sub_iterator;
             Tp m_value;
-            sub_iterator m_parent;
-            sub_iterator m_older_sibling;
-            sub_iterator m_younger_sibling;
-            list_type m_children;
+            node* m_parent;
+            node* m_first_child;
+            node* m_last_child;
+            node* m_older_sibling;
+            node* m_younger_sibling;
+            
+            template<typename... Args>
+            explicit node(Args&&... _args)
+                : m_value(std::forward<Args>(_args)...),
+                m_parent(), m_first_child(), m_last_child(),
+                m_older_sibling(), m_younger_sibling()
+            {}
         };
         
         typedef node* node_pointer;
         typedef typename Allocator::template rebind<node>::other node_allocator;
-        typedef typename node::list_type list_type;
-        typedef typename node::sub_iterator sub_iterator;
+        typedef node_pointer sub_iterator;
+        
+        //---- position in a child list
+        //     the parent is kept so that the end of the list
+        //     can be decremented back to the last child.
+        struct child_position
+        {
+            node_pointer m_parent;
+            node_pointer m_node;
+            
+            child_position()
+                : m_parent(), m_node()
+            {}
+            
+            child_position(node_pointer _node)
+                : m_parent((_node != 0) ? _node->m_parent : 0), m_node(_node)
+            {}
+            
+            child_position(node_pointer _parent, node_pointer _node)
+                : m_parent(_parent), m_node(_node)
+            {}
+            
+            operator node_pointer() const
+            { return m_node; }
+            
+            bool operator==(child_position const& _other) const
+            { return (m_node == _other.m_node) && (m_parent == _other.m_parent); }
+            
+            bool operator!=(child_position const& _other) const
+            { return !(*this == _other); }
+        };
+        
         friend class multiway_tree_traits<tree<value_type, allocator_type>>;
         friend class tree_iterator_traits<tree_iterator<true, child_order_tag, self_type>>;
         friend class tree_iterator_traits<tree_iterator<false, child_order_tag, self_type>>;
         
-        list_type m_root_list;
-        sub_iterator m_root;
-        sub_iterator m_foot;
+        node_pointer m_root;
+        node_pointer m_foot;
         node m_foot_obj;
-        size_type m_size;
+        //---- the count, or unknown_size after a splice between trees.
+        //     atomic so that size() may fill it in on a const tree
+        //     read from several threads.
+        mutable std::atomic<size_type> m_size;
         node_allocator m_alloc;
         
     public:
         tree()
-            : m_root_list(), m_root(m_root_list.begin()),
-            m_foot(m_root), m_foot_obj(), m_size(), m_alloc()
+            : m_root(&m_foot_obj), m_foot(&m_foot_obj),
+            m_foot_obj(), m_size(0), m_alloc()
+        {}
+        
+        explicit tree(allocator_type const& _alloc)
+            : m_root(&m_foot_obj), m_foot(&m_foot_obj),
+            m_foot_obj(), m_size(0), m_alloc(_alloc)
         {}
         
         tree(tree const& _other)
-            : m_root_list(), m_root(m_root_list.begin()),
-                m_foot(m_root), m_foot_obj(), m_size(), m_alloc()
+            : m_root(&m_foot_obj), m_foot(&m_foot_obj),
+                m_foot_obj(), m_size(0), m_alloc()
         {
             (*this) = _other;
         }
         
+        //---- move constructor
+        //     takes over the nodes; only the foot sentinel,
+        //     which lives inside the tree object, is relinked.
+        //     the moved-from tree keeps a copy of the allocator; an
+        //     arena shared this way is only released by clear() once
+        //     a single tree is left on it.
+        tree(tree&& _other) noexcept
+            : m_root(_other.m_root), m_foot(&m_foot_obj),
+                m_foot_obj(), m_size(_other.stored_size()), m_alloc(_other.m_alloc)
+        {
+            relink_foot(_other);
+            _other.m_root = _other.m_foot;
+            _other.m_foot_obj.m_older_sibling = 0;
+            _other.store_size(0);
+        }
+        
         ~tree()
         { clear(); }
         
         //---- size
+        //     O(1), except for the first call after a splice of a
+        //     subtree between two trees, which recounts in O(n).
+        //     concurrent calls on a const tree are safe, each
+        //     recount stores the same value.
         size_type size() const
-        { return m_size; }
+        {
+            size_type n = stored_size();
+            if(n == unknown_size){
+                n = static_cast<size_type>(std::distance(pre_order_begin(), pre_order_end()));
+                store_size(n);
+            }
+            return n;
+        }
         
         //---- empty
         bool empty() const
-        { return (m_size == 0); }
+        { return (m_root == m_foot); }
         
         //---- insert
         template<typename Iterator>
         Iterator insert(Iterator _pos, const value_type& _val)
+        { return emplace_insert(_pos, _val); }
+        
+        template<typename Iterator>
+        Iterator insert(Iterator _pos, value_type&& _val)
+        { return emplace_insert(_pos, std::move(_val)); }
+        
+        //---- emplace insert
+        //     constructs the new parent of _pos in place.
+        template<typename Iterator, typename... Args>
+        Iterator emplace_insert(Iterator _pos, Args&&... _args)
         {
-            sub_iterator node1 = _pos.base();
-            assert(node1 != sub_iterator());
+            node_pointer node1 = _pos.base();
+            assert(node1 != 0);
             assert(!((node1 == m_foot) && m_root != m_foot));
             
-            if(m_size == 0){
-                node* root_tmp = create_node(_val);
-                m_root_list.push_back(root_tmp);
-                m_root_list.push_back(&m_foot_obj);
-                m_root = m_root_list.begin();
-                m_foot = (++(m_root_list.begin()));
-                (*m_root)->m_younger_sibling = m_foot;
-                m_foot_obj.m_older_sibling = m_root;
+            if(empty()){
+                link_root(create_node(std::forward<Args>(_args)...));
                 return Iterator(m_root);
             }else{
-                list_type&
-                    list1 = (node1 == m_root)
-                        ? m_root_list
-                        : (*((*node1)->m_parent))->m_children;
-                node_pointer tmp = create_node(
-                    _val,
-                    (*node1)->m_parent,
-                    (*node1)->m_older_sibling,
-                    (*node1)->m_younger_sibling);
-                list1.insert(node1, tmp);
-                sub_iterator it = node1;
-                --it;
-                tmp->m_children.splice(tmp->m_children.begin(), list1, node1);
+                node_pointer tmp = create_node(std::forward<Args>(_args)...);
+                tmp->m_parent = node1->m_parent;
+                tmp->m_older_sibling = node1->m_older_sibling;
+                tmp->m_younger_sibling = node1->m_younger_sibling;
                 
-                if((*it)->m_older_sibling != sub_iterator())
-                    (*((*it)->m_older_sibling))->m_younger_sibling = it;
-                if((*it)->m_younger_sibling != sub_iterator())
-                    (*((*it)->m_younger_sibling))->m_older_sibling = it;
+                if(tmp->m_older_sibling != 0)
+                    tmp->m_older_sibling->m_younger_sibling = tmp;
+                else if(tmp->m_parent != 0)
+                    tmp->m_parent->m_first_child = tmp;
+                if(tmp->m_younger_sibling != 0)
+                    tmp->m_younger_sibling->m_older_sibling = tmp;
+                else if(tmp->m_parent != 0)
+                    tmp->m_parent->m_last_child = tmp;
                 
-                tmp->m_children.front()->m_parent = it;
-                tmp->m_children.front()->m_older_sibling = sub_iterator();
-                tmp->m_children.front()->m_younger_sibling = sub_iterator();
+                tmp->m_first_child = node1;
+                tmp->m_last_child = node1;
+                node1->m_parent = tmp;
+                node1->m_older_sibling = 0;
+                node1->m_younger_sibling = 0;
                 
-                if(node1 == m_root) m_root = it;
-                return Iterator(it);
+                if(node1 == m_root) m_root = tmp;
+                return Iterator(tmp);
             }
         }
         
         //---- append child
         template<typename Iterator>
         Iterator append_child(Iterator _pos, const value_type& _val)
+        { return emplace_child(_pos, _val); }
+        
+        template<typename Iterator>
+        Iterator append_child(Iterator _pos, value_type&& _val)
+        { return emplace_child(_pos, std::move(_val)); }
+        
+        //---- emplace child
+        //     constructs a new last child of _pos in place.
+        template<typename Iterator, typename... Args>
+        Iterator emplace_child(Iterator _pos, Args&&... _args)
         {
-            sub_iterator node1 = _pos.base();
-            assert(node1 != sub_iterator());
+            node_pointer node1 = _pos.base();
+            assert(node1 != 0);
             assert(node1 != m_foot);
             
-            node_pointer tmp = create_node(_val, node1);
-            if(!((*node1)->m_children.empty())){
-                sub_iterator tmp_back = --((*node1)->m_children.end());
-                tmp->m_older_sibling = tmp_back;
-                (*node1)->m_children.push_back(tmp);
-                (*tmp_back)->m_younger_sibling = (--((*node1)->m_children.end()));
-            }else{
-                (*node1)->m_children.push_back(tmp);
-            }
-            return Iterator(--((*node1)->m_children.end()));
+            node_pointer tmp = create_node(std::forward<Args>(_args)...);
+            link_child(node1, 0, tmp);
+            return Iterator(tmp);
         }
         
         //---- append child tree
         template<typename Iterator>
         void append_child_tree(Iterator _pos, const self_type& _subtree)
         {
-            sub_iterator node1 = _pos.base();
-            assert(node1 != sub_iterator());
+            node_pointer node1 = _pos.base();
+            assert(node1 != 0);
             assert(node1 != m_foot);
             
             const self_type& cp1 = (&_subtree != this) ? _subtree : self_type(_subtree);
@@ -177,40 +256,23 @@ namespace creek
         //---- insert child
         template<typename Iterator, typename Iterator2>
         Iterator insert_child(Iterator _parent, Iterator2 _child_pos, const value_type& _val)
-        {
-            sub_iterator parent = _parent.base();
-            sub_iterator node1 = _child_pos.base();
-            assert(parent != sub_iterator());
-            assert(node1 != sub_iterator());
-            assert(node1 != m_foot);
-            assert(node1 != m_root);
-            assert(_parent.base() == creek::parent(_child_pos).base());
-            
-            node_pointer tmp = create_node(
-                _val,
-                parent,
-                (*node1)->m_older_sibling,
-                node1);
-            sub_iterator it = (*parent)->m_children.insert(node1, tmp);
-            
-            if((*node1)->m_older_sibling != sub_iterator())
-                (*((*node1)->m_older_sibling))->m_younger_sibling = it;
-            (*node1)->m_older_sibling = it;
-            
-            return Iterator(it);
-        }
+        { return emplace_child_at(_parent, _child_pos, _val); }
+        
+        template<typename Iterator, typename Iterator2>
+        Iterator insert_child(Iterator _parent, Iterator2 _child_pos, value_type&& _val)
+        { return emplace_child_at(_parent, _child_pos, std::move(_val)); }
         
         //---- insert child
         template<typename Iterator, typename Iterator2>
         Iterator insert_child_tree(Iterator _parent, Iterator2 _child_pos, self_type const& _other)
         {
-            sub_iterator parent = _parent.base();
-            sub_iterator node1 = _child_pos.base();
-            assert(parent != sub_iterator());
-            assert(node1 != sub_iterator());
+            node_pointer parent = _parent.base();
+            node_pointer node1 = _child_pos.base();
+            assert(parent != 0);
+            assert(node1 != 0);
             assert(node1 != m_foot);
             assert(node1 != m_root);
-            assert(_parent.base() == creek::parent(_child_pos).base());
+            assert(parent == node_pointer(creek::parent(_child_pos).base()));
             
             self_type const& cp1 = (&_other != this) ? _other : self_type(_other);
             const_pre_order_iterator iother = cp1.pre_order_begin();
@@ -228,73 +290,107 @@ namespace creek
                 ++iother;
                 ++iself;
             }
-            return Iterator(--node1);
+            return Iterator(node1->m_older_sibling);
+        }
+        
+        //---- append / insert child tree (rvalue)
+        //     the nodes of _subtree are relinked instead of copied.
+        template<typename Iterator>
+        void append_child_tree(Iterator _pos, self_type&& _subtree)
+        {
+            assert(&_subtree != this);
+            if(_subtree.empty()) return;
+            splice_nodes(_pos.base(), 0, _subtree, _subtree.m_root);
+        }
+        
+        template<typename Iterator, typename Iterator2>
+        Iterator insert_child_tree(Iterator _parent, Iterator2 _child_pos, self_type&& _other)
+        {
+            node_pointer node1 = _child_pos.base();
+            assert(&_other != this);
+            assert(node1 != 0);
+            assert(node1 != m_root);
+            if(_other.empty()) return Iterator(node1->m_older_sibling);
+            return Iterator(splice_nodes(_parent.base(), node1, _other, _other.m_root));
+        }
+        
+        //---- splice child
+        //     moves the subtree at _src_node out of _src and links it under
+        //     _dst_parent in front of _dst_pos, or as the last child if
+        //     _dst_pos is an end position. _src may be *this.
+        //     constant time unless the allocators differ, then the
+        //     subtree is copied and erased from _src.
+        template<typename Iterator, typename Iterator2, typename Iterator3>
+        Iterator splice_child(Iterator _dst_parent, Iterator2 _dst_pos, self_type& _src, Iterator3 _src_node)
+        {
+            return Iterator(splice_nodes(_dst_parent.base(), _dst_pos.base(), _src, _src_node.base()));
+        }
+        
+        //---- move subtree
+        //     reparents _node as the last child of _new_parent.
+        template<typename Iterator, typename Iterator2>
+        Iterator move_subtree(Iterator _node, Iterator2 _new_parent)
+        {
+            return Iterator(splice_nodes(_new_parent.base(), 0, *this, _node.base()));
         }
         
         template<typename Iterator>
         void erase(Iterator _pos)
         {
             if(empty()) return;
-            static sub_iterator const empty = sub_iterator();
-            sub_iterator node1 = _pos.base();
-            assert(node1 != empty);
+            node_pointer node1 = _pos.base();
+            assert(node1 != 0);
             assert(node1 != m_foot);
             
-            sub_iterator b = node1;
-            while(!(**b).m_children.empty()){
-                b = (**b).m_children.begin();
+            node_pointer b = node1;
+            while(b->m_first_child != 0){
+                b = b->m_first_child;
             }
             
             post_order_iterator it(b);
             post_order_iterator end(node1);
             while(it != end){
-                node_pointer c = *(it.base());
+                node_pointer c = it.base();
                 ++it;
                 destroy_and_deallocate(c);
             }
             
-            sub_iterator parentnode = (*node1)->m_parent;
-            if(parentnode != empty){
-                if((*node1)->m_older_sibling != empty)
-                    (*((*node1)->m_older_sibling))->m_younger_sibling = (*node1)->m_younger_sibling;
-                if((*node1)->m_younger_sibling != empty)
-                    (*((*node1)->m_younger_sibling))->m_older_sibling = (*node1)->m_older_sibling;
-                (*parentnode)->m_children.erase(node1);
-                destroy_and_deallocate(*node1);
+            if(node1->m_parent != 0){
+                unlink(node1);
+                destroy_and_deallocate(node1);
             }else{
                 assert(node1 == m_root);
-                destroy_and_deallocate(*node1);
-                m_root_list.clear();
-                m_root = m_root_list.begin();
-                m_foot = m_root_list.begin();
-                m_foot_obj = node();
+                destroy_and_deallocate(node1);
+                store_size(0);
+                m_root = m_foot;
+                m_foot_obj.m_older_sibling = 0;
             }
         }
         
         //---- clear
+        //     with a bulk releasable allocator and trivially destructible
+        //     values the nodes are dropped together with the arena
+        //     instead of being destroyed one by one, as long as no
+        //     other copy of the allocator shares the arena.
         void clear()
         {
             if(empty()) return;
-            erase(pre_order_iterator(m_root));
+            clear(std::integral_constant<bool,
+                is_bulk_releasable<node_allocator>::value &&
+                std::is_trivially_destructible<node>::value>());
         }
         
         //---- operator=
         self_type& operator=(self_type const& _other)
         {
             if(&_other == this) return *this;
-            if(_other.m_size == 0) return *this;
+            clear();
+            if(_other.empty()) return *this;
             else
             {
-                clear();
                 const_pre_order_iterator iother = _other.pre_order_begin(),
                     other_end = _other.pre_order_end();
-                node* root_tmp = create_node(*iother);
-                m_root_list.push_back(root_tmp);
-                m_root_list.push_back(&m_foot_obj);
-                m_root = m_root_list.begin();
-                m_foot = (++(m_root_list.begin()));
-                (*m_root)->m_younger_sibling = m_foot;
-                m_foot_obj.m_older_sibling = m_root;
+                link_root(create_node(*iother));
                 pre_order_iterator iself(m_root);
                 while(iother != other_end){
                     auto chi = child_order_begin(iother);
@@ -310,42 +406,57 @@ namespace creek
             }
         }
         
+        //---- move assignment
+        //     the allocator travels with the nodes it owns.
+        self_type& operator=(self_type&& _other) noexcept
+        {
+            if(&_other == this) return *this;
+            self_type tmp(std::move(_other));
+            swap(tmp);
+            return *this;
+        }
+        
         void swap(self_type& _other)
         {
-            m_root_list.swap(_other.m_root_list);
             std::swap(m_root, _other.m_root);
-            std::swap(m_foot, _other.m_foot);
-            std::swap(m_foot_obj, _other.m_foot_obj);
-            std::swap(m_size, _other.m_size);
+            size_type n = stored_size();
+            store_size(_other.stored_size());
+            _other.store_size(n);
             std::swap(m_alloc, _other.m_alloc);
-            (*m_foot) = &m_foot_obj;
-            (*_other.m_foot) = &(_other.m_foot_obj);
+            relink_foot(_other);
+            _other.relink_foot(*this);
+        }
+        
+        //---- freeze
+        //     immutable pre order snapshot, see frozen_tree.h.
+        frozen_tree<value_type> freeze() const
+        {
+            return frozen_tree<value_type>(*this);
         }
         
         //
         template<typename Iterator>
         self_type get_subtree(Iterator _pos) const
         {
-            sub_iterator node1 = _pos.base();
-            assert(node1 != sub_iterator());
+            node_pointer node1 = _pos.base();
+            assert(node1 != 0);
             assert(node1 != m_foot);
-            sub_iterator const empty = sub_iterator();
             
             self_type subcopy;
-            if(m_size == 0) return subcopy;
+            if(empty()) return subcopy;
             
-            const_pre_order_iterator isub(node1), isub_end(empty);
+            const_pre_order_iterator isub(node1), isub_end;
             {
-                sub_iterator cur_node(node1);
-                while(cur_node != empty){
-                    if((*cur_node)->m_younger_sibling != empty){
-                        isub_end = const_pre_order_iterator((*cur_node)->m_younger_sibling);
+                node_pointer cur_node = node1;
+                while(cur_node != 0){
+                    if(cur_node->m_younger_sibling != 0){
+                        isub_end = const_pre_order_iterator(cur_node->m_younger_sibling);
                         break;
                     }
-                    cur_node = (*cur_node)->m_parent;
+                    cur_node = cur_node->m_parent;
                 }
             }
-            assert(isub_end.base() != empty);
+            assert(isub_end.base() != 0);
             
             pre_order_iterator icopy = subcopy.pre_order_begin();
             icopy = subcopy.insert(icopy, *isub);
@@ -364,36 +475,214 @@ namespace creek
         }
         
     private:
-        //---- create node
-        node_pointer create_node(node const& _node)
+        static size_type const unknown_size = static_cast<size_type>(-1);
+        
+        size_type stored_size() const
+        { return m_size.load(std::memory_order_relaxed); }
+        
+        void store_size(size_type _n) const
+        { m_size.store(_n, std::memory_order_relaxed); }
+        
+        //---- adds _d to a known count
+        void add_size(int _d)
         {
-            node_pointer tmp = m_alloc.allocate(1);
-            try{
-                m_alloc.construct(tmp, _node);
+            size_type n = stored_size();
+            if(n != unknown_size) store_size(n + _d);
+        }
+        
+        node_pointer splice_nodes(node_pointer _parent, node_pointer _pos,
+            self_type& _src, node_pointer _node)
+        {
+            assert(_parent != 0);
+            assert(_parent != m_foot);
+            assert(_pos == 0 || _pos->m_parent == _parent);
+            assert(_node != 0);
+            assert(_node != _src.m_foot);
+            assert(&_src != this || !is_in_subtree(_parent, _node));
+            
+            if(_pos == _node) return _node;
+            if(&_src != this && !(m_alloc == _src.m_alloc)){
+                node_pointer tmp = clone_subtree(_parent, _pos, _node);
+                _src.erase(pre_order_iterator(_node));
+                return tmp;
             }
-            catch(...){
-                m_alloc.deallocate(tmp, 1);
-                throw;
+            
+            if(&_src != this){
+                if(_node == _src.m_root){
+                    if(stored_size() != unknown_size) store_size(_src.size() + stored_size());
+                    _src.store_size(0);
+                }else if(_node->m_first_child == 0){
+                    add_size(1);
+                    _src.add_size(-1);
+                }else{
+                    store_size(unknown_size);
+                    _src.store_size(unknown_size);
+                }
             }
-            ++m_size;
-            return tmp;
+            _src.detach(_node);
+            link_child(_parent, _pos, _node);
+            return _node;
+        }
+        
+        //---- clone subtree
+        //     copies the subtree at _node under _parent in front of _pos.
+        node_pointer clone_subtree(node_pointer _parent, node_pointer _pos, node_pointer _node)
+        {
+            node_pointer top = create_node(_node->m_value);
+            link_child(_parent, _pos, top);
+            
+            node_pointer from = _node, to = top;
+            while(1){
+                if(from->m_first_child != 0){
+                    from = from->m_first_child;
+                    node_pointer tmp = create_node(from->m_value);
+                    link_child(to, 0, tmp);
+                    to = tmp;
+                    continue;
+                }
+                while(from != _node && from->m_younger_sibling == 0){
+                    from = from->m_parent;
+                    to = to->m_parent;
+                }
+                if(from == _node) break;
+                from = from->m_younger_sibling;
+                node_pointer tmp = create_node(from->m_value);
+                link_child(to->m_parent, 0, tmp);
+                to = tmp;
+            }
+            return top;
+        }
+        
+        //---- detach
+        //     takes _node out of the tree, the root included.
+        void detach(node_pointer _node)
+        {
+            if(_node == m_root){
+                m_root = m_foot;
+                m_foot_obj.m_older_sibling = 0;
+                _node->m_younger_sibling = 0;
+            }else{
+                unlink(_node);
+            }
+        }
+        
+        static bool is_in_subtree(node_pointer _node, node_pointer _top)
+        {
+            while(_node != 0){
+                if(_node == _top) return true;
+                _node = _node->m_parent;
+            }
+            return false;
+        }
+        
+        template<typename Iterator, typename Iterator2, typename... Args>
+        Iterator emplace_child_at(Iterator _parent, Iterator2 _child_pos, Args&&... _args)
+        {
+            node_pointer parent = _parent.base();
+            node_pointer node1 = _child_pos.base();
+            assert(parent != 0);
+            assert(node1 != 0);
+            assert(node1 != m_foot);
+            assert(node1 != m_root);
+            assert(parent == node_pointer(creek::parent(_child_pos).base()));
+            
+            node_pointer tmp = create_node(std::forward<Args>(_args)...);
+            link_child(parent, node1, tmp);
+            return Iterator(tmp);
+        }
+        
+        void clear(std::true_type)
+        {
+            if(!m_alloc.sole_owner()){
+                clear(std::false_type());
+                return;
+            }
+            m_alloc.release();
+            store_size(0);
+            m_root = m_foot;
+            m_foot_obj.m_older_sibling = 0;
+        }
+        
+        void clear(std::false_type)
+        {
+            erase(pre_order_iterator(m_root));
+        }
+        
+        //---- link root
+        //     the foot node follows the root as its younger sibling,
+        //     so pre order and post order traversals end on it.
+        void link_root(node_pointer _node)
+        {
+            m_root = _node;
+            _node->m_younger_sibling = m_foot;
+            m_foot_obj.m_older_sibling = _node;
+        }
+        
+        //---- relink foot
+        //     called after m_root was taken over from _from.
+        void relink_foot(self_type const& _from)
+        {
+            if(m_root == _from.m_foot){
+                m_root = m_foot;
+                m_foot_obj.m_older_sibling = 0;
+            }else{
+                link_root(m_root);
+            }
+        }
+        
+        //---- link child
+        //     links _node under _parent in front of _pos,
+        //     or as the last child if _pos is null.
+        static void link_child(node_pointer _parent, node_pointer _pos, node_pointer _node)
+        {
+            _node->m_parent = _parent;
+            _node->m_younger_sibling = _pos;
+            _node->m_older_sibling = (_pos != 0) ? _pos->m_older_sibling : _parent->m_last_child;
+            
+            if(_node->m_older_sibling != 0)
+                _node->m_older_sibling->m_younger_sibling = _node;
+            else
+                _parent->m_first_child = _node;
+            if(_pos != 0)
+                _pos->m_older_sibling = _node;
+            else
+                _parent->m_last_child = _node;
         }
         
-        node_pointer create_node(
-            value_type const& _val = value_type(),
-            sub_iterator _parent = sub_iterator(),
-            sub_iterator _older = sub_iterator(),
-            sub_iterator _younger = sub_iterator())
+        //---- unlink
+        //     detaches a non root node from its parent and siblings.
+        static void unlink(node_pointer _node)
+        {
+            node_pointer parentnode = _node->m_parent;
+            assert(parentnode != 0);
+            
+            if(_node->m_older_sibling != 0)
+                _node->m_older_sibling->m_younger_sibling = _node->m_younger_sibling;
+            else
+                parentnode->m_first_child = _node->m_younger_sibling;
+            if(_node->m_younger_sibling != 0)
+                _node->m_younger_sibling->m_older_sibling = _node->m_older_sibling;
+            else
+                parentnode->m_last_child = _node->m_older_sibling;
+            
+            _node->m_parent = 0;
+            _node->m_older_sibling = 0;
+            _node->m_younger_sibling = 0;
+        }
+        
+        //---- create node
+        template<typename... Args>
+        node_pointer create_node(Args&&... _args)
         {
             node_pointer tmp = m_alloc.allocate(1);
             try{
-                m_alloc.construct(tmp, node{_val, _parent, _older, _younger, list_type()});
+                m_alloc.construct(tmp, std::forward<Args>(_args)...);
             }
             catch(...){
                 m_alloc.deallocate(tmp, 1);
                 throw;
             }
-            ++m_size;
+            add_size(1);
             return tmp;
         }
         
@@ -402,7 +691,7 @@ namespace creek
         {
             m_alloc.destroy(_node);
             m_alloc.deallocate(_node, 1);
-            --m_size;
+            add_size(-1);
         }
         
     public:
@@ -413,6 +702,8 @@ namespace creek
         typedef tree_iterator<true,  post_order_tag,  self_type> const_post_order_iterator;
         typedef tree_iterator<false, child_order_tag, self_type> child_order_iterator;
         typedef tree_iterator<true,  child_order_tag, self_type> const_child_order_iterator;
+        typedef tree_iterator<false, level_order_tag, self_type> level_order_iterator;
+        typedef tree_iterator<true,  level_order_tag, self_type> const_level_order_iterator;
         
         typedef tree_iterator<false, reverse_tag<pre_order_tag>,   self_type> reverse_pre_order_iterator;
         typedef tree_iterator<true,  reverse_tag<pre_order_tag>,   self_type> const_reverse_pre_order_iterator;
@@ -421,6 +712,10 @@ namespace creek
         typedef tree_iterator<false, reverse_tag<child_order_tag>, self_type> reverse_child_order_iterator;
         typedef tree_iterator<true,  reverse_tag<child_order_tag>, self_type> const_reverse_child_order_iterator;
         
+    private:
+        typedef typename level_order_iterator::sub_iterator level_position;
+        
+    public:
         //---- pre order begin end
         pre_order_iterator pre_order_begin()
         { return pre_order_iterator(m_root); }
@@ -437,10 +732,9 @@ namespace creek
         //---- pos torder begin end
         post_order_iterator post_order_begin()
         {
-            if(empty()) return post_order_iterator(m_root);
-            sub_iterator tmp = m_root;
-            while(!((*tmp)->m_children.empty()))
-                tmp = (*tmp)->m_children.begin();
+            node_pointer tmp = m_root;
+            while(tmp->m_first_child != 0)
+                tmp = tmp->m_first_child;
             return post_order_iterator(tmp);
         }
         
@@ -449,16 +743,45 @@ namespace creek
         
         const_post_order_iterator post_order_begin() const
         {
-            if(m_root == m_foot) return post_order_iterator(m_root);
-            sub_iterator tmp = m_root;
-            while(!((*tmp)->m_children.empty()))
-                tmp = (*tmp)->m_children.begin();
+            node_pointer tmp = m_root;
+            while(tmp->m_first_child != 0)
+                tmp = tmp->m_first_child;
             return const_post_order_iterator(tmp);
         }
         
         const_post_order_iterator post_order_end() const
         { return const_post_order_iterator(m_foot); }
         
+        //---- level order begin end
+        //     the iterators are forward only and keep the current
+        //     level in a buffer that is reused from level to level.
+        level_order_iterator level_order_begin()
+        { return level_order_iterator(level_position::at_depth(empty() ? 0 : m_root, 0, false)); }
+        
+        level_order_iterator level_order_end()
+        { return level_order_iterator(); }
+        
+        const_level_order_iterator level_order_begin() const
+        { return const_level_order_iterator(level_position::at_depth(empty() ? 0 : m_root, 0, false)); }
+        
+        const_level_order_iterator level_order_end() const
+        { return const_level_order_iterator(); }
+        
+        //---- nodes at depth _depth from left to right, the root at 0
+        std::pair<level_order_iterator, level_order_iterator> level_range(size_type _depth)
+        {
+            return std::make_pair(
+                level_order_iterator(level_position::at_depth(empty() ? 0 : m_root, _depth, true)),
+                level_order_iterator());
+        }
+        
+        std::pair<const_level_order_iterator, const_level_order_iterator> level_range(size_type _depth) const
+        {
+            return std::make_pair(
+                const_level_order_iterator(level_position::at_depth(empty() ? 0 : m_root, _depth, true)),
+                const_level_order_iterator());
+        }
+        
         //---- pre order rbegin rend
         reverse_pre_order_iterator pre_order_rbegin()
         { return reverse_pre_order_iterator(pre_order_end().base()); }
@@ -491,41 +814,37 @@ namespace creek
         
         static value_type& dereference(sub_iterator _a)
         {
-            return (**_a).m_value;
+            return _a->m_value;
         }
         
         static sub_iterator parent(sub_iterator _a)
         {
             assert(_a != sub_iterator());
-            return (**_a).m_parent;
+            return _a->m_parent;
         }
         
         static sub_iterator first_child(sub_iterator _a)
         {
             assert(_a != sub_iterator());
-            return ((**_a).m_children.empty())
-                ? sub_iterator()
-                : (**_a).m_children.begin();
+            return _a->m_first_child;
         }
         
         static sub_iterator last_child(sub_iterator _a)
         {
             assert(_a != sub_iterator());
-            return ((**_a).m_children.empty())
-                ? sub_iterator()
-                : (--((**_a).m_children.end()));
+            return _a->m_last_child;
         }
         
         static sub_iterator older_sibling(sub_iterator _a)
         {
             assert(_a != sub_iterator());
-            return (**_a).m_older_sibling;
+            return _a->m_older_sibling;
         }
         
         static sub_iterator younger_sibling(sub_iterator _a)
         {
             assert(_a != sub_iterator());
-            return (**_a).m_younger_sibling;
+            return _a->m_younger_sibling;
         }
     };
     
@@ -544,7 +863,7 @@ namespace creek
         typedef typename
             std::conditional<IsConst, value_type const&, value_type&>::type reference;
         typedef std::bidirectional_iterator_tag iterator_category;
-        typedef typename tree_type::sub_iterator sub_iterator;
+        typedef typename tree_type::child_position sub_iterator;
         
         static sub_iterator base(sub_iterator _a)
         {
@@ -553,18 +872,23 @@ namespace creek
         
         static reference dereference(sub_iterator _a)
         {
-            assert(_a != sub_iterator());
-            return (**_a).m_value;
+            assert(_a.m_node != 0);
+            return _a.m_node->m_value;
         }
         
         static sub_iterator& increment(sub_iterator& _a)
         {
-            return (++_a);
+            assert(_a.m_node != 0);
+            _a.m_node = _a.m_node->m_younger_sibling;
+            return _a;
         }
         
         static sub_iterator& decrement(sub_iterator& _a)
         {
-            return (--_a);
+            _a.m_node = (_a.m_node != 0)
+                ? _a.m_node->m_older_sibling
+                : _a.m_parent->m_last_child;
+            return _a;
         }
     };
     
@@ -572,20 +896,20 @@ namespace creek
     tree_iterator<IsConst, child_order_tag, tree<T, A>>
     child_order_begin(tree_iterator<IsConst, Traversal, tree<T, A>> _it)
     {
-        typedef tree_iterator_traits<tree_iterator<IsConst, child_order_tag, tree<T, A>>>
-            traits_type;
-        auto a = _it.base();
-        return tree_iterator<IsConst, child_order_tag, tree<T, A>>((**a).m_children.begin());
+        typedef tree_iterator<IsConst, child_order_tag, tree<T, A>> iterator_type;
+        typedef typename iterator_type::sub_iterator child_position;
+        typename multiway_tree_traits<tree<T, A>>::sub_iterator a = _it.base();
+        return iterator_type(child_position(a, a->m_first_child));
     }
     
     template<bool IsConst, typename Traversal, typename T, typename A>
     tree_iterator<IsConst, child_order_tag, tree<T, A>>
     child_order_end(tree_iterator<IsConst, Traversal, tree<T, A>> _it)
     {
-        typedef tree_iterator_traits<tree_iterator<IsConst, child_order_tag, tree<T, A>>>
-            traits_type;
-        auto a = _it.base();
-        return tree_iterator<IsConst, child_order_tag, tree<T, A>>((**a).m_children.end());
+        typedef tree_iterator<IsConst, child_order_tag, tree<T, A>> iterator_type;
+        typedef typename iterator_type::sub_iterator child_position;
+        typename multiway_tree_traits<tree<T, A>>::sub_iterator a = _it.base();
+        return iterator_type(child_position(a, 0));
     }
     
     template<bool IsConst, typename Traversal, typename T, typename A>
@@ -615,9 +939,10 @@ namespace creek
         while(it != end){
             typename Tree::const_child_order_iterator child = child_order_begin(it),
                 child_end = child_order_end(it);
-            out << "\t" << "N" << *(it.base()) << "[ label=\"" << *it << "\" ];\n";
+            out << "\t" << "N" << static_cast<void const*>(&(*it)) << "[ label=\"" << *it << "\" ];\n";
             while(child != child_end){
-                out << "\t" << "N" << *(it.base()) << " -> " << "N" << *(child.base());
+                out << "\t" << "N" << static_cast<void const*>(&(*it))
+                    << " -> " << "N" << static_cast<void const*>(&(*child));
                 out << ";\n";
                 ++child;
             }
@@ -628,6 +953,3 @@ namespace creek
 }//---- namespace creek
 
 #endif
-
-
-
@@ -0,0 +1,254 @@
+//-----------------------------------------------------------
+//    visitor.h
+//-----------------------------------------------------------
+#ifndef CREEK_VISITOR_H
+#define CREEK_VISITOR_H
+
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+#include "fwd.h"
+
+namespace creek
+{
+    //---- visit result
+    //     what a visitor wants the walk to do next. skip_children
+    //     leaves out the subtree below the node just visited,
+    //     stop ends the walk. a visitor returning void proceeds.
+    enum class visit_result
+    {
+        proceed, skip_children, stop
+    };
+    
+    namespace detail
+    {
+        //---- tree root
+        //     trees with pre order iterators start there, the others
+        //     (nary_tree) with their level order begin.
+        template<typename Tree>
+        auto tree_root(Tree& _tree, int) -> decltype(_tree.pre_order_begin().base())
+        { return _tree.pre_order_begin().base(); }
+        
+        template<typename Tree>
+        auto tree_root(Tree& _tree, long) -> decltype(_tree.begin().base())
+        { return _tree.begin().base(); }
+        
+        template<typename Tree>
+        auto tree_empty(Tree& _tree, int) -> decltype(_tree.empty())
+        { return _tree.empty(); }
+        
+        template<typename Tree>
+        bool tree_empty(Tree& _tree, long)
+        { return (_tree.size() == 0); }
+        
+        template<typename Tree, typename Traits>
+        struct visit_traits
+        {
+            typedef Traits traits_type;
+            typedef typename traits_type::sub_iterator sub_iterator;
+            typedef typename std::conditional<std::is_const<Tree>::value,
+                typename std::remove_const<Tree>::type::value_type const&,
+                decltype(traits_type::dereference(std::declval<sub_iterator>()))>::type reference;
+        };
+        
+        template<typename Visitor, typename Reference>
+        visit_result call_visitor(Visitor& _v, Reference _a, std::true_type)
+        {
+            _v(std::forward<Reference>(_a));
+            return visit_result::proceed;
+        }
+        
+        template<typename Visitor, typename Reference>
+        visit_result call_visitor(Visitor& _v, Reference _a, std::false_type)
+        {
+            return _v(std::forward<Reference>(_a));
+        }
+        
+        template<typename Visitor, typename Reference>
+        visit_result call_visitor(Visitor& _v, Reference _a)
+        {
+            typedef decltype(_v(std::declval<Reference>())) result_type;
+            return call_visitor<Visitor, Reference>(
+                _v, std::forward<Reference>(_a), typename std::is_void<result_type>::type());
+        }
+        
+        //-----------------------------------------------------------
+        //    multiway walks
+        //    the pre order stack holds the next sibling still to be
+        //    visited on every level, the post order stack the node
+        //    and its next child. both grow with the depth only.
+        //-----------------------------------------------------------
+        template<typename Tree, typename Visitor>
+        bool multiway_pre_order(Tree& _tree, Visitor& _v)
+        {
+            typedef visit_traits<Tree, multiway_tree_traits<typename std::remove_const<Tree>::type>> vt;
+            typedef typename vt::traits_type traits_type;
+            typedef typename vt::sub_iterator sub_iterator;
+            typedef typename vt::reference reference;
+            
+            sub_iterator a = tree_root(_tree, 0);
+            visit_result r = call_visitor<Visitor, reference>(_v, traits_type::dereference(a));
+            if(r == visit_result::stop) return false;
+            if(r == visit_result::skip_children) return true;
+            
+            std::vector<sub_iterator> stack;
+            a = traits_type::first_child(a);
+            if(a != sub_iterator()) stack.push_back(a);
+            while(!stack.empty()){
+                a = stack.back();
+                sub_iterator next = traits_type::younger_sibling(a);
+                if(next != sub_iterator()) stack.back() = next;
+                else stack.pop_back();
+                
+                r = call_visitor<Visitor, reference>(_v, traits_type::dereference(a));
+                if(r == visit_result::stop) return false;
+                if(r == visit_result::skip_children) continue;
+                sub_iterator c = traits_type::first_child(a);
+                if(c != sub_iterator()) stack.push_back(c);
+            }
+            return true;
+        }
+        
+        template<typename Tree, typename Visitor>
+        bool multiway_post_order(Tree& _tree, Visitor& _v)
+        {
+            typedef visit_traits<Tree, multiway_tree_traits<typename std::remove_const<Tree>::type>> vt;
+            typedef typename vt::traits_type traits_type;
+            typedef typename vt::sub_iterator sub_iterator;
+            typedef typename vt::reference reference;
+            
+            std::vector<std::pair<sub_iterator, sub_iterator>> stack;
+            sub_iterator a = tree_root(_tree, 0);
+            stack.push_back(std::make_pair(a, traits_type::first_child(a)));
+            while(!stack.empty()){
+                sub_iterator c = stack.back().second;
+                if(c != sub_iterator()){
+                    stack.back().second = traits_type::younger_sibling(c);
+                    stack.push_back(std::make_pair(c, traits_type::first_child(c)));
+                    continue;
+                }
+                a = stack.back().first;
+                stack.pop_back();
+                if(call_visitor<Visitor, reference>(_v, traits_type::dereference(a)) == visit_result::stop)
+                    return false;
+            }
+            return true;
+        }
+        
+        //-----------------------------------------------------------
+        //    binary walks
+        //    pre order keeps the right children still to be visited,
+        //    post order the path with the branch taken last.
+        //-----------------------------------------------------------
+        template<typename Tree, typename Visitor>
+        bool binary_pre_order(Tree& _tree, Visitor& _v)
+        {
+            typedef visit_traits<Tree, binary_tree_traits<typename std::remove_const<Tree>::type>> vt;
+            typedef typename vt::traits_type traits_type;
+            typedef typename vt::sub_iterator sub_iterator;
+            typedef typename vt::reference reference;
+            
+            std::vector<sub_iterator> stack;
+            sub_iterator a = tree_root(_tree, 0);
+            while(1){
+                visit_result r = call_visitor<Visitor, reference>(_v, traits_type::dereference(a));
+                if(r == visit_result::stop) return false;
+                if(r == visit_result::proceed){
+                    sub_iterator left = traits_type::left_child(a);
+                    sub_iterator right = traits_type::right_child(a);
+                    if(left != sub_iterator()){
+                        if(right != sub_iterator()) stack.push_back(right);
+                        a = left;
+                        continue;
+                    }
+                    if(right != sub_iterator()){
+                        a = right;
+                        continue;
+                    }
+                }
+                if(stack.empty()) return true;
+                a = stack.back();
+                stack.pop_back();
+            }
+        }
+        
+        template<typename Tree, typename Visitor>
+        bool binary_post_order(Tree& _tree, Visitor& _v)
+        {
+            typedef visit_traits<Tree, binary_tree_traits<typename std::remove_const<Tree>::type>> vt;
+            typedef typename vt::traits_type traits_type;
+            typedef typename vt::sub_iterator sub_iterator;
+            typedef typename vt::reference reference;
+            
+            //---- second: 0 nothing taken yet, 1 left done, 2 both done
+            std::vector<std::pair<sub_iterator, int>> stack;
+            stack.push_back(std::make_pair(sub_iterator(tree_root(_tree, 0)), 0));
+            while(!stack.empty()){
+                std::pair<sub_iterator, int>& top = stack.back();
+                sub_iterator c = sub_iterator();
+                if(top.second == 0) c = traits_type::left_child(top.first);
+                else if(top.second == 1) c = traits_type::right_child(top.first);
+                if(top.second < 2){
+                    ++top.second;
+                    if(c != sub_iterator()) stack.push_back(std::make_pair(c, 0));
+                    continue;
+                }
+                sub_iterator a = top.first;
+                stack.pop_back();
+                if(call_visitor<Visitor, reference>(_v, traits_type::dereference(a)) == visit_result::stop)
+                    return false;
+            }
+            return true;
+        }
+    }
+    
+    //-----------------------------------------------------------
+    //    visit_pre_order
+    //    calls _visitor(value) for every node in pre order without
+    //    going through the iterators. returns false if the visitor
+    //    stopped the walk.
+    //-----------------------------------------------------------
+    template<typename Tree, typename Visitor>
+    typename std::enable_if<
+        is_multiway_tree<typename std::remove_const<Tree>::type>::value, bool>::type
+    visit_pre_order(Tree& _tree, Visitor _visitor)
+    {
+        if(detail::tree_empty(_tree, 0)) return true;
+        return detail::multiway_pre_order(_tree, _visitor);
+    }
+    
+    template<typename Tree, typename Visitor>
+    typename std::enable_if<
+        is_binary_tree<typename std::remove_const<Tree>::type>::value, bool>::type
+    visit_pre_order(Tree& _tree, Visitor _visitor)
+    {
+        if(detail::tree_empty(_tree, 0)) return true;
+        return detail::binary_pre_order(_tree, _visitor);
+    }
+    
+    //-----------------------------------------------------------
+    //    visit_post_order
+    //    same for post order. the children are done by the time a
+    //    node is visited, so skip_children does the same as proceed.
+    //-----------------------------------------------------------
+    template<typename Tree, typename Visitor>
+    typename std::enable_if<
+        is_multiway_tree<typename std::remove_const<Tree>::type>::value, bool>::type
+    visit_post_order(Tree& _tree, Visitor _visitor)
+    {
+        if(detail::tree_empty(_tree, 0)) return true;
+        return detail::multiway_post_order(_tree, _visitor);
+    }
+    
+    template<typename Tree, typename Visitor>
+    typename std::enable_if<
+        is_binary_tree<typename std::remove_const<Tree>::type>::value, bool>::type
+    visit_post_order(Tree& _tree, Visitor _visitor)
+    {
+        if(detail::tree_empty(_tree, 0)) return true;
+        return detail::binary_post_order(_tree, _visitor);
+    }
+}//---- namespace creek
+
+#endif